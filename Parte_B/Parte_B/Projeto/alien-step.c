@@ -0,0 +1,768 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "alien-step.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ALIEN_SIMD 1
+#endif
+
+// Moves by direction_t (UP, DOWN, LEFT, RIGHT)
+static const int move_rows[4] = {-1, 1, 0, 0};
+static const int move_columns[4] = {0, 0, -1, 1};
+
+/**
+ * Struct: step_job_t
+ * ------------------
+ * The step being computed, shared by the threads of the pool.
+ *
+ * current, next: The grid before and after the step.
+ * width, height: The size of the grids.
+ * seed, step: Inputs of the random direction of each alien.
+ * intent: For each alien, the cell it tries to move to, or -1.
+ * winner: For each free cell, the alien that moves into it, or -1.
+ * moved: The number of aliens that moved.
+ */
+typedef struct step_job_t
+{
+    const uint8_t *current;
+    uint8_t *next;
+    int width, height;
+    uint32_t seed, step;
+    int32_t *intent;
+    int32_t *winner;
+    atomic_int moved;
+} step_job_t;
+
+static step_job_t job;
+static int scratch_cells = 0;
+
+// The pool: workers wait for a new generation, take tiles until none are left
+static int workers_count = 0;
+static pthread_t workers[ALIEN_MAX_THREADS];
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+static unsigned int generation = 0;
+static int busy = 0;
+static bool stopping = false;
+static void (*phase)(int first_row, int last_row);
+static int tiles;
+static atomic_int next_tile;
+
+/**
+ * Function: cell_random
+ * ---------------------
+ * Returns a random number for one alien on one step, from a counter-based
+ * generator (a 32-bit integer hash of the seed, the step and the cell).
+ *
+ * The result does not depend on the order in which cells are visited, so the
+ * step gives the same grid with any number of threads, and it only needs
+ * 32-bit multiplies, so the SIMD kernels compute it in every lane.
+ */
+static inline uint32_t cell_random(uint32_t seed, uint32_t step, uint32_t cell)
+{
+    uint32_t x = seed ^ (step * 0x9e3779b9u) ^ (cell * 0x85ebca6bu);
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+/**
+ * Function: intent_row_scalar
+ * ---------------------------
+ * First phase, one cell at a time: every alien picks a direction (the top
+ * two bits of cell_random) and, if the neighbour that way is free in the
+ * current grid, asks to move there.
+ *
+ * row: The row.
+ * first_column, last_column: The columns to compute, last excluded.
+ *
+ * Like the other scalar row functions, it handles the edges of the grid;
+ * the SIMD kernels only run on inner cells. Returns 0.
+ */
+static int intent_row_scalar(int row, int first_column, int last_column)
+{
+    // Locals, as stores through intent could otherwise alias the fields of job
+    const int width = job.width, height = job.height;
+    const uint8_t *current = job.current;
+    int32_t *intent = job.intent;
+
+    for (int column = first_column; column < last_column; column++)
+    {
+        int cell = row * width + column;
+        intent[cell] = -1;
+        if (current[cell] != CELL_ALIEN)
+        {
+            continue;
+        }
+        int direction = (int)(cell_random(job.seed, job.step, cell) >> 30);
+        int target_row = row + move_rows[direction];
+        int target_column = column + move_columns[direction];
+        if (target_row < 0 || target_row >= height || target_column < 0 || target_column >= width)
+        {
+            continue;
+        }
+        int target = target_row * width + target_column;
+        if (current[target] == CELL_FREE)
+        {
+            intent[cell] = target;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Function: resolve_row_scalar
+ * ----------------------------
+ * Second phase, one cell at a time: every free cell picks, among the aliens
+ * asking for it, the one with the lowest cell index. The others stay where
+ * they are. Returns 0.
+ */
+static int resolve_row_scalar(int row, int first_column, int last_column)
+{
+    const int width = job.width, height = job.height;
+    const int32_t *intent = job.intent;
+    int32_t *winners = job.winner;
+
+    for (int column = first_column; column < last_column; column++)
+    {
+        // Only free cells are asked for. Neighbours in increasing index order: above, left, right, below
+        int cell = row * width + column;
+        int winner = -1;
+        if (row > 0 && intent[cell - width] == cell)
+            winner = cell - width;
+        else if (column > 0 && intent[cell - 1] == cell)
+            winner = cell - 1;
+        else if (column < width - 1 && intent[cell + 1] == cell)
+            winner = cell + 1;
+        else if (row < height - 1 && intent[cell + width] == cell)
+            winner = cell + width;
+        winners[cell] = winner;
+    }
+    return 0;
+}
+
+/**
+ * Function: write_row_scalar
+ * --------------------------
+ * Third phase, one cell at a time: writes the next grid. A cell won by an
+ * alien gets it; an alien that won a neighbour leaves its cell.
+ *
+ * Returns the number of aliens that moved into the row.
+ */
+static int write_row_scalar(int row, int first_column, int last_column)
+{
+    const int width = job.width, height = job.height;
+    const uint8_t *current = job.current;
+    const int32_t *winners = job.winner;
+    uint8_t *next = job.next;
+    int moved = 0;
+
+    for (int column = first_column; column < last_column; column++)
+    {
+        int cell = row * width + column;
+        uint8_t value = current[cell];
+        if (winners[cell] >= 0)
+        {
+            value = CELL_ALIEN;
+            moved++;
+        }
+        else if ((row > 0 && winners[cell - width] == cell) || (column > 0 && winners[cell - 1] == cell) ||
+                 (column < width - 1 && winners[cell + 1] == cell) || (row < height - 1 && winners[cell + width] == cell))
+        {
+            value = CELL_FREE;
+        }
+        next[cell] = value;
+    }
+    return moved;
+}
+
+#ifdef ALIEN_SIMD
+
+/**
+ * Function: mullo_sse2
+ * --------------------
+ * Multiplies four 32-bit lanes, keeping the low half (SSE4.1's
+ * _mm_mullo_epi32, built from two SSE2 widening multiplies).
+ */
+__attribute__((target("sse2"))) static inline __m128i mullo_sse2(__m128i a, __m128i b)
+{
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+/**
+ * Function: load4_sse2
+ * --------------------
+ * Loads four cells of a grid and widens them to 32-bit lanes.
+ */
+__attribute__((target("sse2"))) static inline __m128i load4_sse2(const uint8_t *cells)
+{
+    int32_t packed;
+    memcpy(&packed, cells, sizeof(packed));
+    __m128i zero = _mm_setzero_si128();
+    return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+}
+
+/**
+ * Function: select_sse2
+ * ---------------------
+ * Returns a where mask is set and b elsewhere (SSE4.1's blendv).
+ */
+__attribute__((target("sse2"))) static inline __m128i select_sse2(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+/**
+ * Function: intent_row_sse2
+ * -------------------------
+ * First phase on four inner cells at a time, with SSE2: hashes the cells,
+ * picks the neighbour in the drawn direction with masks, and writes the
+ * target, or -1, for the four cells at once.
+ *
+ * row: The row, not the first or the last of the grid.
+ * first_column, last_column: The columns to compute, inside the grid edges.
+ *
+ * The columns left over are done by the scalar function. Returns 0.
+ */
+__attribute__((target("sse2"))) static int intent_row_sse2(int row, int first_column, int last_column)
+{
+    const int width = job.width;
+    const uint32_t base = job.seed ^ (job.step * 0x9e3779b9u);
+    const __m128i minus_one = _mm_set1_epi32(-1);
+
+    int column = first_column;
+    for (; column + 4 <= last_column; column += 4)
+    {
+        int cell = row * width + column;
+        __m128i cells = _mm_add_epi32(_mm_set1_epi32(cell), _mm_setr_epi32(0, 1, 2, 3));
+
+        // cell_random in every lane; the direction is the top two bits
+        __m128i x = _mm_xor_si128(_mm_set1_epi32((int)base), mullo_sse2(cells, _mm_set1_epi32((int)0x85ebca6bu)));
+        x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+        x = mullo_sse2(x, _mm_set1_epi32(0x7feb352d));
+        x = _mm_xor_si128(x, _mm_srli_epi32(x, 15));
+        x = mullo_sse2(x, _mm_set1_epi32((int)0x846ca68bu));
+        x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+        __m128i direction = _mm_srli_epi32(x, 30);
+
+        __m128i up = _mm_cmpeq_epi32(direction, _mm_set1_epi32(0));
+        __m128i down = _mm_cmpeq_epi32(direction, _mm_set1_epi32(1));
+        __m128i left = _mm_cmpeq_epi32(direction, _mm_set1_epi32(2));
+        __m128i vertical = _mm_or_si128(up, down);
+
+        const uint8_t *current = job.current + cell;
+        __m128i target_value = select_sse2(vertical,
+                                           select_sse2(up, load4_sse2(current - width), load4_sse2(current + width)),
+                                           select_sse2(left, load4_sse2(current - 1), load4_sse2(current + 1)));
+        __m128i offset = select_sse2(vertical,
+                                     select_sse2(up, _mm_set1_epi32(-width), _mm_set1_epi32(width)),
+                                     select_sse2(left, minus_one, _mm_set1_epi32(1)));
+
+        __m128i moves = _mm_and_si128(_mm_cmpeq_epi32(load4_sse2(current), _mm_set1_epi32(CELL_ALIEN)),
+                                      _mm_cmpeq_epi32(target_value, _mm_set1_epi32(CELL_FREE)));
+        _mm_storeu_si128((__m128i *)(job.intent + cell), select_sse2(moves, _mm_add_epi32(cells, offset), minus_one));
+    }
+    return intent_row_scalar(row, column, last_column);
+}
+
+/**
+ * Function: resolve_row_sse2
+ * --------------------------
+ * Second phase on four inner cells at a time, with SSE2: compares the
+ * intents of the four neighbours with the cells and keeps the lowest match.
+ */
+__attribute__((target("sse2"))) static int resolve_row_sse2(int row, int first_column, int last_column)
+{
+    const int width = job.width;
+    const int32_t *intent = job.intent;
+
+    int column = first_column;
+    for (; column + 4 <= last_column; column += 4)
+    {
+        int cell = row * width + column;
+        __m128i cells = _mm_add_epi32(_mm_set1_epi32(cell), _mm_setr_epi32(0, 1, 2, 3));
+        const __m128i *at = (const __m128i *)(intent + cell);
+
+        // From the highest neighbour index to the lowest, so the lowest wins
+        __m128i winner = _mm_set1_epi32(-1);
+        winner = select_sse2(_mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)((const int32_t *)at + width)), cells),
+                             _mm_add_epi32(cells, _mm_set1_epi32(width)), winner);
+        winner = select_sse2(_mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)((const int32_t *)at + 1)), cells),
+                             _mm_add_epi32(cells, _mm_set1_epi32(1)), winner);
+        winner = select_sse2(_mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)((const int32_t *)at - 1)), cells),
+                             _mm_sub_epi32(cells, _mm_set1_epi32(1)), winner);
+        winner = select_sse2(_mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)((const int32_t *)at - width)), cells),
+                             _mm_sub_epi32(cells, _mm_set1_epi32(width)), winner);
+        _mm_storeu_si128((__m128i *)(job.winner + cell), winner);
+    }
+    return resolve_row_scalar(row, column, last_column);
+}
+
+/**
+ * Function: write_row_sse2
+ * ------------------------
+ * Third phase on four inner cells at a time, with SSE2: a cell with a winner
+ * becomes an alien, a cell whose alien won a neighbour becomes free, and the
+ * four results are narrowed back to bytes.
+ */
+__attribute__((target("sse2"))) static int write_row_sse2(int row, int first_column, int last_column)
+{
+    const int width = job.width;
+    const int32_t *winners = job.winner;
+    int moved = 0;
+
+    int column = first_column;
+    for (; column + 4 <= last_column; column += 4)
+    {
+        int cell = row * width + column;
+        __m128i cells = _mm_add_epi32(_mm_set1_epi32(cell), _mm_setr_epi32(0, 1, 2, 3));
+
+        __m128i arrives = _mm_cmpgt_epi32(_mm_loadu_si128((const __m128i *)(winners + cell)), _mm_set1_epi32(-1));
+        __m128i leaves = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(winners + cell - width)), cells),
+                         _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(winners + cell + width)), cells)),
+            _mm_or_si128(_mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(winners + cell - 1)), cells),
+                         _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(winners + cell + 1)), cells)));
+
+        __m128i value = select_sse2(arrives, _mm_set1_epi32(CELL_ALIEN),
+                                    select_sse2(leaves, _mm_set1_epi32(CELL_FREE), load4_sse2(job.current + cell)));
+        __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(value, value), _mm_setzero_si128());
+        int32_t packed = _mm_cvtsi128_si32(bytes);
+        memcpy(job.next + cell, &packed, sizeof(packed));
+        moved += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(arrives)));
+    }
+    return moved + write_row_scalar(row, column, last_column);
+}
+
+#define LOAD8_AVX2(cells) _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(cells)))
+#define LOAD8X32_AVX2(values) _mm256_loadu_si256((const __m256i *)(values))
+
+/**
+ * Function: intent_row_avx2
+ * -------------------------
+ * Same as intent_row_sse2, eight cells at a time with AVX2.
+ */
+__attribute__((target("avx2"))) static int intent_row_avx2(int row, int first_column, int last_column)
+{
+    const int width = job.width;
+    const uint32_t base = job.seed ^ (job.step * 0x9e3779b9u);
+    const __m256i minus_one = _mm256_set1_epi32(-1);
+
+    int column = first_column;
+    for (; column + 8 <= last_column; column += 8)
+    {
+        int cell = row * width + column;
+        __m256i cells = _mm256_add_epi32(_mm256_set1_epi32(cell), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+
+        __m256i x = _mm256_xor_si256(_mm256_set1_epi32((int)base), _mm256_mullo_epi32(cells, _mm256_set1_epi32((int)0x85ebca6bu)));
+        x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+        x = _mm256_mullo_epi32(x, _mm256_set1_epi32(0x7feb352d));
+        x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 15));
+        x = _mm256_mullo_epi32(x, _mm256_set1_epi32((int)0x846ca68bu));
+        x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+        __m256i direction = _mm256_srli_epi32(x, 30);
+
+        __m256i up = _mm256_cmpeq_epi32(direction, _mm256_set1_epi32(0));
+        __m256i down = _mm256_cmpeq_epi32(direction, _mm256_set1_epi32(1));
+        __m256i left = _mm256_cmpeq_epi32(direction, _mm256_set1_epi32(2));
+        __m256i vertical = _mm256_or_si256(up, down);
+
+        const uint8_t *current = job.current + cell;
+        __m256i target_value = _mm256_blendv_epi8(
+            _mm256_blendv_epi8(LOAD8_AVX2(current + 1), LOAD8_AVX2(current - 1), left),
+            _mm256_blendv_epi8(LOAD8_AVX2(current + width), LOAD8_AVX2(current - width), up),
+            vertical);
+        __m256i offset = _mm256_blendv_epi8(
+            _mm256_blendv_epi8(_mm256_set1_epi32(1), minus_one, left),
+            _mm256_blendv_epi8(_mm256_set1_epi32(width), _mm256_set1_epi32(-width), up),
+            vertical);
+
+        __m256i moves = _mm256_and_si256(_mm256_cmpeq_epi32(LOAD8_AVX2(current), _mm256_set1_epi32(CELL_ALIEN)),
+                                         _mm256_cmpeq_epi32(target_value, _mm256_set1_epi32(CELL_FREE)));
+        _mm256_storeu_si256((__m256i *)(job.intent + cell), _mm256_blendv_epi8(minus_one, _mm256_add_epi32(cells, offset), moves));
+    }
+    return intent_row_scalar(row, column, last_column);
+}
+
+/**
+ * Function: resolve_row_avx2
+ * --------------------------
+ * Same as resolve_row_sse2, eight cells at a time with AVX2.
+ */
+__attribute__((target("avx2"))) static int resolve_row_avx2(int row, int first_column, int last_column)
+{
+    const int width = job.width;
+    const int32_t *intent = job.intent;
+
+    int column = first_column;
+    for (; column + 8 <= last_column; column += 8)
+    {
+        int cell = row * width + column;
+        __m256i cells = _mm256_add_epi32(_mm256_set1_epi32(cell), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+
+        __m256i winner = _mm256_set1_epi32(-1);
+        winner = _mm256_blendv_epi8(winner, _mm256_add_epi32(cells, _mm256_set1_epi32(width)),
+                                    _mm256_cmpeq_epi32(LOAD8X32_AVX2(intent + cell + width), cells));
+        winner = _mm256_blendv_epi8(winner, _mm256_add_epi32(cells, _mm256_set1_epi32(1)),
+                                    _mm256_cmpeq_epi32(LOAD8X32_AVX2(intent + cell + 1), cells));
+        winner = _mm256_blendv_epi8(winner, _mm256_sub_epi32(cells, _mm256_set1_epi32(1)),
+                                    _mm256_cmpeq_epi32(LOAD8X32_AVX2(intent + cell - 1), cells));
+        winner = _mm256_blendv_epi8(winner, _mm256_sub_epi32(cells, _mm256_set1_epi32(width)),
+                                    _mm256_cmpeq_epi32(LOAD8X32_AVX2(intent + cell - width), cells));
+        _mm256_storeu_si256((__m256i *)(job.winner + cell), winner);
+    }
+    return resolve_row_scalar(row, column, last_column);
+}
+
+/**
+ * Function: write_row_avx2
+ * ------------------------
+ * Same as write_row_sse2, eight cells at a time with AVX2.
+ */
+__attribute__((target("avx2"))) static int write_row_avx2(int row, int first_column, int last_column)
+{
+    const int width = job.width;
+    const int32_t *winners = job.winner;
+    int moved = 0;
+
+    int column = first_column;
+    for (; column + 8 <= last_column; column += 8)
+    {
+        int cell = row * width + column;
+        __m256i cells = _mm256_add_epi32(_mm256_set1_epi32(cell), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+
+        __m256i arrives = _mm256_cmpgt_epi32(LOAD8X32_AVX2(winners + cell), _mm256_set1_epi32(-1));
+        __m256i leaves = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi32(LOAD8X32_AVX2(winners + cell - width), cells),
+                            _mm256_cmpeq_epi32(LOAD8X32_AVX2(winners + cell + width), cells)),
+            _mm256_or_si256(_mm256_cmpeq_epi32(LOAD8X32_AVX2(winners + cell - 1), cells),
+                            _mm256_cmpeq_epi32(LOAD8X32_AVX2(winners + cell + 1), cells)));
+
+        __m256i value = _mm256_blendv_epi8(_mm256_blendv_epi8(LOAD8_AVX2(job.current + cell), _mm256_set1_epi32(CELL_FREE), leaves),
+                                           _mm256_set1_epi32(CELL_ALIEN), arrives);
+        __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(value), _mm256_extracti128_si256(value, 1));
+        _mm_storel_epi64((__m128i *)(job.next + cell), _mm_packus_epi16(words, words));
+        moved += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(arrives)));
+    }
+    return moved + write_row_scalar(row, column, last_column);
+}
+
+#endif // ALIEN_SIMD
+
+/**
+ * Struct: alien_kernels
+ * ---------------------
+ * The implementations of the three phases of the step, best first.
+ */
+typedef int (*row_function_t)(int row, int first_column, int last_column);
+static const struct
+{
+    const char *name;
+    row_function_t intent, resolve, write;
+} alien_kernels[] = {
+#ifdef ALIEN_SIMD
+    {"avx2", intent_row_avx2, resolve_row_avx2, write_row_avx2},
+    {"sse2", intent_row_sse2, resolve_row_sse2, write_row_sse2},
+#endif
+    {"scalar", intent_row_scalar, resolve_row_scalar, write_row_scalar}};
+
+static int kernel = -1; // Index in alien_kernels, -1 until one is selected
+
+/**
+ * Function: kernel_supported
+ * --------------------------
+ * Returns true if the CPU can run a kernel of alien_kernels.
+ */
+static bool kernel_supported(const char *name)
+{
+#ifdef ALIEN_SIMD
+    __builtin_cpu_init();
+    if (strcmp(name, "avx2") == 0)
+        return __builtin_cpu_supports("avx2");
+    if (strcmp(name, "sse2") == 0)
+        return __builtin_cpu_supports("sse2");
+#endif
+    return strcmp(name, "scalar") == 0;
+}
+
+/**
+ * Function: alien_kernel_select
+ * -----------------------------
+ * Chooses the implementation of the step.
+ *
+ * name: "avx2", "sse2" or "scalar", or NULL for the best the CPU supports.
+ *
+ * All kernels give the same grid. Returns false if the kernel is unknown or
+ * the CPU cannot run it; the selection is then unchanged.
+ */
+bool alien_kernel_select(const char *name)
+{
+    for (int i = 0; i < (int)(sizeof(alien_kernels) / sizeof(alien_kernels[0])); i++)
+    {
+        if ((name == NULL || strcmp(name, alien_kernels[i].name) == 0) && kernel_supported(alien_kernels[i].name))
+        {
+            kernel = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Function: alien_kernel_name
+ * ---------------------------
+ * Returns the name of the kernel in use, selecting the best one if none is.
+ */
+const char *alien_kernel_name(void)
+{
+    if (kernel < 0)
+    {
+        alien_kernel_select(NULL);
+    }
+    return alien_kernels[kernel].name;
+}
+
+/**
+ * Function: run_rows
+ * ------------------
+ * Runs one phase over the rows of a tile: the kernel on the inner cells of
+ * each row, the scalar function on the cells at the edges of the grid.
+ *
+ * Returns the sum of what the row functions return.
+ */
+static int run_rows(int first_row, int last_row, row_function_t scalar, row_function_t inner)
+{
+    const int width = job.width, height = job.height;
+    int total = 0;
+
+    for (int row = first_row; row < last_row; row++)
+    {
+        if (row == 0 || row == height - 1 || width < 3)
+        {
+            total += scalar(row, 0, width);
+            continue;
+        }
+        total += scalar(row, 0, 1);
+        total += inner(row, 1, width - 1);
+        total += scalar(row, width - 1, width);
+    }
+    return total;
+}
+
+/**
+ * Function: phase_intent / phase_resolve / phase_write
+ * ----------------------------------------------------
+ * The three phases of the step over a tile, with the selected kernel.
+ */
+static void phase_intent(int first_row, int last_row)
+{
+    run_rows(first_row, last_row, intent_row_scalar, alien_kernels[kernel].intent);
+}
+
+static void phase_resolve(int first_row, int last_row)
+{
+    run_rows(first_row, last_row, resolve_row_scalar, alien_kernels[kernel].resolve);
+}
+
+static void phase_write(int first_row, int last_row)
+{
+    int moved = run_rows(first_row, last_row, write_row_scalar, alien_kernels[kernel].write);
+    atomic_fetch_add_explicit(&job.moved, moved, memory_order_relaxed);
+}
+
+/**
+ * Function: run_tiles
+ * -------------------
+ * Takes tiles of the current phase until there are none left.
+ */
+static void run_tiles(void)
+{
+    int tile;
+    while ((tile = atomic_fetch_add(&next_tile, 1)) < tiles)
+    {
+        int first_row = tile * ALIEN_TILE_ROWS;
+        int last_row = first_row + ALIEN_TILE_ROWS < job.height ? first_row + ALIEN_TILE_ROWS : job.height;
+        phase(first_row, last_row);
+    }
+}
+
+/**
+ * Function: pool_worker
+ * ---------------------
+ * Thread function of the workers of the pool.
+ *
+ * arg: Unused.
+ */
+static void *pool_worker(void *arg)
+{
+    (void)arg;
+    unsigned int seen = 0;
+
+    pthread_mutex_lock(&pool_mutex);
+    while (1)
+    {
+        while (generation == seen && !stopping)
+        {
+            pthread_cond_wait(&work_cond, &pool_mutex);
+        }
+        if (stopping)
+        {
+            break;
+        }
+        seen = generation;
+        pthread_mutex_unlock(&pool_mutex);
+
+        run_tiles();
+
+        pthread_mutex_lock(&pool_mutex);
+        if (--busy == 0)
+        {
+            pthread_cond_signal(&done_cond);
+        }
+    }
+    pthread_mutex_unlock(&pool_mutex);
+    return NULL;
+}
+
+/**
+ * Function: run_phase
+ * -------------------
+ * Runs one phase over every tile of the grid and waits for it to finish.
+ *
+ * function: The phase.
+ *
+ * The caller takes tiles too. With no workers, or a single tile, the phase
+ * runs on the caller alone.
+ */
+static void run_phase(void (*function)(int first_row, int last_row))
+{
+    phase = function;
+    tiles = (job.height + ALIEN_TILE_ROWS - 1) / ALIEN_TILE_ROWS;
+    atomic_store(&next_tile, 0);
+
+    if (workers_count == 0 || tiles == 1)
+    {
+        run_tiles();
+        return;
+    }
+
+    pthread_mutex_lock(&pool_mutex);
+    busy = workers_count;
+    generation++;
+    pthread_cond_broadcast(&work_cond);
+    pthread_mutex_unlock(&pool_mutex);
+
+    run_tiles();
+
+    pthread_mutex_lock(&pool_mutex);
+    while (busy > 0)
+    {
+        pthread_cond_wait(&done_cond, &pool_mutex);
+    }
+    pthread_mutex_unlock(&pool_mutex);
+}
+
+/**
+ * Function: alien_pool_start
+ * --------------------------
+ * Starts the threads that alien_grid_step shares its tiles with.
+ *
+ * threads: Threads working on a step, the caller included, up to
+ *          ALIEN_MAX_THREADS. 1 keeps the step on the caller.
+ */
+void alien_pool_start(int threads)
+{
+    if (threads > ALIEN_MAX_THREADS)
+    {
+        threads = ALIEN_MAX_THREADS;
+    }
+    stopping = false;
+    for (int i = 0; i < threads - 1; i++)
+    {
+        if (pthread_create(&workers[i], NULL, pool_worker, NULL) != 0)
+        {
+            perror("Alien thread creation failed");
+            exit(EXIT_FAILURE);
+        }
+        workers_count++;
+    }
+}
+
+/**
+ * Function: alien_pool_stop
+ * -------------------------
+ * Stops the threads of the pool. Steps after this run on the caller.
+ */
+void alien_pool_stop(void)
+{
+    pthread_mutex_lock(&pool_mutex);
+    stopping = true;
+    pthread_cond_broadcast(&work_cond);
+    pthread_mutex_unlock(&pool_mutex);
+
+    for (int i = 0; i < workers_count; i++)
+    {
+        pthread_join(workers[i], NULL);
+    }
+    workers_count = 0;
+}
+
+/**
+ * Function: alien_grid_step
+ * -------------------------
+ * Moves every alien of a grid at most once.
+ *
+ * current: The grid before the step, width * height cells in row-major order.
+ * next: Where the grid after the step is written. Must not overlap current.
+ * width, height: The size of the grid.
+ * seed: The seed of the match.
+ * step: The number of the step, so every step draws new directions.
+ *
+ * Each alien picks one of the four directions and moves if the cell that way
+ * is free in current. When several aliens pick the same cell, the one with
+ * the lowest index gets it. Aliens never move into a cell vacated in the
+ * same step, so the result does not depend on the order cells are visited,
+ * and the grid is split into tiles of ALIEN_TILE_ROWS rows computed on the
+ * pool. All three phases use the kernel chosen by alien_kernel_select on the
+ * inner cells; the border cells of the grid go through the scalar code.
+ * Returns the number of aliens that moved.
+ */
+int alien_grid_step(const uint8_t *current, uint8_t *next, int width, int height, uint32_t seed, uint32_t step)
+{
+    int cells = width * height;
+    if (cells > scratch_cells)
+    {
+        free(job.intent);
+        free(job.winner);
+        job.intent = malloc(cells * sizeof(int32_t));
+        job.winner = malloc(cells * sizeof(int32_t));
+        scratch_cells = cells;
+    }
+
+    job.current = current;
+    job.next = next;
+    job.width = width;
+    job.height = height;
+    job.seed = seed;
+    job.step = step;
+    atomic_store(&job.moved, 0);
+
+    if (kernel < 0)
+    {
+        alien_kernel_select(NULL);
+    }
+    run_phase(phase_intent);
+    run_phase(phase_resolve);
+    run_phase(phase_write);
+    return atomic_load(&job.moved);
+}
@@ -0,0 +1,21 @@
+#ifndef __ALIEN_STEP_H_INCLUDED__
+#define __ALIEN_STEP_H_INCLUDED__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ALIEN_TILE_ROWS 16    // Rows of the grid handled by one task of the pool
+#define ALIEN_MAX_THREADS 64  // Threads of the pool, the caller included
+
+// Contents of a cell of an alien grid
+#define CELL_FREE 0
+#define CELL_ALIEN 1
+#define CELL_BLOCKED 2 // Anything else: a zap, a player, a wall
+
+bool alien_kernel_select(const char *name);
+const char *alien_kernel_name(void);
+void alien_pool_start(int threads);
+void alien_pool_stop(void);
+int alien_grid_step(const uint8_t *current, uint8_t *next, int width, int height, uint32_t seed, uint32_t step);
+
+#endif // __ALIEN_STEP_H_INCLUDED__
@@ -0,0 +1,28 @@
+#include <zmq.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "bot-swarm.h"
+
+/**
+ * Function: main
+ * --------------
+ * Entry point of the bot client: plays astronaut sessions against a running
+ * server and reports the round trip times of the commands and what the
+ * headless subscribers received. The same swarm runs inside the server with
+ * its --bots option.
+ */
+int main(int argc, char *argv[])
+{
+    bot_config_t config;
+    swarm_default_config(&config);
+    if (!swarm_parse_options(argc, argv, &config))
+    {
+        swarm_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    void *context = zmq_ctx_new();
+    swarm_run(context, &config);
+    zmq_ctx_destroy(context);
+    return 0;
+}
@@ -4,9 +4,11 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <ctype.h>
+#include <getopt.h>
 #include "zhelpers.h"
 #include "remote-char.h"
 #include "common.h"
+#include "input-coalescer.h"
 
 /**
  * Function: processKeyBoard
@@ -53,13 +55,44 @@ void processKeyBoard(int key, remote_char_t *m)
     }
 }
 
-int main()
+int main(int argc, char *argv[])
 {
+    const char *commands = COMMANDS_ENDPOINT;
+    int max_rate = INPUT_DEFAULT_RATE;
+    static struct option long_options[] = {
+        {"commands", required_argument, NULL, 'c'},
+        {"max-rate", required_argument, NULL, 'r'},
+        {NULL, 0, NULL, 0}};
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'c':
+            commands = optarg;
+            break;
+        case 'r':
+            max_rate = atoi(optarg);
+            if (max_rate >= 1)
+            {
+                break;
+            }
+            // fall through
+        default:
+            fprintf(stderr, "Usage: %s [--commands ENDPOINT] [--max-rate N]\n"
+                            "  --commands E  endpoint of the server commands (default: %s)\n"
+                            "  --max-rate N  sends per second at most; the keys in between are merged (default: %d)\n",
+                    argv[0], COMMANDS_ENDPOINT, INPUT_DEFAULT_RATE);
+            return EXIT_FAILURE;
+        }
+    }
+
     // Initialize ZeroMQ context and socket
     void *context = NULL;
-    void *requester = initialize_zmq_socket(&context, ZMQ_REQ, "ipc:///tmp/s1", false);
+    void *requester = initialize_zmq_socket(&context, ZMQ_REQ, commands, false);
+    enable_request_retries(requester); // Survives a restart of the server
 
-    remote_char_t m, response;
+    remote_char_t m = {0}, response;
     m.msg_type = 0;
 
     send_message(requester, &m, sizeof(m));
@@ -83,25 +116,28 @@ int main()
     noecho();             /* Don't echo() while we do getch */
     curs_set(0);          // Hide the cursor
 
+    // Held keys repeat much faster than a player can follow; they are merged and sent at most max_rate times per second
+    input_coalescer_t coalescer;
+    coalescer_init(&coalescer, requester, &response, max_rate);
+
     int key;
     do
     {
+        timeout(coalescer_wait_ms(&coalescer)); // Wakes up when the merged keys are due
         key = getch();
         processKeyBoard(key, &m);
-
-        if (m.msg_type != -1)
-        {
-            send_message(requester, &m, sizeof(m));
-            receive_message(requester, &m, sizeof(m));
-        }
+        coalescer_add(&coalescer, &m);
 
         if (key == 'q')
         {
+            coalescer_leave(&coalescer); // Leave the game
+
             // Disconnect from the server
             zmq_close(requester);
             zmq_ctx_destroy(context);
             endwin(); /* End curses mode		  */
             exit(0);
         }
+        coalescer_flush(&coalescer, false);
     } while (key != 27);
 }
@@ -5,9 +5,11 @@
 #include <unistd.h>
 #include <ctype.h>
 #include <pthread.h>
+#include <getopt.h>
 #include "zhelpers.h"
 #include "remote-char.h"
 #include "common.h"
+#include "input-coalescer.h"
 
 typedef struct disp_info
 {
@@ -20,6 +22,8 @@ time_t last_move_time = 0;
 
 pthread_mutex_t mutex;
 
+const char *frames_endpoint = FRAMES_ENDPOINT; // Publisher of the frames, the server or a relay
+
 /**
  * Function: processKeyBoard
  * -------------------------
@@ -65,40 +69,20 @@ void processKeyBoard(int key, remote_char_t *m)
     }
 }
 
-/**
- * Function: deserialize_window
- * ----------------------------
- * Deserializes a buffer into the content of a window.
- *
- * win: A pointer to the window to be updated.
- * buffer: A buffer containing the serialized content of the window.
- *
- * This function does not return a value.
- */
-void deserialize_window(WINDOW **win, char *buffer)
-{
-    int rows, cols;
-    getmaxyx(*win, rows, cols);
-    for (int y = 1; y < rows - 1; y++)
-    {
-        for (int x = 1; x < cols - 1; x++)
-        {
-            mvwaddch(*win, y, x, buffer[y * cols + x]);
-        }
-    }
-}
-
 /**
  * Function: display
  * -----------------
  * Thread function that displays the content of the windows.
  *
- * arg: Argument passed to the thread.
+ * arg: Pointer to a bool, true to render only the newest frame received and
+ *      skip the ones queued behind it.
  *
  * This function does not return a value.
  */
 void *display(void *arg)
 {
+    bool conflate = *(bool *)arg;
+
     // Initialize ncurses and create windows
     initscr();
     keypad(stdscr, TRUE);
@@ -108,6 +92,7 @@ void *display(void *arg)
     WINDOW *numbers = newwin(BOARD_HEIGHT + 3, BOARD_WIDTH + 3, 0, 0); // +3 to include borders and coordinate numbers
     WINDOW *board_win = derwin(numbers, BOARD_HEIGHT + 2, BOARD_WIDTH + 2, 1, 1);
     WINDOW *score_win = newwin(BOARD_HEIGHT + 2, SCORE_WIDTH, 1, BOARD_WIDTH + 4);
+    WINDOW *status_win = newwin(1, BOARD_WIDTH + 4 + SCORE_WIDTH, BOARD_HEIGHT + 3, 0); // Frames skipped and dropped
 
     // Draw initial board structure
     draw_board(numbers);
@@ -117,39 +102,93 @@ void *display(void *arg)
     wrefresh(score_win);
 
     void *context = NULL;
-    void *subscriber = initialize_zmq_socket(&context, ZMQ_SUB, "tcp://localhost:5555", false);
-    zmq_setsockopt(subscriber, ZMQ_SUBSCRIBE, "", 0);
+    void *subscriber = initialize_zmq_socket(&context, ZMQ_SUB, frames_endpoint, false);
+    frame_stream_t stream;
+    subscribe_frames(&stream, subscriber);
 
     int score_rows, score_cols;
     getmaxyx(score_win, score_rows, score_cols);
     char score_buffer[score_rows * score_cols];
+    char *last_score = calloc(score_rows * score_cols, 1); // The frames on screen, to draw only what changed
 
     int board_rows, board_cols;
     getmaxyx(board_win, board_rows, board_cols);
     char board_buffer[board_rows * board_cols];
+    char *last_board = calloc(board_rows * board_cols, 1);
 
     curs_set(0);
     while (1)
     {
+        long dropped = stream.dropped;
+        bool keyframes_only = stream.keyframes_only;
+        int skipped = receive_frame(&stream, score_buffer, score_rows * score_cols, board_buffer, board_rows * board_cols, conflate);
+        if (skipped > 0 || stream.dropped != dropped || stream.keyframes_only != keyframes_only) // Also when promoted back
+        {
+            mvwprintw(status_win, 0, 0, "skipped %ld, dropped %ld%s", stream.skipped, stream.dropped,
+                      stream.keyframes_only ? ", keyframes only" : "");
+            wclrtoeol(status_win);
+            wnoutrefresh(status_win);
+        }
 
-        zmq_recv(subscriber, score_buffer, score_rows * score_cols, 0);
-        zmq_recv(subscriber, board_buffer, board_rows * board_cols, 0);
-
-        deserialize_window(&score_win, score_buffer);
-        deserialize_window(&board_win, board_buffer);
+        deserialize_window(score_win, score_buffer, last_score);
+        deserialize_window(board_win, board_buffer, last_board);
 
-        wrefresh(score_win);
-        wrefresh(board_win);
+        // One terminal update for all windows
+        wnoutrefresh(score_win);
+        wnoutrefresh(board_win);
+        doupdate();
     }
 }
 
-int main()
+int main(int argc, char *argv[])
 {
+    static bool conflate = false;
+    const char *commands = COMMANDS_ENDPOINT;
+    int max_rate = INPUT_DEFAULT_RATE;
+    static struct option long_options[] = {
+        {"conflate", no_argument, NULL, 'C'},
+        {"commands", required_argument, NULL, 'c'},
+        {"frames", required_argument, NULL, 'f'},
+        {"max-rate", required_argument, NULL, 'r'},
+        {NULL, 0, NULL, 0}};
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'C':
+            conflate = true;
+            break;
+        case 'c':
+            commands = optarg;
+            break;
+        case 'f':
+            frames_endpoint = optarg;
+            break;
+        case 'r':
+            max_rate = atoi(optarg);
+            if (max_rate >= 1)
+            {
+                break;
+            }
+            // fall through
+        default:
+            fprintf(stderr, "Usage: %s [--conflate] [--commands ENDPOINT] [--frames ENDPOINT] [--max-rate N]\n"
+                            "  --conflate    render only the newest frame, skipping frames queued behind it\n"
+                            "  --commands E  endpoint of the server commands (default: %s)\n"
+                            "  --frames E    endpoint of the frames, of the server or of a relay (default: %s)\n"
+                            "  --max-rate N  sends per second at most; the keys in between are merged (default: %d)\n",
+                    argv[0], COMMANDS_ENDPOINT, FRAMES_ENDPOINT, INPUT_DEFAULT_RATE);
+            return EXIT_FAILURE;
+        }
+    }
+
     // Initialize ZeroMQ context and socket
     void *context = NULL;
-    void *requester = initialize_zmq_socket(&context, ZMQ_REQ, "ipc:///tmp/s1", false);
+    void *requester = initialize_zmq_socket(&context, ZMQ_REQ, commands, false);
+    enable_request_retries(requester); // Survives a restart of the server
 
-    remote_char_t m, response;
+    remote_char_t m = {0}, response;
     m.msg_type = 0;
 
     send_message(requester, &m, sizeof(m));
@@ -180,24 +219,25 @@ int main()
     }
 
     pthread_t display_thread;
-    pthread_create(&display_thread, NULL, display, NULL);
+    pthread_create(&display_thread, NULL, display, &conflate);
 
     curs_set(0); // Hide the cursor
 
+    // Held keys repeat much faster than a player can follow; they are merged and sent at most max_rate times per second
+    input_coalescer_t coalescer;
+    coalescer_init(&coalescer, requester, &response, max_rate);
+
     int key;
     do
     {
+        timeout(coalescer_wait_ms(&coalescer)); // Wakes up when the merged keys are due
         key = getch();
         processKeyBoard(key, &m);
-
-        if (m.msg_type != -1)
-        {
-            send_message(requester, &m, sizeof(m));
-            receive_message(requester, &m, sizeof(m));
-        }
+        coalescer_add(&coalescer, &m);
 
         if (key == 'q')
         {
+            coalescer_leave(&coalescer); // Leave the game
 
             // destroy the thread
             pthread_cancel(display_thread);
@@ -208,5 +248,6 @@ int main()
             endwin(); /* End curses mode		  */
             exit(0);
         }
+        coalescer_flush(&coalescer, false);
     } while (key != 27); // Continue while the key pressed is not ESC (code 27)
 }
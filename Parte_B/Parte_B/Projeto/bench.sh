@@ -0,0 +1,54 @@
+#!/bin/sh
+# End-to-end benchmark of the game server.
+#
+# Starts a headless server, drives it with bots while headless subscribers
+# count the published frames, and writes the results as JSON. Settings are
+# taken from the environment:
+#   BOTS (8), SUBSCRIBERS (4), DURATION seconds (10), MOVE_RATE (20),
+#   FIRE_RATE (0.5), STRATEGY (random), OUTPUT (bench-results.json)
+
+BOTS=${BOTS:-8}
+SUBSCRIBERS=${SUBSCRIBERS:-4}
+DURATION=${DURATION:-10}
+MOVE_RATE=${MOVE_RATE:-20}
+FIRE_RATE=${FIRE_RATE:-0.5}
+STRATEGY=${STRATEGY:-random}
+OUTPUT=${OUTPUT:-bench-results.json}
+BOT_REPORT=$(mktemp)
+
+./server --headless --seed 1 &
+SERVER=$!
+trap 'kill $SERVER 2>/dev/null; rm -f $BOT_REPORT' EXIT
+sleep 1
+if ! kill -0 $SERVER 2>/dev/null; then
+    echo "The server did not start" >&2
+    exit 1
+fi
+
+# Server CPU time in clock ticks (user + system), from /proc
+server_cpu() {
+    awk '{ print $14 + $15 }' /proc/$SERVER/stat
+}
+
+cpu_before=$(server_cpu)
+./bot --bots "$BOTS" --subscribers "$SUBSCRIBERS" --duration "$DURATION" \
+    --move-rate "$MOVE_RATE" --fire-rate "$FIRE_RATE" --strategy "$STRATEGY" \
+    --json "$BOT_REPORT" || exit 1
+cpu_after=$(server_cpu)
+
+cpu_seconds=$(awk -v t="$((cpu_after - cpu_before))" -v hz="$(getconf CLK_TCK)" 'BEGIN { printf "%.2f", t / hz }')
+elapsed=$(awk -F': ' '/"elapsed_s"/ { sub(",", "", $2); print $2 }' "$BOT_REPORT")
+cpu_percent=$(awk -v c="$cpu_seconds" -v e="$elapsed" 'BEGIN { printf "%.1f", 100 * c / e }')
+
+{
+    echo "{"
+    echo "  \"config\": {\"bots\": $BOTS, \"subscribers\": $SUBSCRIBERS, \"duration_s\": $DURATION, \"move_rate\": $MOVE_RATE, \"fire_rate\": $FIRE_RATE, \"strategy\": \"$STRATEGY\"},"
+    echo "  \"server_cpu_s\": $cpu_seconds,"
+    echo "  \"server_cpu_percent\": $cpu_percent,"
+    printf '  "client": '
+    sed '1!s/^/  /' "$BOT_REPORT"
+    echo "}"
+} > "$OUTPUT"
+
+echo "server CPU: ${cpu_seconds}s (${cpu_percent}%)"
+echo "results written to $OUTPUT"
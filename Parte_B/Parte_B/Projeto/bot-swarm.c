@@ -0,0 +1,676 @@
+#include <zmq.h>
+#include <arpa/inet.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <getopt.h>
+#include <ncurses.h>
+#include "zhelpers.h"
+#include "remote-char.h"
+#include "common.h"
+#include "bot-swarm.h"
+
+/**
+ * Struct: bot_t
+ * -------------
+ * The state and results of one bot.
+ *
+ * id: Index of the bot, also used to seed its random number generator.
+ * config: Pointer to the settings of the swarm.
+ * context: The ZeroMQ context shared by all bots.
+ * full: True if the server answered the join with "FULL".
+ * ch: The character assigned by the server.
+ * latencies: Round trip time of every command, in microseconds, by msg_type.
+ * counts, capacities: Number of entries used and allocated in each latencies array.
+ */
+typedef struct bot_t
+{
+    int id;
+    bot_config_t *config;
+    void *context;
+    bool full;
+    char ch;
+    int64_t *latencies[4];
+    size_t counts[4];
+    size_t capacities[4];
+} bot_t;
+
+/**
+ * Struct: subscriber_t
+ * --------------------
+ * A headless display, counting what the server publishes.
+ *
+ * context: The ZeroMQ context shared by all threads.
+ * endpoint: The endpoint the frames are published on.
+ * frame_messages, frame_bytes: Window buffers received (two per frame) and their size.
+ * frames_dropped: Frames the server dropped for this subscriber, from the gaps
+ *                 in the sequence numbers.
+ * last_seq: Sequence number of the last frame received, 0 before the first.
+ * score_messages, score_bytes: "scores" protobuf messages received and their size.
+ */
+typedef struct subscriber_t
+{
+    void *context;
+    const char *endpoint;
+    uint64_t frame_messages;
+    uint64_t frame_bytes;
+    uint64_t frames_dropped;
+    uint32_t last_seq;
+    uint64_t score_messages;
+    uint64_t score_bytes;
+} subscriber_t;
+
+/**
+ * Struct: latency_summary_t
+ * -------------------------
+ * Round trip times of one type of command, in microseconds.
+ */
+typedef struct latency_summary_t
+{
+    size_t count;
+    int64_t p50, p99, p999, max;
+} latency_summary_t;
+
+// Set when the bots are done, to stop the subscribers
+static volatile bool stop_subscribers = false;
+
+/**
+ * Function: now_us
+ * ----------------
+ * Returns a monotonic timestamp in microseconds.
+ */
+static int64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**
+ * Function: add_latency
+ * ---------------------
+ * Stores the round trip time of one command.
+ *
+ * bot: The bot that sent the command.
+ * msg_type: The type of the command (0 - join, 1 - move, 2 - fire, 3 - leave).
+ * latency: The round trip time, in microseconds.
+ */
+static void add_latency(bot_t *bot, int msg_type, int64_t latency)
+{
+    if (bot->counts[msg_type] == bot->capacities[msg_type])
+    {
+        bot->capacities[msg_type] = bot->capacities[msg_type] ? bot->capacities[msg_type] * 2 : 256;
+        bot->latencies[msg_type] = realloc(bot->latencies[msg_type], bot->capacities[msg_type] * sizeof(int64_t));
+    }
+    bot->latencies[msg_type][bot->counts[msg_type]++] = latency;
+}
+
+/**
+ * Function: send_command
+ * ----------------------
+ * Sends a command to the server, waits for the reply and records the round trip time.
+ *
+ * bot: The bot sending the command.
+ * requester: The bot's REQ socket.
+ * m: The command. It is overwritten by the reply.
+ */
+static void send_command(bot_t *bot, void *requester, remote_char_t *m)
+{
+    int msg_type = m->msg_type;
+    int64_t start = now_us();
+    if (msg_type == 0)
+    {
+        // A join sent twice would open two sessions
+        send_message(requester, m, sizeof(*m));
+        receive_message(requester, m, sizeof(*m));
+    }
+    else
+    {
+        send_request(requester, m, sizeof(*m), m, sizeof(*m));
+    }
+    add_latency(bot, msg_type, now_us() - start);
+}
+
+/**
+ * Function: is_vertical_area
+ * --------------------------
+ * Returns true if the area of the given character is a column of the board,
+ * where players move up and down; the other areas are rows.
+ */
+static bool is_vertical_area(char ch)
+{
+    return ch == 'A' || ch == 'D' || ch == 'F' || ch == 'H';
+}
+
+/**
+ * Function: run_bot
+ * -----------------
+ * Thread function that plays one astronaut session.
+ *
+ * arg: Pointer to the bot_t of the bot.
+ *
+ * The bot joins, then moves and fires at the configured rates until the
+ * duration has passed, and leaves. If the server is full, the bot stops
+ * right after the join.
+ */
+static void *run_bot(void *arg)
+{
+    bot_t *bot = (bot_t *)arg;
+    bot_config_t *config = bot->config;
+    unsigned int seed = (unsigned int)(time(NULL) ^ (bot->id * 2654435761u));
+    void *requester = zmq_socket(bot->context, ZMQ_REQ);
+    enable_request_retries(requester);
+    if (zmq_connect(requester, config->commands_endpoint) != 0)
+    {
+        perror("Error connecting to the server");
+        exit(1);
+    }
+
+    remote_char_t m = {0}, join;
+    m.msg_type = 0;
+    send_command(bot, requester, &m);
+    join = m;
+    if (strcmp(join.ticket, "FULL") == 0)
+    {
+        bot->full = true;
+        zmq_close(requester);
+        return NULL;
+    }
+    bot->ch = join.ch;
+
+    // Spread the bots over the first period so they don't all send at once
+    int64_t start = now_us();
+    int64_t end = start + config->duration_ms * 1000;
+    int64_t move_period = config->move_rate > 0 ? (int64_t)(1000000 / config->move_rate) : 0;
+    int64_t fire_period = config->fire_rate > 0 ? (int64_t)(1000000 / config->fire_rate) : 0;
+    int64_t next_move = move_period ? start + rand_r(&seed) % move_period : end;
+    int64_t next_fire = fire_period ? start + rand_r(&seed) % fire_period : end;
+    if (config->strategy == STRATEGY_CAMPER)
+    {
+        next_move = end;
+    }
+
+    uint32_t seq = 0; // Number of the last request of the session
+    direction_t sweep_direction = is_vertical_area(bot->ch) ? UP : LEFT;
+    int sweep_steps = 0;
+
+    while (1)
+    {
+        int64_t next = next_move < next_fire ? next_move : next_fire;
+        if (next >= end)
+        {
+            break;
+        }
+        m.ch = join.ch;
+        strcpy(m.ticket, join.ticket);
+        int64_t wait = next - now_us();
+        while (wait > SESSION_HEARTBEAT_MS * 1000)
+        {
+            // A slow bot sends heartbeats meanwhile, so the server does not evict it
+            usleep(SESSION_HEARTBEAT_MS * 1000);
+            m.msg_type = 4;
+            m.seq = ++seq;
+            send_request(requester, &m, sizeof(m), &m, sizeof(m));
+            m.ch = join.ch;
+            strcpy(m.ticket, join.ticket);
+            wait = next - now_us();
+        }
+        if (wait > 0)
+        {
+            usleep(wait);
+        }
+
+        if (next == next_move)
+        {
+            m.msg_type = 1;
+            if (config->strategy == STRATEGY_SWEEP)
+            {
+                // Turn around after crossing the 16 cells of the area
+                if (++sweep_steps == 16)
+                {
+                    sweep_steps = 0;
+                    sweep_direction = sweep_direction == UP ? DOWN : sweep_direction == DOWN ? UP : sweep_direction == LEFT ? RIGHT : LEFT;
+                }
+                m.direction = sweep_direction;
+            }
+            else
+            {
+                m.direction = (direction_t)(rand_r(&seed) % 4);
+            }
+            next_move += move_period;
+        }
+        else
+        {
+            m.msg_type = 2;
+            next_fire += fire_period;
+        }
+        m.seq = ++seq;
+        send_command(bot, requester, &m);
+    }
+
+    // Leave the game
+    m.msg_type = 3;
+    m.ch = join.ch;
+    strcpy(m.ticket, join.ticket);
+    m.seq = ++seq;
+    send_command(bot, requester, &m);
+    zmq_close(requester);
+    return NULL;
+}
+
+/**
+ * Function: run_subscriber
+ * ------------------------
+ * Thread function that receives everything the server publishes and counts it.
+ *
+ * arg: Pointer to the subscriber_t of the subscriber.
+ */
+static void *run_subscriber(void *arg)
+{
+    subscriber_t *sub = (subscriber_t *)arg;
+    void *subscriber = zmq_socket(sub->context, ZMQ_SUB);
+    int timeout = 100;
+    zmq_setsockopt(subscriber, ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
+    zmq_setsockopt(subscriber, ZMQ_SUBSCRIBE, FRAME_TOPIC, strlen(FRAME_TOPIC));
+    zmq_setsockopt(subscriber, ZMQ_SUBSCRIBE, "scores ", 7);
+    if (zmq_connect(subscriber, sub->endpoint) != 0)
+    {
+        perror("Error connecting to the publisher");
+        exit(1);
+    }
+
+    zmq_msg_t message;
+    zmq_msg_init(&message);
+    while (!stop_subscribers)
+    {
+        int size = zmq_msg_recv(&message, subscriber, 0);
+        if (size == -1)
+        {
+            continue; // Timeout
+        }
+
+        // The scores are a topic frame followed by the protobuf message
+        if (size == 7 && memcmp(zmq_msg_data(&message), "scores ", 7) == 0 && zmq_msg_more(&message))
+        {
+            size = zmq_msg_recv(&message, subscriber, 0);
+            sub->score_messages++;
+            sub->score_bytes += size;
+            continue;
+        }
+
+        // A frame is the topic, the sequence number, the score window and the board window.
+        // A frame with the same number as the last one was sent again by a relay, and is not counted.
+        bool duplicate = false;
+        for (int part = 1; zmq_msg_more(&message); part++)
+        {
+            size = zmq_msg_recv(&message, subscriber, 0);
+            if (part == 1 && size == sizeof(uint32_t))
+            {
+                uint32_t seq;
+                memcpy(&seq, zmq_msg_data(&message), sizeof(seq));
+                seq = ntohl(seq);
+                duplicate = seq != 0 && seq == sub->last_seq;
+                if (sub->last_seq != 0 && seq > sub->last_seq + 1) // Lower: a restarted server numbering from 1
+                {
+                    sub->frames_dropped += (uint32_t)(seq - sub->last_seq - 1);
+                }
+                sub->last_seq = seq;
+            }
+            else if (part >= 2 && !duplicate)
+            {
+                sub->frame_messages++;
+                sub->frame_bytes += size;
+            }
+        }
+    }
+    zmq_msg_close(&message);
+    zmq_close(subscriber);
+    return NULL;
+}
+
+/**
+ * Function: compare_int64
+ * -----------------------
+ * Comparison function for qsort on int64_t values.
+ */
+static int compare_int64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Function: percentile
+ * --------------------
+ * Returns the given percentile of a sorted array.
+ *
+ * values: The sorted values.
+ * count: The number of values (must be greater than 0).
+ * p: The percentile, between 0 and 100.
+ */
+static int64_t percentile(int64_t *values, size_t count, double p)
+{
+    size_t index = (size_t)(p / 100.0 * (count - 1) + 0.5);
+    return values[index];
+}
+
+/**
+ * Function: summarize
+ * -------------------
+ * Merges the latencies of one command type of all bots.
+ *
+ * bots: The bots.
+ * bot_count: The number of bots.
+ * type: The command type.
+ *
+ * Returns the percentiles of the merged latencies (all zero if there are none).
+ */
+static latency_summary_t summarize(bot_t bots[], int bot_count, int type)
+{
+    latency_summary_t summary = {0};
+    for (int i = 0; i < bot_count; i++)
+    {
+        summary.count += bots[i].counts[type];
+    }
+    if (summary.count == 0)
+    {
+        return summary;
+    }
+
+    int64_t *all = malloc(summary.count * sizeof(int64_t));
+    size_t n = 0;
+    for (int i = 0; i < bot_count; i++)
+    {
+        memcpy(all + n, bots[i].latencies[type], bots[i].counts[type] * sizeof(int64_t));
+        n += bots[i].counts[type];
+    }
+    qsort(all, summary.count, sizeof(int64_t), compare_int64);
+    summary.p50 = percentile(all, summary.count, 50);
+    summary.p99 = percentile(all, summary.count, 99);
+    summary.p999 = percentile(all, summary.count, 99.9);
+    summary.max = all[summary.count - 1];
+    free(all);
+    return summary;
+}
+
+/**
+ * Function: print_report
+ * ----------------------
+ * Prints the latencies of the bots by command type and what the subscribers received.
+ *
+ * bots: The bots.
+ * bot_count: The number of bots.
+ * subs: The subscribers.
+ * sub_count: The number of subscribers.
+ * elapsed_us: How long the bots ran, in microseconds.
+ * json_path: If not NULL, the report is also written to this file as JSON.
+ */
+static void print_report(bot_t bots[], int bot_count, subscriber_t subs[], int sub_count, int64_t elapsed_us, const char *json_path)
+{
+    static const char *names[4] = {"join", "move", "fire", "leave"};
+    latency_summary_t summaries[4];
+    double seconds = elapsed_us / 1000000.0;
+    size_t total = 0;
+    int full = 0;
+
+    for (int i = 0; i < bot_count; i++)
+    {
+        full += bots[i].full;
+    }
+    printf("bots: %d (%d rejected with FULL)\n", bot_count, full);
+    printf("%-6s %8s %8s %8s %8s %8s\n", "cmd", "count", "p50 us", "p99 us", "p999 us", "max us");
+
+    for (int type = 0; type < 4; type++)
+    {
+        summaries[type] = summarize(bots, bot_count, type);
+        latency_summary_t *l = &summaries[type];
+        if (l->count > 0)
+        {
+            printf("%-6s %8zu %8lld %8lld %8lld %8lld\n", names[type], l->count,
+                   (long long)l->p50, (long long)l->p99, (long long)l->p999, (long long)l->max);
+        }
+        total += l->count;
+    }
+    printf("commands/s: %.1f\n", total / seconds);
+
+    // Frames are a score buffer and a board buffer; average over the subscribers
+    uint64_t frame_messages = 0, frame_bytes = 0, frames_dropped = 0, score_messages = 0, score_bytes = 0;
+    for (int i = 0; i < sub_count; i++)
+    {
+        frame_messages += subs[i].frame_messages;
+        frame_bytes += subs[i].frame_bytes;
+        frames_dropped += subs[i].frames_dropped;
+        score_messages += subs[i].score_messages;
+        score_bytes += subs[i].score_bytes;
+    }
+    double frames_per_s = sub_count ? frame_messages / 2.0 / sub_count / seconds : 0;
+    double bytes_per_frame = frame_messages ? 2.0 * frame_bytes / frame_messages : 0;
+    double scores_per_s = sub_count ? (double)score_messages / sub_count / seconds : 0;
+    if (sub_count > 0)
+    {
+        printf("subscribers: %d\n", sub_count);
+        printf("frames/s per subscriber: %.1f\n", frames_per_s);
+        printf("bytes per frame: %.1f\n", bytes_per_frame);
+        printf("frames dropped by the server: %llu\n", (unsigned long long)frames_dropped);
+        printf("score updates/s per subscriber: %.1f\n", scores_per_s);
+    }
+
+    if (json_path == NULL)
+    {
+        return;
+    }
+    FILE *json = fopen(json_path, "w");
+    if (json == NULL)
+    {
+        perror("Error creating the report");
+        return;
+    }
+    fprintf(json, "{\n  \"bots\": %d,\n  \"rejected_full\": %d,\n  \"elapsed_s\": %.3f,\n", bot_count, full, seconds);
+    fprintf(json, "  \"commands_per_s\": %.1f,\n  \"latency_us\": {\n", total / seconds);
+    for (int type = 0; type < 4; type++)
+    {
+        latency_summary_t *l = &summaries[type];
+        fprintf(json, "    \"%s\": {\"count\": %zu, \"p50\": %lld, \"p99\": %lld, \"p999\": %lld, \"max\": %lld}%s\n",
+                names[type], l->count, (long long)l->p50, (long long)l->p99, (long long)l->p999, (long long)l->max,
+                type < 3 ? "," : "");
+    }
+    fprintf(json, "  },\n  \"subscribers\": %d,\n  \"frames_per_s\": %.1f,\n", sub_count, frames_per_s);
+    fprintf(json, "  \"frames_dropped\": %llu,\n", (unsigned long long)frames_dropped);
+    fprintf(json, "  \"bytes_per_frame\": %.1f,\n  \"score_updates_per_s\": %.1f,\n", bytes_per_frame, scores_per_s);
+    fprintf(json, "  \"score_bytes\": %llu\n}\n", (unsigned long long)score_bytes);
+    fclose(json);
+}
+
+/**
+ * Function: swarm_default_config
+ * ------------------------------
+ * Fills the settings of a swarm with their defaults: one bot per player slot,
+ * no subscribers, and the default endpoints of the server.
+ */
+void swarm_default_config(bot_config_t *config)
+{
+    config->move_rate = 10;
+    config->fire_rate = 0.5;
+    config->duration_ms = 10000;
+    config->strategy = STRATEGY_RANDOM;
+    config->bot_count = MAX_CLIENTS;
+    config->sub_count = 0;
+    config->json_path = NULL;
+    config->commands_endpoint = COMMANDS_ENDPOINT;
+    config->frames_endpoint = FRAMES_ENDPOINT;
+}
+
+/**
+ * Function: swarm_usage
+ * ---------------------
+ * Prints the options of a swarm of bots.
+ *
+ * program: The name of the executable.
+ */
+void swarm_usage(const char *program)
+{
+    fprintf(stderr,
+            "Usage: %s [--bots N] [--move-rate R] [--fire-rate R] [--duration SECONDS] [--strategy random|sweep|camper]\n"
+            "          [--subscribers N] [--json FILE] [--commands ENDPOINT] [--frames ENDPOINT]\n"
+            "  --bots N          astronaut sessions to open, up to %d (default: %d)\n"
+            "  --move-rate R     moves per second of each bot (default: 10)\n"
+            "  --fire-rate R     shots per second of each bot (default: 0.5)\n"
+            "  --duration SECS   how long the bots play (default: 10)\n"
+            "  --strategy S      random: random moves; sweep: walk the area end to end;\n"
+            "                    camper: never move, only fire (default: random)\n"
+            "  --subscribers N   headless displays counting published frames (default: 0)\n"
+            "  --json FILE       also write the report to FILE as JSON\n"
+            "  --commands E      endpoint of the server commands (default: %s)\n"
+            "  --frames E        endpoint of the published frames, of the server or of a relay (default: %s)\n",
+            program, MAX_BOTS, MAX_CLIENTS, COMMANDS_ENDPOINT, FRAMES_ENDPOINT);
+}
+
+/**
+ * Function: swarm_parse_options
+ * -----------------------------
+ * Reads the options of a swarm from the command line.
+ *
+ * argc, argv: The command line. Parsing starts at argv[1].
+ * config: The settings, already filled with their defaults; the options given
+ *         replace them.
+ *
+ * Returns false if an option is unknown or out of range.
+ */
+bool swarm_parse_options(int argc, char *argv[], bot_config_t *config)
+{
+    static struct option long_options[] = {
+        {"bots", required_argument, NULL, 'b'},
+        {"move-rate", required_argument, NULL, 'm'},
+        {"fire-rate", required_argument, NULL, 'f'},
+        {"duration", required_argument, NULL, 'd'},
+        {"strategy", required_argument, NULL, 's'},
+        {"subscribers", required_argument, NULL, 'S'},
+        {"json", required_argument, NULL, 'j'},
+        {"commands", required_argument, NULL, 'c'},
+        {"frames", required_argument, NULL, 'F'},
+        {NULL, 0, NULL, 0}};
+
+    optind = 0; // getopt starts over, also when it already parsed another command line
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'b':
+            config->bot_count = atoi(optarg);
+            break;
+        case 'm':
+            config->move_rate = atof(optarg);
+            break;
+        case 'f':
+            config->fire_rate = atof(optarg);
+            break;
+        case 'd':
+            config->duration_ms = (int64_t)(atof(optarg) * 1000);
+            break;
+        case 's':
+            if (strcmp(optarg, "random") == 0)
+                config->strategy = STRATEGY_RANDOM;
+            else if (strcmp(optarg, "sweep") == 0)
+                config->strategy = STRATEGY_SWEEP;
+            else if (strcmp(optarg, "camper") == 0)
+                config->strategy = STRATEGY_CAMPER;
+            else
+                return false;
+            break;
+        case 'S':
+            config->sub_count = atoi(optarg);
+            break;
+        case 'j':
+            config->json_path = optarg;
+            break;
+        case 'c':
+            config->commands_endpoint = optarg;
+            break;
+        case 'F':
+            config->frames_endpoint = optarg;
+            break;
+        default:
+            return false;
+        }
+    }
+    return optind == argc && config->bot_count >= 1 && config->bot_count <= MAX_BOTS &&
+           config->sub_count >= 0 && config->sub_count <= MAX_BOTS;
+}
+
+/**
+ * Function: swarm_run
+ * -------------------
+ * Runs the bots and the subscribers of a swarm until the bots are done, and
+ * prints the report.
+ *
+ * context: The ZeroMQ context the sockets are created in. A server running
+ *          the swarm in its own process passes its context, so the swarm can
+ *          use its inproc endpoints.
+ * config: The settings of the swarm.
+ */
+void swarm_run(void *context, bot_config_t *config)
+{
+    int bot_count = config->bot_count;
+    int sub_count = config->sub_count;
+    bot_t *bots = calloc(bot_count, sizeof(bot_t));
+    subscriber_t *subs = calloc(sub_count > 0 ? sub_count : 1, sizeof(subscriber_t));
+    pthread_t threads[MAX_BOTS];
+    pthread_t sub_threads[MAX_BOTS];
+
+    // Subscribers connect first, so they see the whole run
+    stop_subscribers = false;
+    for (int i = 0; i < sub_count; i++)
+    {
+        subs[i].context = context;
+        subs[i].endpoint = config->frames_endpoint;
+        if (pthread_create(&sub_threads[i], NULL, run_subscriber, &subs[i]) != 0)
+        {
+            perror("Thread creation failed");
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (sub_count > 0)
+    {
+        s_sleep(500);
+    }
+
+    int64_t start = now_us();
+    for (int i = 0; i < bot_count; i++)
+    {
+        bots[i].id = i;
+        bots[i].config = config;
+        bots[i].context = context;
+        if (pthread_create(&threads[i], NULL, run_bot, &bots[i]) != 0)
+        {
+            perror("Thread creation failed");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int i = 0; i < bot_count; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    int64_t elapsed = now_us() - start;
+    stop_subscribers = true;
+    for (int i = 0; i < sub_count; i++)
+    {
+        pthread_join(sub_threads[i], NULL);
+    }
+
+    print_report(bots, bot_count, subs, sub_count, elapsed, config->json_path);
+
+    for (int i = 0; i < bot_count; i++)
+    {
+        for (int type = 0; type < 4; type++)
+        {
+            free(bots[i].latencies[type]);
+        }
+    }
+    free(bots);
+    free(subs);
+}
@@ -0,0 +1,58 @@
+#ifndef __BOT_SWARM_H_INCLUDED__
+#define __BOT_SWARM_H_INCLUDED__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MAX_BOTS 64
+
+/**
+ * Enum: strategy_t
+ * ----------------
+ * How a bot chooses its moves.
+ *
+ * STRATEGY_RANDOM: Moves in a random direction.
+ * STRATEGY_SWEEP: Walks its area end to end and back.
+ * STRATEGY_CAMPER: Never moves, only fires.
+ */
+typedef enum strategy_t
+{
+    STRATEGY_RANDOM,
+    STRATEGY_SWEEP,
+    STRATEGY_CAMPER
+} strategy_t;
+
+/**
+ * Struct: bot_config_t
+ * --------------------
+ * Settings shared by every bot and subscriber of a swarm.
+ *
+ * move_rate: Moves per second of each bot.
+ * fire_rate: Shots per second of each bot.
+ * duration_ms: How long each bot plays, in milliseconds.
+ * strategy: How the bots move.
+ * bot_count: The number of bots.
+ * sub_count: The number of headless subscribers.
+ * json_path: If not NULL, the report is also written to this file as JSON.
+ * commands_endpoint: The endpoint the bots send their commands to.
+ * frames_endpoint: The endpoint the subscribers receive the frames from.
+ */
+typedef struct bot_config_t
+{
+    double move_rate;
+    double fire_rate;
+    int64_t duration_ms;
+    strategy_t strategy;
+    int bot_count;
+    int sub_count;
+    const char *json_path;
+    const char *commands_endpoint;
+    const char *frames_endpoint;
+} bot_config_t;
+
+void swarm_default_config(bot_config_t *config);
+void swarm_usage(const char *program);
+bool swarm_parse_options(int argc, char *argv[], bot_config_t *config);
+void swarm_run(void *context, bot_config_t *config);
+
+#endif // __BOT_SWARM_H_INCLUDED__
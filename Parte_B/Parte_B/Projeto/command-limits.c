@@ -0,0 +1,97 @@
+#include <string.h>
+#include "command-limits.h"
+
+/**
+ * Function: limits_init
+ * ---------------------
+ * Sets the budgets of the players of a match.
+ *
+ * limits: The budgets.
+ * move_rate: Cells per second a player may move, 0 for no limit.
+ * fire_rate: Shots per second a player may send, 0 for no limit.
+ *
+ * A player may save up half a second of commands, and at least one command:
+ * a whole area for the moves, so one move coalesced by a client always fits.
+ */
+void limits_init(command_limits_t *limits, double move_rate, double fire_rate)
+{
+    memset(limits, 0, sizeof(*limits));
+    limits->move_rate = move_rate;
+    limits->fire_rate = fire_rate;
+    limits->move_burst = move_rate / 2 > MAX_MOVE_STEPS ? move_rate / 2 : MAX_MOVE_STEPS;
+    limits->fire_burst = fire_rate / 2 > 1 ? fire_rate / 2 : 1;
+}
+
+/**
+ * Function: limits_reset
+ * ----------------------
+ * Gives a full budget to a player who just joined.
+ *
+ * limits: The budgets.
+ * ch: The character of the player.
+ * now_ms: Game time, in milliseconds since the start.
+ */
+void limits_reset(command_limits_t *limits, char ch, uint32_t now_ms)
+{
+    int slot = ch - 'A';
+    if (slot < 0 || slot >= MAX_CLIENTS)
+    {
+        return;
+    }
+    limits->move[slot] = (token_bucket_t){limits->move_burst, now_ms};
+    limits->fire[slot] = (token_bucket_t){limits->fire_burst, now_ms};
+}
+
+/**
+ * Function: take_tokens
+ * ---------------------
+ * Refills a budget for the time passed and takes the cost of a command from it.
+ *
+ * Returns false, leaving the budget as it is, if it holds less than the cost.
+ */
+static bool take_tokens(token_bucket_t *bucket, double rate, double burst, double cost, uint32_t now_ms)
+{
+    bucket->tokens += (double)(uint32_t)(now_ms - bucket->last_ms) * rate / 1000;
+    if (bucket->tokens > burst)
+    {
+        bucket->tokens = burst;
+    }
+    bucket->last_ms = now_ms;
+    if (bucket->tokens < cost)
+    {
+        return false;
+    }
+    bucket->tokens -= cost;
+    return true;
+}
+
+/**
+ * Function: limits_allow
+ * ----------------------
+ * Checks a command against the budget of its player, and charges it.
+ *
+ * limits: The budgets.
+ * command: The command, from a player whose ticket was checked.
+ * now_ms: Game time, in milliseconds since the start.
+ *
+ * Returns false if the command goes over the budget and must be dropped.
+ * Joins, leaves and unknown commands are never limited.
+ */
+bool limits_allow(command_limits_t *limits, const remote_char_t *command, uint32_t now_ms)
+{
+    int slot = command->ch - 'A';
+    if (slot < 0 || slot >= MAX_CLIENTS)
+    {
+        return true;
+    }
+    if (command->msg_type == 1 && limits->move_rate > 0)
+    {
+        int steps = command->steps < 1 ? 1 : command->steps > MAX_MOVE_STEPS ? MAX_MOVE_STEPS : command->steps;
+        return take_tokens(&limits->move[slot], limits->move_rate, limits->move_burst, steps, now_ms);
+    }
+    if (command->msg_type == 2 && limits->fire_rate > 0)
+    {
+        return take_tokens(&limits->fire[slot], limits->fire_rate, limits->fire_burst, 1, now_ms);
+    }
+    return true;
+}
@@ -0,0 +1,51 @@
+#ifndef __COMMAND_LIMITS_H_INCLUDED__
+#define __COMMAND_LIMITS_H_INCLUDED__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <ncurses.h>
+#include "remote-char.h"
+#include "common.h"
+
+#define MOVE_DEFAULT_LIMIT 40 // Cells per second a player may move
+#define FIRE_DEFAULT_LIMIT 2  // Shots per second a player may send, cooldown or not
+
+/**
+ * Struct: token_bucket_t
+ * ----------------------
+ * The budget of one player for one kind of command.
+ *
+ * tokens: Commands the player may still send right now.
+ * last_ms: Game time of the last refill, in milliseconds since the start.
+ */
+typedef struct token_bucket_t
+{
+    double tokens;
+    uint32_t last_ms;
+} token_bucket_t;
+
+/**
+ * Struct: command_limits_t
+ * ------------------------
+ * The budgets of the players of a live match, by area.
+ *
+ * move_rate, fire_rate: Tokens added per second; 0 for no limit. A move costs
+ *                       one token per cell, a shot one token.
+ * move_burst, fire_burst: Tokens a player may save up.
+ * move, fire: The budgets, indexed by the character of the player minus 'A'.
+ */
+typedef struct command_limits_t
+{
+    double move_rate;
+    double fire_rate;
+    double move_burst;
+    double fire_burst;
+    token_bucket_t move[MAX_CLIENTS];
+    token_bucket_t fire[MAX_CLIENTS];
+} command_limits_t;
+
+void limits_init(command_limits_t *limits, double move_rate, double fire_rate);
+void limits_reset(command_limits_t *limits, char ch, uint32_t now_ms);
+bool limits_allow(command_limits_t *limits, const remote_char_t *command, uint32_t now_ms);
+
+#endif // __COMMAND_LIMITS_H_INCLUDED__
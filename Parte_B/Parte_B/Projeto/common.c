@@ -5,6 +5,8 @@
 #include <stdio.h>
 #include <ncurses.h>
 #include <unistd.h>
+#include <errno.h>
+#include <arpa/inet.h>
 #include "remote-char.h"
 #include "common.h"
 
@@ -37,6 +39,48 @@ void draw_board(WINDOW *board_win)
     wrefresh(board_win); // Refreshes the window to show the content.
 }
 
+/**
+ * Function: deserialize_window
+ * ----------------------------
+ * Updates the inside of a window from a frame serialized by the server,
+ * drawing only the cells that changed since the previous frame.
+ *
+ * win: A pointer to the window to be updated.
+ * buffer: The serialized content of the window, rows * cols characters.
+ * last_frame: The previous frame drawn in the window, rows * cols characters,
+ *             replaced by buffer. All zeros before the first frame, so that
+ *             every cell is drawn.
+ *
+ * Most of a frame is unchanged from the previous one, so curses is given only
+ * the changed cells and has less to compare and send to the terminal. Returns
+ * the number of cells drawn.
+ */
+int deserialize_window(WINDOW *win, const char *buffer, char *last_frame)
+{
+    int rows, cols;
+    int drawn = 0;
+    getmaxyx(win, rows, cols);
+    for (int y = 1; y < rows - 1; y++)
+    {
+        const char *row = buffer + y * cols;
+        char *last_row = last_frame + y * cols;
+        if (memcmp(row + 1, last_row + 1, cols - 2) == 0)
+        {
+            continue; // Unchanged row
+        }
+        for (int x = 1; x < cols - 1; x++)
+        {
+            if (row[x] != last_row[x])
+            {
+                mvwaddch(win, y, x, row[x]);
+                last_row[x] = row[x];
+                drawn++;
+            }
+        }
+    }
+    return drawn;
+}
+
 /**
  * Function: send_message
  * ----------------------
@@ -76,6 +120,258 @@ void receive_message(void *socket, void *buffer, size_t size)
         exit(1); // Exits on error.
     }  
 }    
+
+/**
+ * Function: enable_request_retries
+ * --------------------------------
+ * Lets a REQ socket send a request again before the previous one is answered.
+ *
+ * socket: The ZeroMQ REQ socket.
+ *
+ * A request in flight when the server dies is lost with the connection, and a
+ * plain REQ socket would then wait for its reply forever. Replies are matched
+ * to their request, so a late reply to an abandoned request is dropped.
+ */
+void enable_request_retries(void *socket)
+{
+    int on = 1;
+    zmq_setsockopt(socket, ZMQ_REQ_CORRELATE, &on, sizeof(on));
+    zmq_setsockopt(socket, ZMQ_REQ_RELAXED, &on, sizeof(on));
+}
+
+/**
+ * Function: send_request
+ * ----------------------
+ * Sends a request to the server and waits for its reply, sending it again
+ * every REQUEST_RETRY_MS until it is answered.
+ *
+ * socket: A ZeroMQ REQ socket set up by enable_request_retries.
+ * request: Pointer to the request.
+ * request_size: The size of the request.
+ * reply: Pointer to the buffer where the reply will be stored.
+ * reply_size: The size of the buffer.
+ *
+ * A server resumed from a checkpoint accepts the tickets it handed out, so the
+ * client carries on after a short freeze. A server that is only slow gets
+ * every copy, so the request must carry the seq of its session: the server
+ * answers the copies without applying them again. Joins have no seq and are
+ * not sent this way, as a join answered late would open a second session. If
+ * the request cannot be sent or received, the function displays an error
+ * message and exits.
+ */
+void send_request(void *socket, void *request, size_t request_size, void *reply, size_t reply_size)
+{
+    zmq_pollitem_t item = {socket, 0, ZMQ_POLLIN, 0};
+    do
+    {
+        send_message(socket, request, request_size);
+    } while (zmq_poll(&item, 1, REQUEST_RETRY_MS) == 0);
+    receive_message(socket, reply, reply_size);
+}
+
+/**
+ * Function: subscribe_frames
+ * --------------------------
+ * Subscribes a socket to every frame published by the server.
+ *
+ * stream: The subscription to initialize.
+ * subscriber: A ZeroMQ SUB socket connected to the server.
+ */
+void subscribe_frames(frame_stream_t *stream, void *subscriber)
+{
+    memset(stream, 0, sizeof(frame_stream_t));
+    stream->subscriber = subscriber;
+    zmq_setsockopt(subscriber, ZMQ_SUBSCRIBE, FRAME_TOPIC, strlen(FRAME_TOPIC));
+}
+
+/**
+ * Function: demote_stream
+ * -----------------------
+ * Moves a subscription that lost frames to the keyframe stream.
+ *
+ * stream: The subscription.
+ *
+ * The publisher drops frames for a subscriber whose queue is full. Keyframes
+ * come at a bounded rate, so a display that cannot keep up with every frame
+ * still sees the present. Each demotion doubles the clean keyframes needed to
+ * be promoted back, so a display that cannot keep up does not flap.
+ */
+static void demote_stream(frame_stream_t *stream)
+{
+    zmq_setsockopt(stream->subscriber, ZMQ_SUBSCRIBE, KEYFRAME_TOPIC, strlen(KEYFRAME_TOPIC));
+    zmq_setsockopt(stream->subscriber, ZMQ_UNSUBSCRIBE, FRAME_TOPIC, strlen(FRAME_TOPIC));
+    stream->keyframes_only = true;
+    stream->last_seq = 0;
+    stream->clean_keyframes = 0;
+    stream->promote_after = stream->promote_after == 0 ? KEYFRAME_PROMOTE_COUNT : stream->promote_after * 2;
+    if (stream->promote_after > KEYFRAME_PROMOTE_MAX)
+    {
+        stream->promote_after = KEYFRAME_PROMOTE_MAX;
+    }
+}
+
+/**
+ * Function: promote_stream
+ * ------------------------
+ * Moves a demoted subscription that kept up with the keyframes back to every frame.
+ *
+ * stream: The subscription.
+ */
+static void promote_stream(frame_stream_t *stream)
+{
+    zmq_setsockopt(stream->subscriber, ZMQ_SUBSCRIBE, FRAME_TOPIC, strlen(FRAME_TOPIC));
+    zmq_setsockopt(stream->subscriber, ZMQ_UNSUBSCRIBE, KEYFRAME_TOPIC, strlen(KEYFRAME_TOPIC));
+    stream->keyframes_only = false;
+    stream->last_seq = 0;
+    stream->clean_keyframes = 0;
+}
+
+/**
+ * Function: receive_part
+ * ----------------------
+ * Receives one part of a message, waiting for it if needed.
+ *
+ * socket: The ZeroMQ socket.
+ * buffer, size: Where the part is stored, truncated to size bytes.
+ * flags: 0 or ZMQ_DONTWAIT.
+ * more: Set to true if more parts of the message follow.
+ *
+ * Returns the size of the part, or -1 if nothing was queued with ZMQ_DONTWAIT
+ * or the socket timed out.
+ */
+static int receive_part(void *socket, void *buffer, size_t size, int flags, bool *more)
+{
+    while (true)
+    {
+        int received = zmq_recv(socket, buffer, size, flags);
+        if (received != -1)
+        {
+            int rcvmore = 0;
+            size_t rcvmore_size = sizeof(rcvmore);
+            zmq_getsockopt(socket, ZMQ_RCVMORE, &rcvmore, &rcvmore_size);
+            *more = rcvmore != 0;
+            return received;
+        }
+        if (errno == EAGAIN)
+        {
+            return -1;
+        }
+        if (errno != EINTR)
+        {
+            perror("Error receiving the frame");
+            exit(1);
+        }
+    }
+}
+
+/**
+ * Function: receive_frame
+ * -----------------------
+ * Receives the score and board windows published by the server.
+ *
+ * stream: The subscription, set up by subscribe_frames.
+ * score, score_size: Where the score window is stored, and its size in characters.
+ * board, board_size: Where the board window is stored, and its size in characters.
+ * latest: If true, everything queued on the socket is read and only the
+ *         newest frame is kept, so a slow display skips frames instead of
+ *         falling behind.
+ *
+ * A gap in the sequence numbers means the publisher dropped frames for this
+ * subscriber; they are counted and the subscription is demoted to the
+ * keyframe stream, until it receives promote_after keyframes in a row. A
+ * number lower than the last one means a new server took over the match and
+ * numbers again from 1; nothing is counted as lost. Messages that are not
+ * frames of the current stream are skipped, and so is a copy of the last
+ * frame, sent again by a frame relay to a subscriber that just joined. score
+ * and board are only written with a complete frame. Returns
+ * the number of frames skipped, 0 if latest is false, or -1 if the socket
+ * timed out before a frame arrived.
+ */
+int receive_frame(frame_stream_t *stream, char *score, int score_size, char *board, int board_size, bool latest)
+{
+    int part_size = score_size > board_size ? score_size : board_size;
+    char part[part_size], pending_score[score_size], pending_board[board_size];
+    int frames = 0;
+    int flags = 0;
+
+    while (true)
+    {
+        bool more;
+        int size = receive_part(stream->subscriber, part, part_size, flags, &more);
+        if (size == -1)
+        {
+            break; // Drained, or timed out if the socket has ZMQ_RCVTIMEO
+        }
+
+        // The parts of a message arrive together, so the rest never has to be waited for
+        const char *topic = stream->keyframes_only ? KEYFRAME_TOPIC : FRAME_TOPIC;
+        bool is_frame = size == (int)strlen(topic) && memcmp(part, topic, size) == 0;
+        uint32_t seq = 0;
+        int parts = 1;
+        while (more)
+        {
+            size = receive_part(stream->subscriber, part, part_size, 0, &more);
+            parts++;
+            if (!is_frame)
+            {
+                continue;
+            }
+            if (parts == 2 && size == sizeof(seq))
+            {
+                memcpy(&seq, part, sizeof(seq));
+                seq = ntohl(seq);
+            }
+            else if (parts == 3 && size == score_size)
+            {
+                memcpy(pending_score, part, score_size);
+            }
+            else if (parts == 4 && size == board_size && !more)
+            {
+                memcpy(pending_board, part, board_size);
+            }
+            else
+            {
+                is_frame = false;
+            }
+        }
+        if (!is_frame || parts != 4 || (seq != 0 && seq == stream->last_seq))
+        {
+            continue; // Not a frame, or the last one again, replayed by a relay for a new subscriber
+        }
+        memcpy(score, pending_score, score_size);
+        memcpy(board, pending_board, board_size);
+
+        bool gap = stream->last_seq != 0 && seq > stream->last_seq + 1; // Lower: a restarted server
+        if (gap)
+        {
+            stream->dropped += seq - stream->last_seq - 1;
+        }
+        if (gap && !stream->keyframes_only)
+        {
+            demote_stream(stream); // This frame is still drawn
+            seq = 0;
+        }
+        else if (stream->keyframes_only)
+        {
+            stream->clean_keyframes = gap ? 0 : stream->clean_keyframes + 1;
+            if (stream->clean_keyframes >= stream->promote_after)
+            {
+                promote_stream(stream);
+                seq = 0;
+            }
+        }
+        stream->last_seq = seq;
+        frames++;
+        if (!latest)
+        {
+            break;
+        }
+        flags = ZMQ_DONTWAIT;
+    }
+    stream->skipped += frames > 1 ? frames - 1 : 0;
+    return frames - 1;
+}
+
 /**
  * Function: initialize_zmq_socket
  * -------------------------------
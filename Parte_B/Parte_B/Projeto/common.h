@@ -1,6 +1,10 @@
 #ifndef __COMMON_H_INCLUDED__
 #define __COMMON_H_INCLUDED__
 
+#include <stdbool.h>
+#include <stdint.h>
+#include <ncurses.h>
+
 #define WINDOW_SIZE 22
 
 #define BOARD_WIDTH 20
@@ -9,9 +13,61 @@
 #define MAX_CLIENTS 8
 #define MAX_ALIENS 16 * 16 / 3
 
+// Topics of the frames published by the server. A frame is a multipart message:
+// the topic, a 4-byte sequence number in network order, the score window and the board window
+#define FRAME_TOPIC "frame "  // Every frame
+#define KEYFRAME_TOPIC "key " // At most one frame every KEYFRAME_INTERVAL_MS, for slow subscribers
+#define KEYFRAME_INTERVAL_MS 250
+#define KEYFRAME_PROMOTE_COUNT 20 // Keyframes in a row without a gap before a demoted subscriber gets every frame again
+#define KEYFRAME_PROMOTE_MAX 640  // Longest wait for the promotion, doubled after each demotion to avoid flapping
+
+// Default endpoints of the server. Every program takes --commands and --frames
+// to use others, so several servers can run on one host
+#define COMMANDS_ENDPOINT "ipc:///tmp/s1"
+#define FRAMES_BIND_ENDPOINT "tcp://*:5555"
+#define FRAMES_ENDPOINT "tcp://localhost:5555"
+
+// A request not answered in this time is sent again, in case the server restarted
+#define REQUEST_RETRY_MS 1000
+
+// A player that sent nothing for this long sends a heartbeat, so the server does not evict it
+#define SESSION_HEARTBEAT_MS 3000
+
+/**
+ * Struct: frame_stream_t
+ * ----------------------
+ * A subscription to the frames published by the server.
+ *
+ * subscriber: The SUB socket, connected to the server.
+ * keyframes_only: true once the subscriber fell behind and was demoted to the
+ *                 keyframe stream.
+ * last_seq: Sequence number of the last frame received on the current stream,
+ *           0 before the first.
+ * clean_keyframes: Keyframes received in a row without a gap, while demoted.
+ * promote_after: Clean keyframes needed to get back to every frame.
+ * dropped: Frames the publisher dropped for this subscriber because its queue
+ *          was full, seen as gaps in the sequence numbers.
+ * skipped: Frames received but not rendered, in conflating mode.
+ */
+typedef struct frame_stream_t
+{
+    void *subscriber;
+    bool keyframes_only;
+    uint32_t last_seq;
+    int clean_keyframes;
+    int promote_after;
+    long dropped;
+    long skipped;
+} frame_stream_t;
+
 void draw_board(WINDOW *board_win);
+int deserialize_window(WINDOW *win, const char *buffer, char *last_frame);
 void send_message(void *socket, void *buffer, size_t size);
 void receive_message(void *socket, void *buffer, size_t size);
+void enable_request_retries(void *socket);
+void send_request(void *socket, void *request, size_t request_size, void *reply, size_t reply_size);
+void subscribe_frames(frame_stream_t *stream, void *subscriber);
+int receive_frame(frame_stream_t *stream, char *score, int score_size, char *board, int board_size, bool latest);
 void *initialize_zmq_socket(void **context, int socket_type, const char *endpoint, bool is_bind);
 
 #endif // __COMMON_H_INCLUDED__
\ No newline at end of file
@@ -0,0 +1,310 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/syscall.h>
+#include "flight-recorder.h"
+
+/**
+ * Struct: flight_entry_t
+ * ----------------------
+ * One slot of the ring.
+ *
+ * seq: 2 * (index + 1) once the event with that index is written, odd while
+ *      it is being written. Lets a dump skip slots that are being overwritten.
+ * ts_ns: Monotonic time of the event, in nanoseconds.
+ * tid: The kernel id of the thread that recorded it.
+ * event: The kind of event (flight_event_t).
+ * a, b: Arguments of the event.
+ */
+typedef struct flight_entry_t
+{
+    atomic_uint_fast64_t seq;
+    uint64_t ts_ns;
+    int tid;
+    int event;
+    int a, b;
+} flight_entry_t;
+
+static const char *event_names[] = {
+    "command", "command done", "join", "leave", "tick begin", "tick end", "publish", "bullet expiry", "overrun"};
+static const char *span_names[WATCH_SPANS] = {"command", "alien tick"};
+
+static flight_entry_t ring[FLIGHT_RING_SIZE];
+static atomic_uint_fast64_t next_index;
+static __thread int thread_id = 0;
+
+// Watchdog state; a threshold of 0 means the watchdog is off
+static uint64_t threshold_ns = 0;
+static const char *dump_dir;
+static _Atomic uint64_t span_since[WATCH_SPANS];    // Start of the span in progress, 0 if none
+static _Atomic uint64_t span_reported[WATCH_SPANS]; // Start of the last span reported while in progress
+static atomic_int overrun_span = -1;                // Span that finished over the threshold, -1 if none
+static _Atomic uint64_t overrun_ms;
+static atomic_bool watchdog_running = false;
+static pthread_t watchdog_thread;
+
+/**
+ * Function: now_ns
+ * ----------------
+ * Returns a monotonic timestamp in nanoseconds.
+ */
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * Function: flight_record
+ * -----------------------
+ * Appends an event to the ring, overwriting the oldest one.
+ *
+ * event: The kind of event.
+ * a, b: Its arguments (see flight_event_t).
+ *
+ * Lock-free and safe from any thread: a slot is claimed with one atomic
+ * increment, so the cost is that increment and a clock read.
+ */
+void flight_record(flight_event_t event, int a, int b)
+{
+    if (thread_id == 0)
+    {
+        thread_id = (int)syscall(SYS_gettid);
+    }
+    uint64_t index = atomic_fetch_add_explicit(&next_index, 1, memory_order_relaxed);
+    flight_entry_t *entry = &ring[index & (FLIGHT_RING_SIZE - 1)];
+
+    atomic_store_explicit(&entry->seq, 2 * index + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    entry->ts_ns = now_ns();
+    entry->tid = thread_id;
+    entry->event = event;
+    entry->a = a;
+    entry->b = b;
+    atomic_store_explicit(&entry->seq, 2 * index + 2, memory_order_release);
+}
+
+/**
+ * Function: flight_dump
+ * ---------------------
+ * Writes the events in the ring to a text file, oldest first.
+ *
+ * path: The file to write.
+ * reason: Why the dump was taken, written in the header.
+ *
+ * Events keep being recorded while the ring is read; slots overwritten in the
+ * meantime are skipped. Returns 0 on success, -1 if the file cannot be written.
+ */
+int flight_dump(const char *path, const char *reason)
+{
+    FILE *out = fopen(path, "w");
+    if (out == NULL)
+    {
+        return -1;
+    }
+
+    uint64_t end = atomic_load_explicit(&next_index, memory_order_acquire);
+    uint64_t begin = end > FLIGHT_RING_SIZE ? end - FLIGHT_RING_SIZE : 0;
+    uint64_t now = now_ns();
+
+    fprintf(out, "# flight recorder dump: %s\n", reason);
+    fprintf(out, "# pid %d, events %llu to %llu, time in ms before the dump\n",
+            (int)getpid(), (unsigned long long)begin, (unsigned long long)end);
+
+    int skipped = 0;
+    for (uint64_t index = begin; index < end; index++)
+    {
+        flight_entry_t *slot = &ring[index & (FLIGHT_RING_SIZE - 1)];
+        uint64_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        flight_entry_t entry = {.ts_ns = slot->ts_ns, .tid = slot->tid, .event = slot->event, .a = slot->a, .b = slot->b};
+        atomic_thread_fence(memory_order_acquire);
+        if (seq != 2 * index + 2 || atomic_load_explicit(&slot->seq, memory_order_relaxed) != seq)
+        {
+            skipped++;
+            continue;
+        }
+
+        double age_ms = now >= entry.ts_ns ? (now - entry.ts_ns) / 1e6 : 0;
+        fprintf(out, "%12.3f  tid %-7d %-14s ", -age_ms, entry.tid, event_names[entry.event]);
+        switch (entry.event)
+        {
+        case FLIGHT_COMMAND:
+            fprintf(out, "msg_type=%d ch=%c\n", entry.a, entry.b > ' ' ? entry.b : '?');
+            break;
+        case FLIGHT_COMMAND_DONE:
+            fprintf(out, "msg_type=%d us=%d\n", entry.a, entry.b);
+            break;
+        case FLIGHT_JOIN:
+        case FLIGHT_LEAVE:
+            fprintf(out, "ch=%c\n", entry.a);
+            break;
+        case FLIGHT_TICK_END:
+            fprintf(out, "aliens=%d\n", entry.a);
+            break;
+        case FLIGHT_PUBLISH:
+            fprintf(out, "bytes=%d\n", entry.a);
+            break;
+        case FLIGHT_BULLET_EXPIRY:
+            fprintf(out, "x=%d y=%d\n", entry.a, entry.b);
+            break;
+        case FLIGHT_OVERRUN:
+            fprintf(out, "span=%s ms=%d\n", span_names[entry.a], entry.b);
+            break;
+        default:
+            fprintf(out, "\n");
+        }
+    }
+    if (skipped > 0)
+    {
+        fprintf(out, "# %d events overwritten while dumping\n", skipped);
+    }
+    fclose(out);
+    return 0;
+}
+
+/**
+ * Function: watchdog_begin / watchdog_end
+ * ---------------------------------------
+ * Mark the beginning and the end of a span timed by the watchdog.
+ *
+ * span: The span. Only one span of each kind can be in progress.
+ *
+ * A span that ends over the threshold is recorded as FLIGHT_OVERRUN and left
+ * for the watchdog thread to dump, so no file is written under the game lock.
+ */
+void watchdog_begin(watch_span_t span)
+{
+    atomic_store_explicit(&span_since[span], now_ns(), memory_order_relaxed);
+}
+
+void watchdog_end(watch_span_t span)
+{
+    uint64_t since = atomic_exchange_explicit(&span_since[span], 0, memory_order_relaxed);
+    uint64_t elapsed = now_ns() - since;
+    if (threshold_ns == 0 || since == 0 || elapsed <= threshold_ns)
+    {
+        return;
+    }
+    if (atomic_load_explicit(&span_reported[span], memory_order_relaxed) == since)
+    {
+        return; // Already dumped while in progress
+    }
+    flight_record(FLIGHT_OVERRUN, span, (int)(elapsed / 1000000));
+    atomic_store(&overrun_ms, elapsed / 1000000);
+    atomic_store(&overrun_span, span);
+}
+
+/**
+ * Function: watchdog_dump
+ * -----------------------
+ * Dumps the flight recorder to a new file in the dump directory.
+ *
+ * reason: Why the dump is taken.
+ *
+ * Dumps closer than WATCHDOG_MIN_DUMP_INTERVAL_MS to the previous one are
+ * skipped, so a server that stays overloaded does not fill the disk.
+ */
+static void watchdog_dump(const char *reason)
+{
+    static uint64_t last_dump_ns = 0;
+    static int dumps = 0;
+
+    uint64_t now = now_ns();
+    if (last_dump_ns != 0 && now - last_dump_ns < (uint64_t)WATCHDOG_MIN_DUMP_INTERVAL_MS * 1000000)
+    {
+        return;
+    }
+    last_dump_ns = now;
+
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/flight-%d-%d.log", dump_dir, (int)getpid(), dumps++);
+    if (flight_dump(path, reason) != 0)
+    {
+        perror("Error writing flight recorder dump");
+    }
+}
+
+/**
+ * Function: watch_spans
+ * ---------------------
+ * Thread function of the watchdog.
+ *
+ * arg: Unused.
+ *
+ * Every WATCHDOG_POLL_MS, dumps the recorder if a span finished over the
+ * threshold, or if one has been in progress for longer than the threshold,
+ * which catches a server that is stuck rather than slow.
+ */
+static void *watch_spans(void *arg)
+{
+    (void)arg;
+    char reason[128];
+
+    while (atomic_load(&watchdog_running))
+    {
+        usleep(WATCHDOG_POLL_MS * 1000);
+
+        int span = atomic_exchange(&overrun_span, -1);
+        if (span >= 0)
+        {
+            snprintf(reason, sizeof(reason), "%s took %llu ms", span_names[span], (unsigned long long)atomic_load(&overrun_ms));
+            watchdog_dump(reason);
+        }
+
+        for (int i = 0; i < WATCH_SPANS; i++)
+        {
+            uint64_t since = atomic_load_explicit(&span_since[i], memory_order_relaxed);
+            uint64_t now = now_ns();
+            if (since != 0 && now > since && now - since > threshold_ns &&
+                atomic_load_explicit(&span_reported[i], memory_order_relaxed) != since)
+            {
+                atomic_store_explicit(&span_reported[i], since, memory_order_relaxed);
+                flight_record(FLIGHT_OVERRUN, i, (int)((now - since) / 1000000));
+                snprintf(reason, sizeof(reason), "%s in progress for %llu ms", span_names[i], (unsigned long long)((now - since) / 1000000));
+                watchdog_dump(reason);
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Function: watchdog_start
+ * ------------------------
+ * Starts the watchdog thread.
+ *
+ * threshold_ms: Commands and ticks longer than this are dumped.
+ * dir: The directory the dumps are written to, as flight-<pid>-<n>.log.
+ */
+void watchdog_start(uint32_t threshold_ms, const char *dir)
+{
+    threshold_ns = (uint64_t)threshold_ms * 1000000;
+    dump_dir = dir;
+    atomic_store(&watchdog_running, true);
+    if (pthread_create(&watchdog_thread, NULL, watch_spans, NULL) != 0)
+    {
+        perror("Watchdog thread creation failed");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * Function: watchdog_stop
+ * -----------------------
+ * Stops the watchdog thread. Does nothing if it was not started.
+ */
+void watchdog_stop(void)
+{
+    if (!atomic_load(&watchdog_running))
+    {
+        return;
+    }
+    atomic_store(&watchdog_running, false);
+    pthread_join(watchdog_thread, NULL);
+    threshold_ns = 0;
+}
@@ -0,0 +1,59 @@
+#ifndef __FLIGHT_RECORDER_H_INCLUDED__
+#define __FLIGHT_RECORDER_H_INCLUDED__
+
+#include <stdint.h>
+
+#define FLIGHT_RING_SIZE 4096          // Events kept, a power of two
+#define WATCHDOG_DEFAULT_MS 50         // Default overrun threshold
+#define WATCHDOG_POLL_MS 10            // How often the watchdog looks at the spans in progress
+#define WATCHDOG_MIN_DUMP_INTERVAL_MS 1000 // Dumps are at least this far apart
+
+/**
+ * Enum: flight_event_t
+ * --------------------
+ * The events kept by the flight recorder.
+ *
+ * FLIGHT_COMMAND: A command was received (a: msg_type, b: ch).
+ * FLIGHT_COMMAND_DONE: A command was answered (a: msg_type, b: microseconds since it was received).
+ * FLIGHT_JOIN, FLIGHT_LEAVE: A player joined or left (a: ch).
+ * FLIGHT_TICK_BEGIN, FLIGHT_TICK_END: An alien tick (a: aliens alive at the end).
+ * FLIGHT_PUBLISH: A frame was sent to the subscribers (a: bytes).
+ * FLIGHT_BULLET_EXPIRY: A zap was removed from the board (a: x, b: y).
+ * FLIGHT_OVERRUN: The watchdog saw a span over the threshold (a: watch_span_t, b: milliseconds).
+ */
+typedef enum flight_event_t
+{
+    FLIGHT_COMMAND,
+    FLIGHT_COMMAND_DONE,
+    FLIGHT_JOIN,
+    FLIGHT_LEAVE,
+    FLIGHT_TICK_BEGIN,
+    FLIGHT_TICK_END,
+    FLIGHT_PUBLISH,
+    FLIGHT_BULLET_EXPIRY,
+    FLIGHT_OVERRUN
+} flight_event_t;
+
+/**
+ * Enum: watch_span_t
+ * ------------------
+ * The spans timed by the watchdog.
+ *
+ * WATCH_COMMAND: A command, from its receipt to its reply.
+ * WATCH_TICK: An alien tick.
+ */
+typedef enum watch_span_t
+{
+    WATCH_COMMAND,
+    WATCH_TICK,
+    WATCH_SPANS
+} watch_span_t;
+
+void flight_record(flight_event_t event, int a, int b);
+int flight_dump(const char *path, const char *reason);
+void watchdog_begin(watch_span_t span);
+void watchdog_end(watch_span_t span);
+void watchdog_start(uint32_t threshold_ms, const char *dir);
+void watchdog_stop(void);
+
+#endif // __FLIGHT_RECORDER_H_INCLUDED__
@@ -0,0 +1,322 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <ncurses.h>
+#include <zmq.h>
+#include "common.h"
+
+#define RELAY_DOWNSTREAM "tcp://*:5556"
+#define RELAY_DEFAULT_HWM 100 // Messages queued at most for one spectator, as on the server
+#define RELAY_MAX_PARTS 4     // Parts of the longest message cached, a frame
+#define SCORES_TOPIC "scores "
+
+static volatile sig_atomic_t stopping = 0;
+
+/**
+ * Struct: cached_message_t
+ * ------------------------
+ * The last message published on a topic, sent again to every new subscriber
+ * of the topic.
+ *
+ * topic: The topic.
+ * parts: The number of parts of the message, 0 before the first one.
+ * part: The parts, sharing their data with the messages forwarded.
+ */
+typedef struct cached_message_t
+{
+    const char *topic;
+    int parts;
+    zmq_msg_t part[RELAY_MAX_PARTS];
+} cached_message_t;
+
+/**
+ * Struct: relay_stats_t
+ * ---------------------
+ * What the relay did, printed when it stops.
+ *
+ * messages: Messages forwarded from the server.
+ * subscriptions: Subscriptions of the spectators.
+ * replays: Cached messages sent to new subscribers.
+ */
+typedef struct relay_stats_t
+{
+    long messages;
+    long subscriptions;
+    long replays;
+} relay_stats_t;
+
+/**
+ * Function: find_cache
+ * --------------------
+ * Returns the cache of a topic, or NULL if messages of the topic are not cached.
+ */
+static cached_message_t *find_cache(cached_message_t caches[], int count, const void *topic, size_t size)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (size == strlen(caches[i].topic) && memcmp(topic, caches[i].topic, size) == 0)
+        {
+            return &caches[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Function: forward_message
+ * -------------------------
+ * Forwards one message from the server to the spectators and caches it.
+ *
+ * upstream: The socket connected to the server.
+ * downstream: The socket of the spectators.
+ * caches, count: The cached topics.
+ *
+ * The parts are forwarded as they are received. The cache keeps copies of the
+ * parts, which share the data with the forwarded ones instead of copying it.
+ */
+static void forward_message(void *upstream, void *downstream, cached_message_t caches[], int count)
+{
+    cached_message_t *cache = NULL;
+    zmq_msg_t fresh[RELAY_MAX_PARTS];
+    int parts = 0;
+    bool more;
+    do
+    {
+        zmq_msg_t part;
+        zmq_msg_init(&part);
+        if (zmq_msg_recv(&part, upstream, 0) == -1)
+        {
+            zmq_msg_close(&part);
+            break; // Interrupted by a signal
+        }
+        more = zmq_msg_more(&part);
+        if (parts == 0)
+        {
+            cache = find_cache(caches, count, zmq_msg_data(&part), zmq_msg_size(&part));
+        }
+        if (cache != NULL && parts < RELAY_MAX_PARTS)
+        {
+            zmq_msg_init(&fresh[parts]);
+            zmq_msg_copy(&fresh[parts], &part);
+        }
+        parts++;
+        zmq_msg_send(&part, downstream, more ? ZMQ_SNDMORE : 0);
+        zmq_msg_close(&part);
+    } while (more);
+
+    if (cache == NULL)
+    {
+        return;
+    }
+    int kept = parts < RELAY_MAX_PARTS ? parts : RELAY_MAX_PARTS;
+    if (parts > RELAY_MAX_PARTS || more)
+    {
+        // Not a message of the protocol; keep the previous one
+        for (int i = 0; i < kept; i++)
+        {
+            zmq_msg_close(&fresh[i]);
+        }
+        return;
+    }
+    for (int i = 0; i < cache->parts; i++)
+    {
+        zmq_msg_close(&cache->part[i]);
+    }
+    memcpy(cache->part, fresh, sizeof(zmq_msg_t) * parts);
+    cache->parts = parts;
+}
+
+/**
+ * Function: replay_cache
+ * ----------------------
+ * Handles the subscriptions of spectators: sends them the cached messages of
+ * the topics they subscribed to, so they see the current state right away
+ * instead of after the next publish.
+ *
+ * downstream: The socket of the spectators.
+ * caches, count: The cached topics.
+ * stats: Counters of the relay.
+ *
+ * The socket cannot send to one subscriber only, so the other subscribers of
+ * the topic get the message a second time; receive_frame skips a frame with
+ * the same sequence number as the last one, and a second scores message with
+ * the same scores changes nothing. Every subscription queued is read first and
+ * each topic is sent once for all of them, so a crowd of spectators joining
+ * together does not fill the queues of the others with copies.
+ */
+static void replay_cache(void *downstream, cached_message_t caches[], int count, relay_stats_t *stats)
+{
+    bool wanted[count];
+    memset(wanted, 0, sizeof(wanted));
+
+    unsigned char subscription[256];
+    int size;
+    while ((size = zmq_recv(downstream, subscription, sizeof(subscription), ZMQ_DONTWAIT)) >= 0)
+    {
+        if (size < 1 || subscription[0] != 1 || size > (int)sizeof(subscription))
+        {
+            continue; // An unsubscription, or too long to be one of ours
+        }
+        stats->subscriptions++;
+
+        // A subscription is a prefix of the topics it receives
+        for (int i = 0; i < count; i++)
+        {
+            wanted[i] |= (size_t)(size - 1) <= strlen(caches[i].topic) && memcmp(subscription + 1, caches[i].topic, size - 1) == 0;
+        }
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        cached_message_t *cache = &caches[i];
+        if (!wanted[i] || cache->parts == 0)
+        {
+            continue;
+        }
+        for (int j = 0; j < cache->parts; j++)
+        {
+            zmq_msg_t part;
+            zmq_msg_init(&part);
+            zmq_msg_copy(&part, &cache->part[j]);
+            zmq_msg_send(&part, downstream, j < cache->parts - 1 ? ZMQ_SNDMORE : 0);
+            zmq_msg_close(&part);
+        }
+        stats->replays++;
+    }
+}
+
+static void handle_stop(int sig)
+{
+    (void)sig;
+    stopping = 1;
+}
+
+/**
+ * Function: usage
+ * ---------------
+ * Prints the command-line options of the relay.
+ */
+static void usage(const char *program)
+{
+    fprintf(stderr,
+            "Usage: %s [--server ENDPOINT] [--bind ENDPOINT] [--hwm N]\n"
+            "  --server ENDPOINT publisher of the game server (default: %s)\n"
+            "  --bind ENDPOINT   endpoint the spectators connect to (default: %s)\n"
+            "  --hwm N           messages queued at most for one spectator before it loses some (default: %d)\n",
+            program, FRAMES_ENDPOINT, RELAY_DOWNSTREAM, RELAY_DEFAULT_HWM);
+}
+
+/**
+ * Function: main
+ * --------------
+ * Entry point of the frame relay: subscribes once to every topic of the game
+ * server and republishes the messages to any number of spectators, so the
+ * fan-out and the queues of the spectators are off the game server.
+ */
+int main(int argc, char *argv[])
+{
+    const char *server = FRAMES_ENDPOINT;
+    const char *bind = RELAY_DOWNSTREAM;
+    int hwm = RELAY_DEFAULT_HWM;
+
+    static struct option long_options[] = {
+        {"server", required_argument, NULL, 's'},
+        {"bind", required_argument, NULL, 'b'},
+        {"hwm", required_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}};
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 's':
+            server = optarg;
+            break;
+        case 'b':
+            bind = optarg;
+            break;
+        case 'h':
+            hwm = atoi(optarg);
+            if (hwm < 1)
+            {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            break;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    struct sigaction action = {0};
+    action.sa_handler = handle_stop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    void *context = zmq_ctx_new();
+    void *upstream = zmq_socket(context, ZMQ_XSUB);
+    if (zmq_connect(upstream, server) != 0)
+    {
+        perror("Error connecting to the server");
+        return EXIT_FAILURE;
+    }
+    void *downstream = zmq_socket(context, ZMQ_XPUB);
+    int verbose = 1, linger = 0;
+    zmq_setsockopt(downstream, ZMQ_SNDHWM, &hwm, sizeof(hwm));
+    zmq_setsockopt(downstream, ZMQ_XPUB_VERBOSE, &verbose, sizeof(verbose)); // Every new spectator is seen, not only the first of a topic
+    zmq_setsockopt(downstream, ZMQ_LINGER, &linger, sizeof(linger));
+    if (zmq_bind(downstream, bind) != 0)
+    {
+        perror("Error binding the relay socket");
+        return EXIT_FAILURE;
+    }
+
+    // The relay keeps its own subscriptions to every topic, so the caches are
+    // always current and the spectators' subscriptions never reach the server
+    cached_message_t caches[] = {{FRAME_TOPIC, 0}, {KEYFRAME_TOPIC, 0}, {SCORES_TOPIC, 0}};
+    int count = sizeof(caches) / sizeof(caches[0]);
+    for (int i = 0; i < count; i++)
+    {
+        char subscription[32];
+        subscription[0] = 1;
+        memcpy(subscription + 1, caches[i].topic, strlen(caches[i].topic));
+        zmq_send(upstream, subscription, 1 + strlen(caches[i].topic), 0);
+    }
+
+    relay_stats_t stats = {0};
+    zmq_pollitem_t items[] = {{upstream, 0, ZMQ_POLLIN, 0}, {downstream, 0, ZMQ_POLLIN, 0}};
+    while (!stopping)
+    {
+        if (zmq_poll(items, 2, -1) < 0)
+        {
+            continue; // Interrupted by a signal
+        }
+        if (items[0].revents & ZMQ_POLLIN)
+        {
+            forward_message(upstream, downstream, caches, count);
+            stats.messages++;
+        }
+        if (items[1].revents & ZMQ_POLLIN)
+        {
+            replay_cache(downstream, caches, count, &stats);
+        }
+    }
+
+    printf("messages relayed: %ld\nsubscriptions: %ld\ncached messages sent to new subscribers: %ld\n",
+           stats.messages, stats.subscriptions, stats.replays);
+    for (int i = 0; i < count; i++)
+    {
+        for (int j = 0; j < caches[i].parts; j++)
+        {
+            zmq_msg_close(&caches[i].part[j]);
+        }
+    }
+    zmq_close(upstream);
+    zmq_close(downstream);
+    zmq_ctx_destroy(context);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,316 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "game-checkpoint.h"
+
+#define CLIENT_SIZE 32
+#define PAYLOAD_SIZE (44 + MAX_CLIENTS * CLIENT_SIZE + BOARD_HEIGHT * BOARD_WIDTH * 4)
+
+/**
+ * Function: put_u32 / put_u64 / get_u32 / get_u64
+ * -----------------------------------------------
+ * Store and read back little-endian integers, so that a checkpoint can be
+ * resumed on another machine.
+ */
+static void put_u32(uint8_t *out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        out[i] = (value >> (8 * i)) & 0xff;
+    }
+}
+
+static void put_u64(uint8_t *out, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        out[i] = (value >> (8 * i)) & 0xff;
+    }
+}
+
+static uint32_t get_u32(const uint8_t *in)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        value |= (uint32_t)in[i] << (8 * i);
+    }
+    return value;
+}
+
+static uint64_t get_u64(const uint8_t *in)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        value |= (uint64_t)in[i] << (8 * i);
+    }
+    return value;
+}
+
+/**
+ * Function: slot_checksum
+ * -----------------------
+ * Computes a FNV-1a hash of a slot, from its header up to the checksum and
+ * its payload.
+ */
+static uint32_t slot_checksum(const uint8_t *slot)
+{
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < CHECKPOINT_HEADER_SIZE + PAYLOAD_SIZE; i++)
+    {
+        if (i < 20 || i >= CHECKPOINT_HEADER_SIZE)
+        {
+            hash = (hash ^ slot[i]) * 16777619u;
+        }
+    }
+    return hash;
+}
+
+/**
+ * Function: checkpoint_encode
+ * ---------------------------
+ * Stores a checkpoint in its on-disk form, also used to send it to a standby.
+ *
+ * checkpoint: The checkpoint, with its sequence number.
+ * slot: Where the checkpoint is stored, CHECKPOINT_SLOT_SIZE bytes.
+ */
+void checkpoint_encode(const checkpoint_t *checkpoint, uint8_t *slot)
+{
+    memset(slot, 0, CHECKPOINT_SLOT_SIZE);
+    uint8_t *out = slot + CHECKPOINT_HEADER_SIZE;
+    put_u32(out, checkpoint->seed);
+    put_u32(out + 4, checkpoint->alien_ticks);
+    put_u64(out + 8, (uint64_t)checkpoint->start_ms);
+    put_u32(out + 16, checkpoint->tick);
+    put_u32(out + 20, (uint32_t)checkpoint->aliens_alive);
+    put_u32(out + 24, (uint32_t)checkpoint->last_aliens_alive);
+    put_u32(out + 28, (uint32_t)checkpoint->iterations);
+    put_u32(out + 32, (uint32_t)checkpoint->client_count);
+    for (int i = 0; i < 8; i++)
+    {
+        out[36 + i] = checkpoint->areas_occupied[i];
+    }
+
+    for (int i = 0; i < checkpoint->client_count; i++)
+    {
+        uint8_t *client_out = out + 44 + i * CLIENT_SIZE;
+        const ch_info_t *client = &checkpoint->clients[i];
+        client_out[0] = (uint8_t)client->ch;
+        client_out[1] = (uint8_t)client->pos_x;
+        client_out[2] = (uint8_t)client->pos_y;
+        client_out[3] = client->move;
+        client_out[4] = client->shoot;
+        memcpy(client_out + 5, client->ticket, 6); // The 7th byte is always '\0'
+        put_u32(client_out + 12, (uint32_t)client->score);
+        put_u64(client_out + 16, (uint64_t)client->hit_time);
+        put_u64(client_out + 24, (uint64_t)client->shoot_time);
+    }
+
+    uint8_t *board_out = out + 44 + MAX_CLIENTS * CLIENT_SIZE;
+    for (int x = 0; x < BOARD_HEIGHT; x++)
+    {
+        for (int y = 0; y < BOARD_WIDTH; y++)
+        {
+            put_u32(board_out + (x * BOARD_WIDTH + y) * 4, checkpoint->board[x][y]);
+        }
+    }
+
+    memcpy(slot, CHECKPOINT_MAGIC, 4);
+    put_u32(slot + 4, CHECKPOINT_VERSION);
+    put_u64(slot + 8, checkpoint->sequence);
+    put_u32(slot + 16, PAYLOAD_SIZE);
+    put_u32(slot + 20, slot_checksum(slot));
+}
+
+/**
+ * Function: checkpoint_decode
+ * ---------------------------
+ * Checks and reads back a checkpoint stored by checkpoint_encode.
+ *
+ * slot: The stored checkpoint, CHECKPOINT_SLOT_SIZE bytes.
+ * checkpoint: Where the checkpoint is stored.
+ *
+ * Returns false if the slot does not hold a complete checkpoint of this
+ * version, as after a write torn by a crash.
+ */
+bool checkpoint_decode(const uint8_t *slot, checkpoint_t *checkpoint)
+{
+    if (memcmp(slot, CHECKPOINT_MAGIC, 4) != 0 ||
+        get_u32(slot + 4) != CHECKPOINT_VERSION ||
+        get_u32(slot + 16) != PAYLOAD_SIZE ||
+        get_u32(slot + 20) != slot_checksum(slot))
+    {
+        return false;
+    }
+
+    memset(checkpoint, 0, sizeof(checkpoint_t));
+    checkpoint->sequence = get_u64(slot + 8);
+    const uint8_t *in = slot + CHECKPOINT_HEADER_SIZE;
+    checkpoint->seed = get_u32(in);
+    checkpoint->alien_ticks = get_u32(in + 4);
+    checkpoint->start_ms = (int64_t)get_u64(in + 8);
+    checkpoint->tick = get_u32(in + 16);
+    checkpoint->aliens_alive = (int)get_u32(in + 20);
+    checkpoint->last_aliens_alive = (int)get_u32(in + 24);
+    checkpoint->iterations = (int)get_u32(in + 28);
+    checkpoint->client_count = (int)get_u32(in + 32);
+    if (checkpoint->client_count > MAX_CLIENTS)
+    {
+        return false;
+    }
+    for (int i = 0; i < 8; i++)
+    {
+        checkpoint->areas_occupied[i] = in[36 + i];
+    }
+
+    for (int i = 0; i < checkpoint->client_count; i++)
+    {
+        const uint8_t *client_in = in + 44 + i * CLIENT_SIZE;
+        ch_info_t *client = &checkpoint->clients[i];
+        client->ch = client_in[0];
+        client->pos_x = client_in[1];
+        client->pos_y = client_in[2];
+        client->move = client_in[3];
+        client->shoot = client_in[4];
+        memcpy(client->ticket, client_in + 5, 6);
+        client->ticket[6] = '\0';
+        client->score = (int)get_u32(client_in + 12);
+        client->hit_time = (time_t)get_u64(client_in + 16);
+        client->shoot_time = (time_t)get_u64(client_in + 24);
+    }
+
+    const uint8_t *board_in = in + 44 + MAX_CLIENTS * CLIENT_SIZE;
+    for (int x = 0; x < BOARD_HEIGHT; x++)
+    {
+        for (int y = 0; y < BOARD_WIDTH; y++)
+        {
+            checkpoint->board[x][y] = get_u32(board_in + (x * BOARD_WIDTH + y) * 4);
+        }
+    }
+    return true;
+}
+
+/**
+ * Function: newest_checkpoint
+ * ---------------------------
+ * Reads the newest valid checkpoint of a checkpoint file.
+ *
+ * fd: The file.
+ * checkpoint: Where the checkpoint is stored.
+ *
+ * Returns false if neither slot holds a valid checkpoint.
+ */
+static bool newest_checkpoint(int fd, checkpoint_t *checkpoint)
+{
+    checkpoint_t other;
+    uint8_t slot[CHECKPOINT_SLOT_SIZE];
+    bool valid0 = pread(fd, slot, sizeof(slot), 0) == (ssize_t)sizeof(slot) && checkpoint_decode(slot, checkpoint);
+    bool valid1 = pread(fd, slot, sizeof(slot), CHECKPOINT_SLOT_SIZE) == (ssize_t)sizeof(slot) && checkpoint_decode(slot, &other);
+    if (valid1 && (!valid0 || other.sequence > checkpoint->sequence))
+    {
+        *checkpoint = other;
+    }
+    return valid0 || valid1;
+}
+
+/**
+ * Function: checkpoint_open
+ * -------------------------
+ * Opens a checkpoint file, creating it if it does not exist.
+ *
+ * path: The file.
+ *
+ * New checkpoints are numbered after the newest one already in the file, so
+ * they replace it even when a new match is started. Returns the open file, or
+ * NULL if it cannot be opened.
+ */
+checkpoint_file_t *checkpoint_open(const char *path)
+{
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+
+    checkpoint_file_t *file = malloc(sizeof(checkpoint_file_t));
+    file->fd = fd;
+    file->path = strdup(path);
+    file->sequence = 0;
+
+    checkpoint_t newest;
+    if (newest_checkpoint(fd, &newest))
+    {
+        file->sequence = newest.sequence;
+    }
+    return file;
+}
+
+/**
+ * Function: checkpoint_load
+ * -------------------------
+ * Reads the newest valid checkpoint of a file.
+ *
+ * file: The checkpoint file.
+ * checkpoint: Where the checkpoint is stored.
+ *
+ * Returns false if the file holds no valid checkpoint.
+ */
+bool checkpoint_load(checkpoint_file_t *file, checkpoint_t *checkpoint)
+{
+    return newest_checkpoint(file->fd, checkpoint);
+}
+
+/**
+ * Function: checkpoint_write
+ * --------------------------
+ * Writes a checkpoint over the older of the two slots of the file.
+ *
+ * file: The checkpoint file.
+ * checkpoint: The checkpoint. Its sequence number is assigned here.
+ *
+ * The slot is synced before returning, so once this returns the checkpoint
+ * survives a crash of the server or of the machine. Returns false if it
+ * cannot be written; the previous checkpoint is then still the newest one.
+ */
+bool checkpoint_write(checkpoint_file_t *file, checkpoint_t *checkpoint)
+{
+    uint8_t slot[CHECKPOINT_SLOT_SIZE];
+    checkpoint->sequence = file->sequence + 1;
+    checkpoint_encode(checkpoint, slot);
+
+    // Odd checkpoints go to the first slot and even ones to the second
+    off_t offset = (off_t)((checkpoint->sequence + 1) % 2) * CHECKPOINT_SLOT_SIZE;
+    if (pwrite(file->fd, slot, sizeof(slot), offset) != (ssize_t)sizeof(slot) || fdatasync(file->fd) != 0)
+    {
+        return false;
+    }
+    file->sequence = checkpoint->sequence;
+    return true;
+}
+
+/**
+ * Function: checkpoint_close
+ * --------------------------
+ * Closes a checkpoint file and frees it.
+ *
+ * file: The file to close. NULL is ignored.
+ * remove: If true, the file is deleted, so the next --resume starts a new
+ *         match; used when the match is over.
+ */
+void checkpoint_close(checkpoint_file_t *file, bool remove)
+{
+    if (file == NULL)
+    {
+        return;
+    }
+    close(file->fd);
+    if (remove)
+    {
+        unlink(file->path);
+    }
+    free(file->path);
+    free(file);
+}
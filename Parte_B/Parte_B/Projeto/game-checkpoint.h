@@ -0,0 +1,68 @@
+#ifndef __GAME_CHECKPOINT_H_INCLUDED__
+#define __GAME_CHECKPOINT_H_INCLUDED__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <ncurses.h>
+#include "remote-char.h"
+#include "common.h"
+
+#define CHECKPOINT_MAGIC "PSCP"
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_SLOT_SIZE 4096   // Bytes of each of the two copies in the file
+#define CHECKPOINT_HEADER_SIZE 24
+#define CHECKPOINT_DEFAULT_TICKS 1  // Alien ticks between two checkpoints
+
+/**
+ * Struct: checkpoint_t
+ * --------------------
+ * Everything needed to carry on a live match after the server restarts.
+ *
+ * sequence: Number of the checkpoint, increasing; the newest valid one is loaded.
+ * seed, alien_ticks, start_ms, tick: As in game_t.
+ * aliens_alive, last_aliens_alive, iterations: As in game_t.
+ * client_count, clients: The players, with their tickets, scores and cooldowns.
+ * areas_occupied: As in game_t.
+ * board: The cells inside the border of the board, with their attributes.
+ */
+typedef struct checkpoint_t
+{
+    uint64_t sequence;
+    uint32_t seed;
+    uint32_t alien_ticks;
+    int64_t start_ms;
+    uint32_t tick;
+    int aliens_alive;
+    int last_aliens_alive;
+    int iterations;
+    int client_count;
+    ch_info_t clients[MAX_CLIENTS];
+    bool areas_occupied[8];
+    uint32_t board[BOARD_HEIGHT][BOARD_WIDTH];
+} checkpoint_t;
+
+/**
+ * Struct: checkpoint_file_t
+ * -------------------------
+ * An open checkpoint file: two slots of CHECKPOINT_SLOT_SIZE bytes, written in
+ * turn, so a crash in the middle of a write leaves the other one intact.
+ *
+ * fd: The file.
+ * path: The path of the file.
+ * sequence: Sequence number of the last checkpoint in the file.
+ */
+typedef struct checkpoint_file_t
+{
+    int fd;
+    char *path;
+    uint64_t sequence;
+} checkpoint_file_t;
+
+void checkpoint_encode(const checkpoint_t *checkpoint, uint8_t *slot);
+bool checkpoint_decode(const uint8_t *slot, checkpoint_t *checkpoint);
+checkpoint_file_t *checkpoint_open(const char *path);
+bool checkpoint_load(checkpoint_file_t *file, checkpoint_t *checkpoint);
+bool checkpoint_write(checkpoint_file_t *file, checkpoint_t *checkpoint);
+void checkpoint_close(checkpoint_file_t *file, bool remove);
+
+#endif // __GAME_CHECKPOINT_H_INCLUDED__
@@ -0,0 +1,83 @@
+#include <stdlib.h>
+#include <zmq.h>
+#include "zhelpers.h"
+#include "game-clock.h"
+
+// The clock is the wall clock unless game_clock_use_virtual is called
+static bool virtual_clock = false;
+static int64_t virtual_now_ms = 0;
+
+/**
+ * Function: game_clock_use_virtual
+ * --------------------------------
+ * Switches the game clock to virtual time.
+ *
+ * start_ms: The time the virtual clock starts at, in milliseconds.
+ *
+ * A virtual clock only moves when game_clock_sleep_ms or game_clock_advance_to
+ * is called, so a single-threaded simulation can step game time as fast as the
+ * CPU allows. Must be called before any game thread is started.
+ */
+void game_clock_use_virtual(int64_t start_ms)
+{
+    virtual_clock = true;
+    virtual_now_ms = start_ms;
+}
+
+/**
+ * Function: game_clock_is_virtual
+ * -------------------------------
+ * Returns true if the game clock is running on virtual time.
+ */
+bool game_clock_is_virtual(void)
+{
+    return virtual_clock;
+}
+
+/**
+ * Function: game_clock_now_ms
+ * ---------------------------
+ * Returns the current game time, in milliseconds.
+ */
+int64_t game_clock_now_ms(void)
+{
+    return virtual_clock ? virtual_now_ms : s_clock();
+}
+
+/**
+ * Function: game_clock_sleep_ms
+ * -----------------------------
+ * Waits for the given amount of game time.
+ *
+ * ms: The time to wait, in milliseconds.
+ *
+ * On the wall clock this sleeps; on a virtual clock it returns immediately
+ * after moving the clock forward.
+ */
+void game_clock_sleep_ms(int64_t ms)
+{
+    if (virtual_clock)
+    {
+        virtual_now_ms += ms;
+    }
+    else
+    {
+        s_sleep((int)ms);
+    }
+}
+
+/**
+ * Function: game_clock_advance_to
+ * -------------------------------
+ * Moves a virtual clock forward to the given time. Has no effect on the wall
+ * clock, or if the time is in the past.
+ *
+ * ms: The new game time, in milliseconds.
+ */
+void game_clock_advance_to(int64_t ms)
+{
+    if (virtual_clock && ms > virtual_now_ms)
+    {
+        virtual_now_ms = ms;
+    }
+}
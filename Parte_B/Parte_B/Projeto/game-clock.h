@@ -0,0 +1,18 @@
+#ifndef __GAME_CLOCK_H_INCLUDED__
+#define __GAME_CLOCK_H_INCLUDED__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Periods of the game, in milliseconds of game time
+#define ALIEN_TICK_MS 1000
+#define ZAP_DURATION_MS 500
+#define GAME_OVER_DELAY_MS 5000
+
+void game_clock_use_virtual(int64_t start_ms);
+bool game_clock_is_virtual(void);
+int64_t game_clock_now_ms(void);
+void game_clock_sleep_ms(int64_t ms);
+void game_clock_advance_to(int64_t ms);
+
+#endif // __GAME_CLOCK_H_INCLUDED__
@@ -0,0 +1,1568 @@
+#include <ncurses.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <zmq.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include "zhelpers.h"
+#include "score_update.pb-c.h"
+#include "game-clock.h"
+#include "game-logic.h"
+#include "server-stats.h"
+#include "server-trace.h"
+#include "flight-recorder.h"
+#include "alien-step.h"
+#include "server-monitor.h"
+#include "server-replica.h"
+
+// create a mutex
+pthread_mutex_t mutex;
+
+cell_topology_t topology[WINDOW_SIZE][WINDOW_SIZE];
+
+/**
+ * Function: game_elapsed_ms
+ * -------------------------
+ * Returns the game clock time elapsed since the start of the match, in milliseconds.
+ *
+ * game: Pointer to the state of the match.
+ */
+uint32_t game_elapsed_ms(game_t *game)
+{
+    return (uint32_t)(game_clock_now_ms() - game->start_ms);
+}
+
+/**
+ * Function: game_time
+ * -------------------
+ * Returns the time of the event being processed, in seconds since the epoch.
+ *
+ * game: Pointer to the state of the match.
+ *
+ * All cooldowns are computed from this value instead of time(NULL), so that a
+ * replayed match sees exactly the same clock as the recorded one.
+ */
+time_t game_time(game_t *game)
+{
+    return (time_t)((game->start_ms + game->tick) / 1000);
+}
+
+/**
+ * Function: record_event
+ * ----------------------
+ * Appends an event to the replay log of the match, if it is being recorded,
+ * and sends it to the standby servers, if it is being replicated.
+ *
+ * game: Pointer to the state of the match.
+ * event: The kind of event.
+ * command: The command, for REPLAY_COMMAND events (NULL otherwise).
+ * x, y, is_horizontal: The zap line, for REPLAY_BULLET_EXPIRY events.
+ *
+ * Must be called with the mutex held, so the log order is the order in which
+ * events were applied to the board.
+ */
+void record_event(game_t *game, replay_event_t event, remote_char_t *command, int x, int y, bool is_horizontal)
+{
+    if (game->recorder == NULL && game->replica == NULL)
+    {
+        return;
+    }
+
+    replay_record_t record = {0};
+    record.tick = game->tick;
+    record.event = event;
+    if (command != NULL)
+    {
+        record.command = *command;
+    }
+    record.x = x;
+    record.y = y;
+    record.is_horizontal = is_horizontal;
+    if (game->recorder != NULL)
+    {
+        replay_log_write(game->recorder, &record);
+
+        // Flush once per alien tick, so a killed server loses at most one second of the match
+        if (event == REPLAY_ALIEN_TICK)
+        {
+            fflush(game->recorder->file);
+        }
+    }
+    if (game->replica != NULL)
+    {
+        replica_send_event(game->replica, &record);
+    }
+}
+
+/**
+ * Function: serialize_window
+ * --------------------------
+ * Serializes the contents of a window into a buffer.
+ *
+ * win: A pointer to the window to be serialized.
+ *
+ * Returns a pointer to the buffer containing the serialized window content,
+ * rows * cols characters and a terminating '\0'.
+ */
+char *serialize_window(WINDOW *win)
+{
+    int rows, cols;
+    getmaxyx(win, rows, cols);
+    char *buffer = (char *)malloc(rows * cols * sizeof(char) + 1);
+
+    for (int y = 0; y < rows; y++)
+    {
+        for (int x = 0; x < cols; x++)
+        {
+            buffer[y * cols + x] = mvwinch(win, y, x) & A_CHARTEXT;
+        }
+    }
+    buffer[rows * cols] = '\0';
+    return buffer;
+}
+
+// Publisher state, protected by the game lock like the socket itself
+static uint32_t frame_seq = 0;
+static uint32_t keyframe_seq = 0;
+static int64_t last_keyframe_ms = 0;
+
+/**
+ * Function: track_subscriptions
+ * -----------------------------
+ * Reads the subscription messages queued on the XPUB publisher and counts
+ * them by stream.
+ *
+ * publisher: A pointer to the ZeroMQ publisher socket.
+ *
+ * Each message is a byte, 1 to subscribe or 0 to unsubscribe, followed by the
+ * topic. A subscription to everything counts as one to every frame. Does
+ * nothing on a plain PUB socket.
+ *
+ * These are the only per-subscriber events the server sees: XPUB drops the
+ * frames of a full queue without telling the sender. The frames each
+ * subscriber lost are counted on its side, from the sequence numbers, in the
+ * dropped field of its frame_stream_t.
+ */
+static void track_subscriptions(void *publisher)
+{
+    char message[64];
+    int size;
+    while ((size = zmq_recv(publisher, message, sizeof(message), ZMQ_DONTWAIT)) > 0)
+    {
+        if (message[0] == 0)
+        {
+            stats_count(STAT_UNSUBSCRIPTIONS, 1);
+        }
+        else if (size - 1 <= (int)strlen(FRAME_TOPIC) && memcmp(message + 1, FRAME_TOPIC, size - 1) == 0)
+        {
+            stats_count(STAT_FRAME_SUBSCRIPTIONS, 1);
+        }
+        else if (size - 1 == (int)strlen(KEYFRAME_TOPIC) && memcmp(message + 1, KEYFRAME_TOPIC, size - 1) == 0)
+        {
+            stats_count(STAT_KEYFRAME_SUBSCRIPTIONS, 1);
+        }
+    }
+}
+
+/**
+ * Function: publish_frame
+ * -----------------------
+ * Sends a frame to the subscribers of a topic, as one multipart message.
+ *
+ * publisher: A pointer to the ZeroMQ publisher socket.
+ * topic: FRAME_TOPIC or KEYFRAME_TOPIC.
+ * seq: The sequence number of the frame on that topic.
+ * score_buffer, board_buffer: The serialized windows.
+ *
+ * A subscriber whose queue is full loses the whole message, never half of it,
+ * and sees the gap in the sequence numbers. Returns the bytes sent.
+ */
+static size_t publish_frame(void *publisher, const char *topic, uint32_t seq, const char *score_buffer, const char *board_buffer)
+{
+    uint32_t network_seq = htonl(seq);
+    size_t score_size = strlen(score_buffer);
+    size_t board_size = strlen(board_buffer);
+    zmq_send(publisher, topic, strlen(topic), ZMQ_SNDMORE);
+    zmq_send(publisher, &network_seq, sizeof(network_seq), ZMQ_SNDMORE);
+    zmq_send(publisher, score_buffer, score_size, ZMQ_SNDMORE);
+    zmq_send(publisher, board_buffer, board_size, 0);
+    return strlen(topic) + sizeof(network_seq) + score_size + board_size;
+}
+
+/**
+ * Function: send_to_subscribers
+ * -----------------------------
+ * Serializes the contents of the score and board windows and sends them to subscribers.
+ *
+ * publisher: A pointer to the ZeroMQ publisher socket, or NULL to only serialize.
+ * score_win: A pointer to the window representing the score.
+ * board_win: A pointer to the window representing the game board.
+ *
+ * Every frame goes to FRAME_TOPIC. At most one every KEYFRAME_INTERVAL_MS
+ * also goes to KEYFRAME_TOPIC, for the subscribers demoted after falling
+ * behind. Must be called with the game lock held.
+ */
+void send_to_subscribers(void *publisher, void *score_win, void *board_win)
+{
+    uint64_t start_ns = stats_now_ns();
+    trace_begin("publish");
+
+    // Serialize the content of the windows
+    char *board_buffer = serialize_window(board_win);
+    char *score_buffer = serialize_window(score_win);
+
+    // Send the serialized content to the subscribers (there are none when not live)
+    if (publisher != NULL)
+    {
+        track_subscriptions(publisher);
+        size_t bytes = publish_frame(publisher, FRAME_TOPIC, ++frame_seq, score_buffer, board_buffer);
+
+        int64_t now_ms = game_clock_now_ms();
+        if (now_ms - last_keyframe_ms >= KEYFRAME_INTERVAL_MS)
+        {
+            last_keyframe_ms = now_ms;
+            bytes += publish_frame(publisher, KEYFRAME_TOPIC, ++keyframe_seq, score_buffer, board_buffer);
+            stats_count(STAT_KEYFRAMES_PUBLISHED, 1);
+        }
+        stats_count(STAT_FRAMES_PUBLISHED, 1);
+        stats_count(STAT_BYTES_PUBLISHED, bytes);
+        flight_record(FLIGHT_PUBLISH, (int)bytes, 0);
+        stats_record(STAT_PUBLISH_NS, stats_now_ns() - start_ns);
+    }
+
+    // Free the allocated memory for the serialized buffers
+    free(score_buffer);
+    free(board_buffer);
+    trace_end("publish");
+}
+
+/**
+ * Function: open_publisher
+ * ------------------------
+ * Creates the socket the frames and the scores are published on.
+ *
+ * context: The ZeroMQ context of the server.
+ * endpoint: The endpoint to bind.
+ * hwm: The most messages queued for one subscriber; further frames are
+ *      dropped for that subscriber only.
+ * linger_ms: How long messages still queued are kept when the socket is closed.
+ *
+ * The socket is an XPUB, so the server sees the subscriptions, one message per
+ * subscriber. A stalled subscriber costs at most hwm messages of memory, and
+ * at most linger_ms of delay when the server exits.
+ */
+void *open_publisher(void *context, const char *endpoint, int hwm, int linger_ms)
+{
+    void *publisher = zmq_socket(context, ZMQ_XPUB);
+    int verbose = 1;
+    zmq_setsockopt(publisher, ZMQ_SNDHWM, &hwm, sizeof(hwm));
+    zmq_setsockopt(publisher, ZMQ_LINGER, &linger_ms, sizeof(linger_ms));
+    zmq_setsockopt(publisher, ZMQ_XPUB_VERBOSER, &verbose, sizeof(verbose)); // Every subscription and unsubscription
+    if (zmq_bind(publisher, endpoint) != 0)
+    {
+        perror("Error binding the publisher");
+        exit(1);
+    }
+    return publisher;
+}
+
+/**
+ * Function: new_position
+ * ----------------------
+ * Updates the coordinates based on the given direction.
+ *
+ * x: A pointer to the x-coordinate.
+ * y: A pointer to the y-coordinate.
+ * direction: The direction to move.
+ *
+ * This function does not return a value.
+ */
+void new_position(int *x, int *y, direction_t direction)
+{
+    switch (direction)
+    {
+    case UP:
+        (*x)--;
+        if (*x == 0)
+            *x = 1;
+        break;
+    case DOWN:
+        (*x)++;
+        if (*x == WINDOW_SIZE - 1)
+            *x = WINDOW_SIZE - 2;
+        break;
+    case LEFT:
+        (*y)--;
+        if (*y == 0)
+            *y = 1;
+        break;
+    case RIGHT:
+        (*y)++;
+        if (*y == WINDOW_SIZE - 1)
+            *y = WINDOW_SIZE - 2;
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * Function: draw_score
+ * --------------------
+ * Draws the score window with the current scores of the clients.
+ *
+ * score_win: A pointer to the window representing the score.
+ * clients: An array of client information structures.
+ * client_count: The number of clients connected.
+ *
+ * This function does not return a value.
+ */
+void draw_score(WINDOW *score_win, ch_info_t clients[], int client_count, void *zmq_socket)
+{
+    trace_begin("draw_score");
+    wclear(score_win);    // Clear the score window
+    box(score_win, 0, 0); // Redraw the border
+    mvwprintw(score_win, 1, 3, "Score");
+
+    // Print the scores of each client
+    for (int i = 0; i < client_count; i++)
+    {
+        mvwprintw(score_win, i + 2, 3, "%c - %d", clients[i].ch, clients[i].score);
+    }
+
+    monitor_touch(); // Let the monitor redraw the scores
+
+    // Initialize the Protobuf message for all scores
+    ScoreUpdates updates = SCORE_UPDATES__INIT;
+    updates.scores = malloc(client_count * sizeof(ScoreUpdate *));
+    updates.n_scores = client_count;
+
+    for (int i = 0; i < client_count; i++)
+    {
+        updates.scores[i] = malloc(sizeof(ScoreUpdate));
+        score_update__init(updates.scores[i]);
+        updates.scores[i]->ch = clients[i].ch;
+        updates.scores[i]->score = clients[i].score;
+    }
+
+    // Serialize the message
+    size_t len = score_updates__get_packed_size(&updates);
+    void *buffer = malloc(len);
+    score_updates__pack(&updates, buffer);
+
+    // Send the message to the ZeroMQ socket
+    if (zmq_socket != NULL)
+    {
+        zmq_send(zmq_socket, "scores ", 7, ZMQ_SNDMORE); // Topic
+        zmq_send(zmq_socket, buffer, len, 0);            // Message
+        stats_count(STAT_BYTES_PUBLISHED, 7 + len);
+    }
+
+    // Free the memory used for the buffer and scores
+    free(buffer);
+    for (int i = 0; i < client_count; i++)
+    {
+        free(updates.scores[i]);
+    }
+    free(updates.scores);
+    trace_end("draw_score");
+}
+
+/**
+ * Function: publish_match_end
+ * ---------------------------
+ * Publishes an empty scores message, telling the subscribers that every player
+ * has left and their scores are final.
+ *
+ * zmq_socket: The socket the scores are published on.
+ *
+ * This function does not return a value.
+ */
+void publish_match_end(void *zmq_socket)
+{
+    if (zmq_socket != NULL)
+    {
+        zmq_send(zmq_socket, "scores ", 7, ZMQ_SNDMORE); // Topic
+        zmq_send(zmq_socket, "", 0, 0);                 // No scores
+        stats_count(STAT_BYTES_PUBLISHED, 7);
+    }
+}
+
+/**
+ * Function: add_client
+ * --------------------
+ * Adds a new client to the clients array.
+ *
+ * clients: An array of client information structures.
+ * client_count: A pointer to the number of clients connected.
+ * ch: The character representing the client.
+ * pos_x: The x-coordinate of the client's position.
+ * pos_y: The y-coordinate of the client's position.
+ * ticket: The ticket string for the client.
+ *
+ * This function does not return a value.
+ */
+void add_client(ch_info_t clients[], int *client_count, int ch, int pos_x, int pos_y, char ticket[7])
+{
+    clients[*client_count].ch = ch;
+    clients[*client_count].pos_x = pos_x;
+    clients[*client_count].pos_y = pos_y;
+    clients[*client_count].score = 0;
+    clients[*client_count].move = true;
+    clients[*client_count].shoot = true;
+    (*client_count)++;
+}
+
+/**
+ * Function: remove_client
+ * -----------------------
+ * Removes a client from the clients array.
+ *
+ * clients: An array of client information structures.
+ * client_count: A pointer to the number of clients connected.
+ * ch: The character representing the client to be removed.
+ *
+ * This function does not return a value.
+ */
+void remove_client(ch_info_t clients[], int *client_count, int ch)
+{
+    for (int i = 0; i < *client_count; i++)
+    {
+        if (clients[i].ch == ch)
+        {
+            // Shift the remaining clients to fill the gap
+            for (int j = i; j < *client_count - 1; j++)
+            {
+                clients[j] = clients[j + 1];
+            }
+            (*client_count)--; // Decrement the client count
+            break;
+        }
+    }
+}
+
+/**
+ * Function: find_ch_info
+ * ----------------------
+ * Finds the index of a client in the clients array based on the character.
+ *
+ * clients: An array of client information structures.
+ * client_count: The number of clients connected.
+ * ch: The character representing the client.
+ *
+ * Returns the index of the client if found, -1 otherwise.
+ */
+int find_ch_info(ch_info_t clients[], int client_count, int ch)
+{
+    for (int i = 0; i < client_count; i++)
+    {
+        if (clients[i].ch == ch)
+        {
+            return i;
+        }
+    }
+    return -1; // Return -1 if the client is not found
+}
+
+/**
+ * Function: area_of
+ * -----------------
+ * Determines the area of a cell from the IS_AREA_* macros.
+ *
+ * line: The x-coordinate.
+ * column: The y-coordinate.
+ *
+ * Only used to build the topology table. Returns 'A' to 'H', or '\0'.
+ */
+static char area_of(int line, int column)
+{
+    if (IS_AREA_A(line, column))
+        return 'A';
+    if (IS_AREA_B(line, column))
+        return 'B';
+    if (IS_AREA_C(line, column))
+        return 'C';
+    if (IS_AREA_D(line, column))
+        return 'D';
+    if (IS_AREA_E(line, column))
+        return 'E';
+    if (IS_AREA_F(line, column))
+        return 'F';
+    if (IS_AREA_G(line, column))
+        return 'G';
+    if (IS_AREA_H(line, column))
+        return 'H';
+    return '\0'; // Return null character if not in any area
+}
+
+/**
+ * Function: build_topology
+ * ------------------------
+ * Fills the topology table from the geometry of the board: the area of every
+ * cell, the moves that keep a player inside it and the orientation of its zaps.
+ *
+ * The geometry is fixed, so this only has to run once, before the first
+ * command; setup_game calls it. Calling it again rebuilds the same table.
+ */
+void build_topology(void)
+{
+    for (int line = 0; line < WINDOW_SIZE; line++)
+    {
+        for (int column = 0; column < WINDOW_SIZE; column++)
+        {
+            cell_topology_t *cell = &topology[line][column];
+            cell->area = area_of(line, column);
+            cell->zap_horizontal = cell->area == 'A' || cell->area == 'D' || cell->area == 'F' || cell->area == 'H';
+            cell->moves = 0;
+            if (cell->area == '\0')
+            {
+                continue;
+            }
+            for (direction_t direction = UP; direction <= RIGHT; direction++)
+            {
+                int x = line, y = column;
+                new_position(&x, &y, direction);
+                if ((x != line || y != column) && area_of(x, y) == cell->area)
+                {
+                    cell->moves |= 1 << direction;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Function: get_player_area
+ * -------------------------
+ * Determines the area of the board where the given coordinates are located.
+ *
+ * line: The x-coordinate.
+ * column: The y-coordinate.
+ *
+ * Returns a character representing the area, '\0' outside the areas.
+ */
+char get_player_area(int line, int column)
+{
+    if (line < 0 || line >= WINDOW_SIZE || column < 0 || column >= WINDOW_SIZE)
+    {
+        return '\0';
+    }
+    return topology[line][column].area;
+}
+
+/**
+ * Function: are_coords_in_same_area
+ * ---------------------------------
+ * Checks if two sets of coordinates are in the same area.
+ *
+ * line1: The x-coordinate of the first position.
+ * column1: The y-coordinate of the first position.
+ * line2: The x-coordinate of the second position.
+ * column2: The y-coordinate of the second position.
+ *
+ * Returns true if the coordinates are in the same area, false otherwise.
+ */
+bool are_coords_in_same_area(int line1, int column1, int line2, int column2)
+{
+    char area1 = get_player_area(line1, column1);
+    char area2 = get_player_area(line2, column2);
+    return area1 != '\0' && area1 == area2;
+}
+
+/**
+ * Function: ChoosePlayerArea
+ * --------------------------
+ * Chooses a random player area that is not occupied.
+ *
+ * areas_occupied: An array indicating which areas are occupied.
+ *
+ * Returns the index of the chosen area.
+ */
+int ChoosePlayerArea(bool areas_occupied[])
+{
+    int area = (rand() % 8);
+
+    // Keep generating a random area until an unoccupied one is found
+    while (areas_occupied[area] == true)
+    {
+        area = (rand() % 8);
+    }
+
+    return area;
+}
+
+/**
+ * Function: ChoosePlayerPosition
+ * ------------------------------
+ * Chooses a random position within the given area.
+ *
+ * area: The index of the area.
+ * x: A pointer to the x-coordinate.
+ * y: A pointer to the y-coordinate.
+ *
+ * This function does not return a value.
+ */
+void ChoosePlayerPosition(int area, int *x, int *y)
+{
+    switch (area)
+    {
+
+    // Area A - Left
+    case 0:
+        *x = (rand() % (18 - 3 + 1)) + 3;
+        *y = 1;
+        break;
+    // Area B - Bottom
+    case 1:
+        *x = 19;
+        *y = (rand() % (18 - 3 + 1)) + 3;
+        break;
+    // Area C - Bottom
+    case 2:
+        *x = 20;
+        *y = (rand() % (18 - 3 + 1)) + 3;
+        break;
+    // Area D - Right
+    case 3:
+        *x = (rand() % (18 - 3 + 1)) + 3;
+        *y = 19;
+        break;
+    // Area E - Top
+    case 4:
+        *x = 1;
+        *y = (rand() % (18 - 3 + 1)) + 3;
+        break;
+    // Area F - Right
+    case 5:
+        *x = (rand() % (18 - 3 + 1)) + 3;
+        *y = 20;
+        break;
+    // Area G - Top
+    case 6:
+        *x = 2;
+        *y = (rand() % (18 - 3 + 1)) + 3;
+        break;
+    // Area H - Left
+    case 7:
+        *x = (rand() % (18 - 3 + 1)) + 3;
+        *y = 2;
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * Function: clear_zap
+ * -------------------
+ * Removes a zap line, and the aliens it hit, from the board.
+ *
+ * game: Pointer to the state of the match.
+ * x: The x-coordinate of the zap.
+ * y: The y-coordinate of the zap.
+ * is_horizontal: Boolean indicating if the zap is horizontal.
+ *
+ * Must be called with the mutex held. This function does not return a value.
+ */
+void clear_zap(game_t *game, int x, int y, bool is_horizontal)
+{
+    WINDOW *board_win = game->board_win;
+    record_event(game, REPLAY_BULLET_EXPIRY, NULL, x, y, is_horizontal);
+
+    for (int i = 1; i <= 20; i++)
+    {
+
+        if (is_horizontal)
+        {
+            if (mvwinch(board_win, x, i) == '-' || mvwinch(board_win, x, i) == '*')
+            {
+                mvwaddch(board_win, x, i, ' '); // Remove the bullet or alien
+            }
+        }
+        else
+        {
+            if (mvwinch(board_win, i, y) == '|' || mvwinch(board_win, i, y) == '*')
+            {
+                mvwaddch(board_win, i, y, ' '); // Remove the bullet or alien
+            }
+        }
+    }
+}
+
+/**
+ * Function: remove_bullets
+ * ------------------------
+ * Removes bullets from the board after a delay.
+ *
+ * arg: A pointer to a zap_info structure containing information about the zap.
+ *      It is allocated by the caller and freed by this function.
+ *
+ * This function does not return a value.
+ *
+ * The function runs as a separate thread and waits for ZAP_DURATION_MS before
+ * removing bullets or aliens from the board. It then marks the board for the
+ * monitor and notifies subscribers of the update.
+ */
+void *remove_bullets(void *arg)
+{
+    zap_info *info = (zap_info *)arg;
+    game_t *game = info->game;
+    game_clock_sleep_ms(ZAP_DURATION_MS); // Wait for 500 milliseconds
+
+    pthread_mutex_lock(&mutex);
+    trace_begin("bullet expiry");
+    flight_record(FLIGHT_BULLET_EXPIRY, info->x, info->y);
+    game->tick = game_elapsed_ms(game);
+    clear_zap(game, info->x, info->y, info->is_horizontal);
+    monitor_touch();                                                        // Let the monitor redraw the board
+    send_to_subscribers(game->publisher, game->score_win, game->board_win); // Notify subscribers of the update
+    trace_end("bullet expiry");
+    pthread_mutex_unlock(&mutex);
+
+    free(info);
+    return NULL;
+}
+
+/**
+ * Function: update_clients
+ * ------------------------
+ * Updates the status of clients based on the zap effect.
+ *
+ * board_win: A pointer to the window representing the game board.
+ * x: The x-coordinate of the zap.
+ * y: The y-coordinate of the zap.
+ * ch: The character representing the client.
+ * client_count: The number of clients connected.
+ * clients: An array of client information structures.
+ * is_horizontal: A boolean indicating if the zap is horizontal.
+ * current_time: The time of the zap.
+ *
+ * This function does not return a value.
+ */
+void update_clients(WINDOW *board_win, int x, int y, char ch, int client_count, ch_info_t clients[], bool is_horizontal, time_t current_time)
+{
+    // Find the index of the client who fired the zap
+    int player = find_ch_info(clients, client_count, ch);
+    for (int i = 0; i < client_count; i++)
+    {
+        // Check if the client is in the line of the zap
+        if ((is_horizontal && clients[i].pos_x == x) || (!is_horizontal && clients[i].pos_y == y))
+        {
+            if (i != player)
+            {
+                // Disable movement and shooting for the hit client
+                clients[i].move = false;
+                clients[i].shoot = false;
+                // Record the time the client was hit
+                clients[i].hit_time = current_time;
+            }
+        }
+    }
+}
+
+/**
+ * Function: zap_effect
+ * --------------------
+ * Applies the zap effect on the board and updates the score.
+ *
+ * board_win: A pointer to the window representing the game board.
+ * x: The x-coordinate of the zap.
+ * y: The y-coordinate of the zap.
+ * aliens_alive: A pointer to the number of aliens alive.
+ * clients: An array of client information structures.
+ * client_count: The number of clients connected.
+ * ch: The character representing the client.
+ *
+ * Returns true if the zap is horizontal, false otherwise.
+ */
+bool zap_effect(WINDOW *board_win, int x, int y, int *aliens_alive, ch_info_t clients[], int client_count, char ch)
+{
+
+    // verify if shot is horizontal or vertical
+    bool is_horizontal = topology[x][y].zap_horizontal;
+    if (is_horizontal)
+    {
+        // Horizontal zap
+        for (int i = 0; i <= 20; i++)
+        {
+            if (mvwinch(board_win, x, i) == '*')
+            {
+                // Increment the score of the client who fired the zap
+                clients[find_ch_info(clients, client_count, ch)].score += 1;
+                (*aliens_alive)--; // Decrement the number of alive aliens
+                stats_count(STAT_ALIENS_KILLED, 1);
+            }
+            if (mvwinch(board_win, x, i) == ' ' || mvwinch(board_win, x, i) == '*')
+            {
+                // Display the zap effect
+                mvwaddch(board_win, x, i, '-');
+            }
+        }
+    }
+    else
+    {
+        // Vertical zap
+        for (int i = 0; i <= 20; i++)
+        {
+            if (mvwinch(board_win, i, y) == '*')
+            {
+                // Increment the score of the client who fired the zap
+                clients[find_ch_info(clients, client_count, ch)].score += 1;
+                (*aliens_alive)--; // Decrement the number of alive aliens
+                stats_count(STAT_ALIENS_KILLED, 1);
+            }
+            if (mvwinch(board_win, i, y) == ' ' || mvwinch(board_win, i, y) == '*')
+            {
+                // Display the zap effect
+                mvwaddch(board_win, i, y, '|');
+            }
+        }
+    }
+    monitor_touch();      // Let the monitor redraw the board with the zap
+    return is_horizontal; // Return whether the zap was horizontal or vertical
+}
+
+/**
+ * Function: spawn_aliens
+ * ----------------------
+ * Spawns aliens at random free positions of the alien space.
+ *
+ * board_win: A pointer to the window representing the game board.
+ * number_of_aliens: The number of aliens to spawn.
+ *
+ * The free cells are collected in one pass and the aliens are placed with a
+ * partial Fisher-Yates shuffle over them, so the cost does not grow as the
+ * board fills up. Returns the number of aliens spawned, which is less than
+ * requested if there are not enough free cells.
+ */
+int spawn_aliens(WINDOW *board_win, int number_of_aliens)
+{
+    int free_cells[16 * 16];
+    int free_count = 0;
+
+    // Collect the empty cells of the alien space
+    for (int x = 3; x <= 18; x++)
+    {
+        for (int y = 3; y <= 18; y++)
+        {
+            if (mvwinch(board_win, x, y) == ' ')
+            {
+                free_cells[free_count++] = x * WINDOW_SIZE + y;
+            }
+        }
+    }
+    if (number_of_aliens > free_count)
+    {
+        number_of_aliens = free_count;
+    }
+
+    // Draw each alien's cell from the cells not taken yet
+    for (int i = 0; i < number_of_aliens; i++)
+    {
+        int j = i + rand() % (free_count - i);
+        int cell = free_cells[j];
+        free_cells[j] = free_cells[i];
+        free_cells[i] = cell;
+        mvwaddch(board_win, cell / WINDOW_SIZE, cell % WINDOW_SIZE, '*');
+    }
+    stats_count(STAT_ALIENS_SPAWNED, number_of_aliens);
+
+    // Let the monitor redraw the board with the newly spawned aliens
+    monitor_touch();
+    return number_of_aliens;
+}
+
+/**
+ * Function: update_aliens_alive
+ * -----------------------------
+ * Updates the number of alive aliens on the board.
+ *
+ * aliens_alive: Pointer to the current number of alive aliens.
+ * last_aliens_alive: Pointer to the last recorded number of alive aliens.
+ * iterations: Pointer to the number of iterations since the last change in the number of alive aliens.
+ * board_win: Pointer to the window representing the game board.
+ *
+ * This function checks if the number of alive aliens has changed. If it has, it resets the iteration count.
+ * If the number of alive aliens has not changed for 10 iterations, it spawns new aliens based on 10% of the current
+ * number of alive aliens, with a minimum of 1 and a maximum of 256 aliens.
+ */
+void update_aliens_alive(int *aliens_alive, int *last_aliens_alive, int *iterations, WINDOW *board_win)
+{
+    if (*aliens_alive != *last_aliens_alive)
+    {
+        // If the number of alive aliens has changed, update the last recorded number and reset iterations
+        *last_aliens_alive = *aliens_alive;
+        *iterations = 0;
+    }
+    else
+    {
+        // If the number of alive aliens has not changed, increment the iteration count
+        (*iterations)++;
+        if (*iterations >= 10)
+        {
+            // If the number of iterations reaches 10, calculate the number of new aliens to spawn
+            int increment = (int)(*aliens_alive * 0.1);
+            if (increment < 1)
+                increment = 1;
+            if (*aliens_alive + increment > 256)
+                increment = 256 - *aliens_alive;
+
+            // Spawn new aliens and update the number of alive aliens
+            *aliens_alive += spawn_aliens(board_win, increment);
+
+            // Update the last recorded number of alive aliens and reset iterations
+            *last_aliens_alive = *aliens_alive;
+            *iterations = 0;
+        }
+    }
+}
+
+/**
+ * Function: alien_step
+ * --------------------
+ * Moves every alien at most once and respawns aliens if needed.
+ *
+ * game: Pointer to the state of the match.
+ *
+ * The alien space is copied to a grid, stepped by alien_grid_step into a
+ * second grid, and the cells that changed are written back. Every alien
+ * therefore moves from where it was at the start of the tick. The 16 rows of
+ * the alien space are a single tile, so the step always runs on the calling
+ * thread; the pool only pays off on the larger grids of micro-bench.
+ *
+ * Must be called with the mutex held, so the whole sweep is applied
+ * atomically with respect to client commands. This function does not return
+ * a value.
+ */
+void alien_step(game_t *game)
+{
+    WINDOW *board_win = game->board_win;
+    uint8_t current[16 * 16], next[16 * 16];
+    record_event(game, REPLAY_ALIEN_TICK, NULL, 0, 0, false);
+
+    for (int x = 3; x <= 18; x++)
+    {
+        for (int y = 3; y <= 18; y++)
+        {
+            chtype cell = mvwinch(board_win, x, y);
+            current[(x - 3) * 16 + y - 3] = cell == '*' ? CELL_ALIEN : cell == ' ' ? CELL_FREE : CELL_BLOCKED;
+        }
+    }
+
+    alien_grid_step(current, next, 16, 16, game->seed, game->alien_ticks++);
+
+    for (int i = 0; i < 16 * 16; i++)
+    {
+        if (next[i] != current[i])
+        {
+            mvwaddch(board_win, i / 16 + 3, i % 16 + 3, next[i] == CELL_ALIEN ? '*' : ' ');
+        }
+    }
+
+    // Update the number of alive aliens
+    update_aliens_alive(&game->aliens_alive, &game->last_aliens_alive, &game->iterations, board_win);
+}
+
+/**
+ * Function: move_alien
+ * --------------------
+ * Thread function that moves aliens on the game board.
+ *
+ * arg: Pointer to the game_t structure of the match.
+ *
+ * This function moves the aliens once per second until the match ends, updates the display,
+ * and sends updates to subscribers. Every checkpoint_ticks ticks it also checkpoints the
+ * match, if the match is checkpointed.
+ */
+void *move_alien(void *arg)
+{
+    game_t *game = (game_t *)arg;
+    trace_thread_name("aliens");
+    static checkpoint_t checkpoint;
+
+    while (1)
+    {
+        pthread_mutex_lock(&mutex);
+        if (!game->running)
+        {
+            pthread_mutex_unlock(&mutex);
+            break;
+        }
+        uint64_t start_ns = stats_now_ns();
+        watchdog_begin(WATCH_TICK);
+        trace_begin("alien tick");
+        flight_record(FLIGHT_TICK_BEGIN, 0, 0);
+        game->tick = game_elapsed_ms(game);
+        alien_step(game);
+
+        // Let the monitor redraw the board and send updates to subscribers
+        monitor_touch();
+        send_to_subscribers(game->publisher, game->score_win, game->board_win);
+        flight_record(FLIGHT_TICK_END, game->aliens_alive, 0);
+        trace_end("alien tick");
+        watchdog_end(WATCH_TICK);
+        stats_record(STAT_TICK_NS, stats_now_ns() - start_ns);
+
+        // Copy the state under the lock, write it to disk without it
+        bool checkpointing = game->checkpoint != NULL && game->alien_ticks % game->checkpoint_ticks == 0;
+        if (checkpointing)
+        {
+            capture_checkpoint(game, &checkpoint);
+        }
+        pthread_mutex_unlock(&mutex);
+
+        if (checkpointing)
+        {
+            trace_begin("checkpoint");
+            if (!checkpoint_write(game->checkpoint, &checkpoint))
+            {
+                perror("Error writing checkpoint");
+            }
+            trace_end("checkpoint");
+        }
+
+        game_clock_sleep_ms(ALIEN_TICK_MS);
+    }
+    return NULL;
+}
+
+/**
+ * Function: move_player
+ * ---------------------
+ * Moves a player on the board based on the direction provided in the buffer.
+ *
+ * board_win: A pointer to the window representing the game board.
+ * client_count: The number of clients connected.
+ * clients: An array of client information structures.
+ * buffer: A structure containing the character and direction information.
+ *
+ * This function does not return a value.
+ */
+void move_player(WINDOW *board_win, int client_count, ch_info_t clients[], remote_char_t buffer)
+{
+    // Find the index of the client based on the character in the buffer
+    int index = find_ch_info(clients, client_count, buffer.ch);
+    if (index != -1 && clients[index].move)
+    {
+        int pos_x, pos_y;
+        pos_x = clients[index].pos_x;
+        pos_y = clients[index].pos_y;
+
+        // Move to the current position and clear the character
+        wmove(board_win, pos_x, pos_y);
+        waddch(board_win, ' ');
+
+        // Move only if the table says the player stays within the same area
+        if ((unsigned)buffer.direction <= RIGHT && topology[pos_x][pos_y].moves & (1 << buffer.direction))
+        {
+            new_position(&pos_x, &pos_y, buffer.direction);
+        }
+
+        // Update the player's position
+        clients[index].pos_x = pos_x;
+        clients[index].pos_y = pos_y;
+
+        // Move to the new position and draw the character
+        wmove(board_win, pos_x, pos_y);
+        waddch(board_win, buffer.ch | A_BOLD);
+    }
+}
+
+/**
+ * Function: generate_ticket
+ * -------------------------
+ * Generates a random ticket string.
+ *
+ * ticket: A pointer to the buffer where the ticket will be stored.
+ * size: The size of the ticket buffer.
+ *
+ * This function does not return a value.
+ */
+void generate_ticket(char *ticket, size_t size)
+{
+    static const char charset[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+    for (size_t i = 0; i < size - 1; i++)
+    {
+        ticket[i] = charset[rand() % (sizeof(charset) - 1)];
+    }
+    ticket[size - 1] = '\0'; // Null-terminate the string
+}
+
+/**
+ * Function: validate_ticket
+ * -------------------------
+ * Validates a ticket for a given character.
+ *
+ * clients: An array of client information structures.
+ * client_count: The number of clients connected.
+ * ch: The character to validate.
+ * ticket: The ticket string to validate.
+ *
+ * Returns true if the ticket is valid, false otherwise.
+ */
+bool validate_ticket(ch_info_t clients[], int client_count, char ch, char ticket[7])
+{
+    for (int i = 0; i < client_count; i++)
+    {
+        if (clients[i].ch == ch)
+        {
+            return strcmp(clients[i].ticket, ticket) == 0; // Returns true if the ticket matches
+        }
+    }
+    return false; // Character not found or invalid ticket
+}
+
+/**
+ * Function: update_client_status
+ * ------------------------------
+ * Updates the status of clients based on the current time.
+ *
+ * clients: An array of client information structures.
+ * client_count: The number of clients connected.
+ * current_time: The current time.
+ *
+ * This function does not return a value.
+ */
+void update_client_status(ch_info_t clients[], int client_count, time_t current_time)
+{
+    for (int i = 0; i < client_count; i++)
+    {
+        if (!clients[i].move && (current_time - clients[i].hit_time) >= 10)
+        {
+            clients[i].move = true;  // Allow movement after 10 seconds
+            clients[i].shoot = true; // Allow shooting after 10 seconds
+        }
+
+        if (!clients[i].shoot && (current_time - clients[i].shoot_time) >= 3 && clients[i].move)
+        {
+            clients[i].shoot = true; // Allow shooting after 3 seconds
+        }
+    }
+}
+
+/**
+ * Function: schedule_zap_removal
+ * ------------------------------
+ * Arranges for a zap to be removed from the board ZAP_DURATION_MS after it was fired.
+ *
+ * game: Pointer to the state of the match.
+ * x, y, is_horizontal: The zap line.
+ *
+ * A live server removes it from a separate thread and a simulation from its
+ * event loop. When replaying, the removal is an event of the log, so nothing
+ * is scheduled. This function does not return a value.
+ */
+void schedule_zap_removal(game_t *game, int x, int y, bool is_horizontal)
+{
+    if (game->mode == GAME_LIVE)
+    {
+        pthread_t shoot_thread;
+        zap_info *info = malloc(sizeof(zap_info));
+        *info = (zap_info){game, x, y, is_horizontal};
+        pthread_create(&shoot_thread, NULL, remove_bullets, info);
+        pthread_detach(shoot_thread);
+    }
+    else if (game->mode == GAME_SIMULATION)
+    {
+        if (game->pending_zap_count == MAX_CLIENTS)
+        {
+            // Cannot happen with the shooting cooldown; remove the zap right away
+            clear_zap(game, x, y, is_horizontal);
+            return;
+        }
+        game->pending_zaps[game->pending_zap_count++] = (pending_zap_t){game->tick + ZAP_DURATION_MS, x, y, is_horizontal};
+    }
+}
+
+/**
+ * Function: expire_cooldowns
+ * --------------------------
+ * Lets the players move and fire again once their cooldowns are over, at the
+ * time of the event being processed.
+ *
+ * game: Pointer to the state of the match.
+ *
+ * Calling it again at the same time changes nothing, so a batch of commands
+ * applied at one time needs it once. Must be called with the mutex held.
+ */
+void expire_cooldowns(game_t *game)
+{
+    update_client_status(game->clients, game->client_count, game_time(game));
+}
+
+/**
+ * Function: handle_command
+ * ------------------------
+ * Applies a command received from a client to the match.
+ *
+ * game: Pointer to the state of the match.
+ * buffer: The command. For a join, it is updated with the character and ticket
+ *         assigned to the new player, or with the ticket "FULL".
+ *
+ * Same as expire_cooldowns followed by apply_command. Must be called with the
+ * mutex held. This function does not return a value.
+ */
+void handle_command(game_t *game, remote_char_t *buffer)
+{
+    expire_cooldowns(game);
+    apply_command(game, buffer);
+}
+
+/**
+ * Function: apply_command
+ * -----------------------
+ * Applies a command received from a client to the match, without expiring
+ * the cooldowns first.
+ *
+ * game: Pointer to the state of the match.
+ * buffer: The command, as for handle_command.
+ *
+ * Accepted commands are appended to the replay log; every command is counted
+ * in the server stats. Nothing is published: the caller publishes once after
+ * the command, or after a batch of them. Must be called with the mutex held.
+ * This function does not return a value.
+ */
+void apply_command(game_t *game, remote_char_t *buffer)
+{
+    WINDOW *board_win = game->board_win;
+    ch_info_t *clients = game->clients;
+    int pos_x, pos_y;
+
+    if (buffer->msg_type >= 0 && buffer->msg_type <= 3)
+    {
+        stats_count(STAT_COMMANDS_JOIN + buffer->msg_type, 1);
+    }
+    else
+    {
+        stats_count(STAT_COMMANDS_UNKNOWN, 1);
+    }
+    if (buffer->msg_type >= 1 && buffer->msg_type <= 3 && !validate_ticket(clients, game->client_count, buffer->ch, buffer->ticket))
+    {
+        stats_count(STAT_TICKETS_REJECTED, 1);
+        return;
+    }
+
+    // Process message types: 0 - join, 1 - move, 2 - fire, 3 - leave
+    if (buffer->msg_type == 0)
+    {
+        if (game->client_count == MAX_CLIENTS) // Check if the maximum number of clients is reached
+        {
+            strcpy(buffer->ticket, "FULL");
+            stats_count(STAT_FULL_REJECTED, 1);
+        }
+        else
+        {
+            record_event(game, REPLAY_COMMAND, buffer, 0, 0, false);
+
+            int area = ChoosePlayerArea(game->areas_occupied); // Assign a free area to the new player.
+            game->areas_occupied[area] = true;
+            ChoosePlayerPosition(area, &pos_x, &pos_y); // Select a position in the assigned area.
+
+            int count = game->client_count;
+            char ch_client = area + 'A';                                                        // Assign a character based on the area.
+            generate_ticket(clients[count].ticket, sizeof(clients[count].ticket));              // Generate a unique ticket for the client.
+            add_client(clients, &game->client_count, ch_client, pos_x, pos_y, clients[count].ticket); // Add the client to the list.
+
+            // Since the count has been incremented, the current client is at index client_count - 1.
+            strcpy(buffer->ticket, clients[game->client_count - 1].ticket);
+            buffer->ch = ch_client;
+            flight_record(FLIGHT_JOIN, ch_client, 0);
+
+            wmove(board_win, pos_x, pos_y);        // Move to the player's position.
+            waddch(board_win, ch_client | A_BOLD); // Display the player's character on the board.
+        }
+    }
+    else if (buffer->msg_type == 1)
+    {
+        // A move of several cells is applied and logged one cell at a time, as if sent cell by cell
+        int steps = buffer->steps < 1 ? 1 : buffer->steps > MAX_MOVE_STEPS ? MAX_MOVE_STEPS : buffer->steps;
+        remote_char_t step = *buffer;
+        step.steps = 1;
+        for (int i = 0; i < steps; i++)
+        {
+            record_event(game, REPLAY_COMMAND, &step, 0, 0, false);
+            move_player(board_win, game->client_count, clients, step); // Move the player.
+        }
+    }
+    else if (buffer->msg_type == 2)
+    {
+        record_event(game, REPLAY_COMMAND, buffer, 0, 0, false);
+
+        int index = find_ch_info(clients, game->client_count, buffer->ch);
+        int x = clients[index].pos_x;
+        int y = clients[index].pos_y;
+
+        if (clients[index].shoot == true) // Check if the player can shoot
+        {
+            bool is_horizontal = zap_effect(board_win, x, y, &game->aliens_alive, clients, game->client_count, buffer->ch);
+            schedule_zap_removal(game, x, y, is_horizontal);
+            update_clients(board_win, x, y, buffer->ch, game->client_count, clients, is_horizontal, game_time(game));
+            draw_score(game->score_win, clients, game->client_count, game->publisher); // Update the score.
+
+            clients[index].shoot_time = game_time(game); // Record the shoot time.
+            clients[index].shoot = false;                // Prevent the player from shooting again immediately.
+        }
+    }
+    else if (buffer->msg_type == 3)
+    {
+        record_event(game, REPLAY_COMMAND, buffer, 0, 0, false);
+
+        int index = find_ch_info(clients, game->client_count, buffer->ch);
+        wmove(board_win, clients[index].pos_x, clients[index].pos_y);
+        waddch(board_win, ' ');                                                                          // Clear the player's position.
+        game->areas_occupied[get_player_area(clients[index].pos_x, clients[index].pos_y) - 'A'] = false; // Mark the area as unoccupied.
+        remove_client(clients, &game->client_count, buffer->ch);                                         // Remove the client from the list.
+        flight_record(FLIGHT_LEAVE, buffer->ch, 0);
+        draw_score(game->score_win, clients, game->client_count, game->publisher);
+    }
+}
+
+/**
+ * Function: apply_event
+ * ---------------------
+ * Applies an event of a replay log or of a replication stream to the match.
+ *
+ * game: Pointer to the state of the match.
+ * record: The event.
+ *
+ * The events go through the same functions as in the match they come from,
+ * so the board ends up the same. Must be called with the mutex held, if other
+ * threads use the match. This function does not return a value.
+ */
+void apply_event(game_t *game, const replay_record_t *record)
+{
+    game->tick = record->tick;
+    switch (record->event)
+    {
+    case REPLAY_COMMAND:
+    {
+        remote_char_t command = record->command;
+        handle_command(game, &command);
+        break;
+    }
+    case REPLAY_ALIEN_TICK:
+        alien_step(game);
+        break;
+    case REPLAY_BULLET_EXPIRY:
+        clear_zap(game, record->x, record->y, record->is_horizontal);
+        break;
+    case REPLAY_RESEED:
+        reseed_game(game);
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * Function: reseed_game
+ * ---------------------
+ * Seeds the random number generator again from the seed of the match and its
+ * alien ticks.
+ *
+ * game: Pointer to the state of the match.
+ *
+ * The state of the generator cannot be copied, so a standby server synced
+ * from a checkpoint is seeded the same way as the primary at that point. The
+ * reseed is an event of the match, so a recorded match still replays. Must be
+ * called with the mutex held. This function does not return a value.
+ */
+void reseed_game(game_t *game)
+{
+    record_event(game, REPLAY_RESEED, NULL, 0, 0, false);
+    srand(game->seed ^ game->alien_ticks);
+}
+
+/**
+ * Function: setup_game
+ * --------------------
+ * Creates the windows of the match, seeds the random number generator and
+ * spawns the initial aliens.
+ *
+ * game: Pointer to the state of the match to initialize.
+ * numbers: Where the window with the board coordinates is returned.
+ * publisher: Pointer to the ZeroMQ publisher socket (NULL when not live).
+ * seed: The seed for the random number generator.
+ * initial_aliens: The number of aliens to spawn, or 0 for MAX_ALIENS.
+ *
+ * A replay must draw exactly the same random numbers as the recorded match,
+ * so this is the only place where the generator is seeded.
+ */
+void setup_game(game_t *game, WINDOW **numbers, void *publisher, uint32_t seed, int initial_aliens)
+{
+    memset(game, 0, sizeof(game_t));
+
+    // Create windows for the board and score display
+    *numbers = newwin(BOARD_HEIGHT + 3, BOARD_WIDTH + 3, 0, 0);                           // Window to display the board with margins for borders and coordinates.
+    game->board_win = derwin(*numbers, BOARD_HEIGHT + 2, BOARD_WIDTH + 2, 1, 1);        // Subwindow inside 'numbers' for the game board.
+    game->score_win = newwin(BOARD_HEIGHT + 2, SCORE_WIDTH, 1, BOARD_WIDTH + 4);        // Window for displaying the score.
+    game->publisher = publisher;
+    game->seed = seed;
+    build_topology();
+
+    srand(seed); // Seed the random number generator for aliens and player actions.
+
+    // Initialize the board and score
+    draw_board(*numbers);                                   // Draws the initial game board.
+    box(game->board_win, 0, 0);                             // Adds a border around the board window.
+    draw_score(game->score_win, NULL, 0, game->publisher);  // Draws the initial score display.
+
+    // Initialize player and game state
+    game->aliens_alive = initial_aliens > 0 ? initial_aliens : MAX_ALIENS; // Keeps track of how many aliens are still alive.
+    game->last_aliens_alive = game->aliens_alive;
+    game->running = true;
+
+    // Spawn aliens on the board
+    spawn_aliens(game->board_win, game->aliens_alive); // Places aliens on the game board; the zone is empty, so all of them fit.
+}
+
+/**
+ * Function: capture_checkpoint
+ * ----------------------------
+ * Copies the state of a live match into a checkpoint.
+ *
+ * game: Pointer to the state of the match.
+ * checkpoint: Where the state is copied.
+ *
+ * Must be called with the mutex held. The copy is small, so the checkpoint can
+ * be written to disk after the mutex is released.
+ */
+void capture_checkpoint(game_t *game, checkpoint_t *checkpoint)
+{
+    checkpoint->seed = game->seed;
+    checkpoint->alien_ticks = game->alien_ticks;
+    checkpoint->start_ms = game->start_ms;
+    checkpoint->tick = game->tick;
+    checkpoint->aliens_alive = game->aliens_alive;
+    checkpoint->last_aliens_alive = game->last_aliens_alive;
+    checkpoint->iterations = game->iterations;
+    checkpoint->client_count = game->client_count;
+    memcpy(checkpoint->clients, game->clients, sizeof(game->clients));
+    memcpy(checkpoint->areas_occupied, game->areas_occupied, sizeof(game->areas_occupied));
+    for (int x = 0; x < BOARD_HEIGHT; x++)
+    {
+        for (int y = 0; y < BOARD_WIDTH; y++)
+        {
+            checkpoint->board[x][y] = (uint32_t)mvwinch(game->board_win, x + 1, y + 1);
+        }
+    }
+}
+
+/**
+ * Function: restore_checkpoint
+ * ----------------------------
+ * Carries on a live match from a checkpoint.
+ *
+ * game: Pointer to the state of a match set up by setup_game with the seed of
+ *       the checkpoint.
+ * checkpoint: The checkpoint.
+ *
+ * The players keep their characters, tickets, scores and cooldowns, so their
+ * clients go on without joining again. The generator is seeded as by
+ * reseed_game, so a standby synced from the checkpoint draws the same numbers
+ * as the primary, and a resumed match does not hand out the tickets of the
+ * start of the match a second time.
+ */
+void restore_checkpoint(game_t *game, const checkpoint_t *checkpoint)
+{
+    game->seed = checkpoint->seed;
+    game->alien_ticks = checkpoint->alien_ticks;
+    game->start_ms = checkpoint->start_ms;
+    game->tick = checkpoint->tick;
+    game->aliens_alive = checkpoint->aliens_alive;
+    game->last_aliens_alive = checkpoint->last_aliens_alive;
+    game->iterations = checkpoint->iterations;
+    game->client_count = checkpoint->client_count;
+    memcpy(game->clients, checkpoint->clients, sizeof(game->clients));
+    memcpy(game->areas_occupied, checkpoint->areas_occupied, sizeof(game->areas_occupied));
+    for (int x = 0; x < BOARD_HEIGHT; x++)
+    {
+        for (int y = 0; y < BOARD_WIDTH; y++)
+        {
+            mvwaddch(game->board_win, x + 1, y + 1, (chtype)checkpoint->board[x][y]);
+        }
+    }
+
+    srand(checkpoint->seed ^ checkpoint->alien_ticks);
+    draw_score(game->score_win, game->clients, game->client_count, game->publisher);
+    monitor_touch();
+}
+
+/**
+ * Function: clear_all_zaps
+ * ------------------------
+ * Removes every zap on the board.
+ *
+ * game: Pointer to the state of the match.
+ *
+ * Used when a live match is resumed from a checkpoint: the zaps on the board
+ * have lost the thread that would remove them. Must be called with the mutex
+ * held, if other threads use the match. This function does not return a value.
+ */
+void clear_all_zaps(game_t *game)
+{
+    for (int i = 1; i <= BOARD_HEIGHT; i++)
+    {
+        for (int j = 1; j <= BOARD_WIDTH; j++)
+        {
+            if (mvwinch(game->board_win, i, j) == '-')
+            {
+                clear_zap(game, i, j, true);
+            }
+            else if (mvwinch(game->board_win, i, j) == '|')
+            {
+                clear_zap(game, i, j, false);
+            }
+        }
+    }
+    monitor_touch();
+}
+
+/**
+ * Function: open_headless_screen
+ * ------------------------------
+ * Initializes ncurses without a terminal, for running the game logic headless.
+ *
+ * The windows still hold the board in memory, but the game code never refreshes
+ * them and the monitor is not started, so nothing is written to a terminal;
+ * what curses writes when the screen is set up goes to /dev/null. Returns the
+ * new screen.
+ */
+SCREEN *open_headless_screen()
+{
+    FILE *out = fopen("/dev/null", "w");
+    FILE *in = fopen("/dev/null", "r");
+    SCREEN *screen = newterm("dumb", out, in);
+    if (screen == NULL)
+    {
+        fprintf(stderr, "Error initializing headless screen\n");
+        exit(1);
+    }
+    set_term(screen);
+    return screen;
+}
+
+/**
+ * Function: board_checksum
+ * ------------------------
+ * Computes a FNV-1a hash of the serialized board, to compare the outcome of
+ * two runs of the same match.
+ *
+ * board_win: A pointer to the window representing the game board.
+ *
+ * Returns the hash.
+ */
+uint32_t board_checksum(WINDOW *board_win)
+{
+    int rows, cols;
+    getmaxyx(board_win, rows, cols);
+    char *buffer = serialize_window(board_win);
+
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < rows * cols; i++)
+    {
+        hash = (hash ^ (unsigned char)buffer[i]) * 16777619u;
+    }
+    free(buffer);
+    return hash;
+}
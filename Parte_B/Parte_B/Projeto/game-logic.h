@@ -0,0 +1,194 @@
+#ifndef __GAME_LOGIC_H_INCLUDED__
+#define __GAME_LOGIC_H_INCLUDED__
+
+#include <ncurses.h>
+#include <pthread.h>
+#include <stdint.h>
+#include "remote-char.h"
+#include "common.h"
+#include "replay-log.h"
+#include "game-checkpoint.h"
+
+#define PUB_DEFAULT_HWM 100         // Messages queued at most for one subscriber
+#define PUB_DEFAULT_LINGER_MS 1000  // Time given to queued messages when the server exits
+
+// Alien space - line >=3  && line <= 18 && column >=3 && column <= 18
+#define IS_ALIEN_SPACE(line, column) (line >= 3 && line <= 18 && column >= 3 && column <= 18)
+
+// Playing Areas
+#define IS_AREA_A(line, column) (column == 1 && line >= 3 && line <= 18)
+#define IS_AREA_B(line, column) (line == 19 && column >= 3 && column <= 18)
+#define IS_AREA_C(line, column) (line == 20 && column >= 3 && column <= 18)
+#define IS_AREA_D(line, column) (column == 19 && line >= 3 && line <= 18)
+#define IS_AREA_E(line, column) (line == 1 && column >= 3 && column <= 18)
+#define IS_AREA_F(line, column) (column == 20 && line >= 3 && line <= 18)
+#define IS_AREA_G(line, column) (line == 2 && column >= 3 && column <= 18)
+#define IS_AREA_H(line, column) (column == 2 && line >= 3 && line <= 18)
+
+/**
+ * Struct: cell_topology_t
+ * -----------------------
+ * What the fixed geometry of the board says about one cell.
+ *
+ * area: The playing area of the cell, 'A' to 'H', or '\0' outside them.
+ * moves: Bit (1 << direction) is set if a player on the cell can move that way
+ *        without leaving its area.
+ * zap_horizontal: true if a zap fired from the cell sweeps its line (areas
+ *                 A, D, F and H), false if it sweeps its column.
+ */
+typedef struct cell_topology_t
+{
+    char area;
+    uint8_t moves;
+    bool zap_horizontal;
+} cell_topology_t;
+
+/**
+ * Enum: game_mode_t
+ * -----------------
+ * Where the events of a match come from.
+ *
+ * GAME_LIVE: Clients over ZeroMQ, with the alien and zap threads on the wall clock.
+ * GAME_REPLAY: A replay log.
+ * GAME_SIMULATION: Simulated players, stepped on a virtual clock by simulate_match.
+ */
+typedef enum game_mode_t
+{
+    GAME_LIVE,
+    GAME_REPLAY,
+    GAME_SIMULATION
+} game_mode_t;
+
+/**
+ * Struct: pending_zap_t
+ * ---------------------
+ * A zap waiting to be removed from the board, in a simulated match.
+ *
+ * due: Game time at which the zap is removed, in milliseconds since the start.
+ * x, y, is_horizontal: The zap line.
+ */
+typedef struct pending_zap_t
+{
+    uint32_t due;
+    int x, y;
+    bool is_horizontal;
+} pending_zap_t;
+
+/**
+ * Struct: game_t
+ * --------------
+ * Contains the state of a match, shared by the command loop and the game threads.
+ *
+ * board_win: Pointer to the window representing the game board.
+ * score_win: Pointer to the window representing the score display.
+ * publisher: Pointer to the ZeroMQ publisher socket (NULL when not live).
+ * clients: An array of client information structures.
+ * client_count: The number of clients connected.
+ * areas_occupied: Tracks whether each area is occupied.
+ * aliens_alive: The number of aliens still alive.
+ * last_aliens_alive: The number of aliens alive at the last respawn check.
+ * iterations: Number of alien ticks since the number of aliens last changed.
+ * seed: The seed of the match, also used for the directions of the aliens.
+ * alien_ticks: Number of alien ticks so far.
+ * start_ms: Game clock time of the start of the match, in milliseconds.
+ * tick: Game time of the event being processed, in milliseconds since start_ms.
+ * running: Cleared when the match ends, to stop the alien thread.
+ * mode: Where the events of the match come from.
+ * recorder: The replay log being written, or NULL if the match is not recorded.
+ * pending_zaps, pending_zap_count: Zaps still on the board in a simulated match.
+ * checkpoint: The checkpoint file of a live match, or NULL if it is not checkpointed.
+ * checkpoint_ticks: Alien ticks between two checkpoints.
+ * replica: The socket the events are replicated on to standby servers, or NULL.
+ */
+typedef struct game_t
+{
+    WINDOW *board_win;
+    WINDOW *score_win;
+    void *publisher;
+    ch_info_t clients[MAX_CLIENTS];
+    int client_count;
+    bool areas_occupied[8];
+    int aliens_alive;
+    int last_aliens_alive;
+    int iterations;
+    uint32_t seed;
+    uint32_t alien_ticks;
+    int64_t start_ms;
+    uint32_t tick;
+    bool running;
+    game_mode_t mode;
+    replay_log_t *recorder;
+    pending_zap_t pending_zaps[MAX_CLIENTS];
+    int pending_zap_count;
+    checkpoint_file_t *checkpoint;
+    uint32_t checkpoint_ticks;
+    void *replica;
+} game_t;
+
+/**
+ * Struct: zap_info
+ * ----------------
+ * Contains information about a zap (shot) event.
+ *
+ * game: Pointer to the state of the match.
+ * x: The x-coordinate of the zap.
+ * y: The y-coordinate of the zap.
+ * is_horizontal: Boolean indicating if the zap is horizontal.
+ */
+typedef struct zap_info
+{
+    game_t *game;
+    int x;
+    int y;
+    bool is_horizontal;
+} zap_info;
+
+// Protects the board and the game state, shared by the command loop and the game threads
+extern pthread_mutex_t mutex;
+
+// Topology of every cell of the board, indexed [line][column], filled by build_topology
+extern cell_topology_t topology[WINDOW_SIZE][WINDOW_SIZE];
+
+uint32_t game_elapsed_ms(game_t *game);
+time_t game_time(game_t *game);
+void record_event(game_t *game, replay_event_t event, remote_char_t *command, int x, int y, bool is_horizontal);
+char *serialize_window(WINDOW *win);
+void send_to_subscribers(void *publisher, void *score_win, void *board_win);
+void *open_publisher(void *context, const char *endpoint, int hwm, int linger_ms);
+void new_position(int *x, int *y, direction_t direction);
+void draw_score(WINDOW *score_win, ch_info_t clients[], int client_count, void *zmq_socket);
+void publish_match_end(void *zmq_socket);
+void add_client(ch_info_t clients[], int *client_count, int ch, int pos_x, int pos_y, char ticket[7]);
+void remove_client(ch_info_t clients[], int *client_count, int ch);
+int find_ch_info(ch_info_t clients[], int client_count, int ch);
+void build_topology(void);
+char get_player_area(int line, int column);
+bool are_coords_in_same_area(int line1, int column1, int line2, int column2);
+int ChoosePlayerArea(bool areas_occupied[]);
+void ChoosePlayerPosition(int area, int *x, int *y);
+void clear_zap(game_t *game, int x, int y, bool is_horizontal);
+void *remove_bullets(void *arg);
+void update_clients(WINDOW *board_win, int x, int y, char ch, int client_count, ch_info_t clients[], bool is_horizontal, time_t current_time);
+bool zap_effect(WINDOW *board_win, int x, int y, int *aliens_alive, ch_info_t clients[], int client_count, char ch);
+int spawn_aliens(WINDOW *board_win, int number_of_aliens);
+void update_aliens_alive(int *aliens_alive, int *last_aliens_alive, int *iterations, WINDOW *board_win);
+void alien_step(game_t *game);
+void *move_alien(void *arg);
+void move_player(WINDOW *board_win, int client_count, ch_info_t clients[], remote_char_t buffer);
+void generate_ticket(char *ticket, size_t size);
+bool validate_ticket(ch_info_t clients[], int client_count, char ch, char ticket[7]);
+void update_client_status(ch_info_t clients[], int client_count, time_t current_time);
+void schedule_zap_removal(game_t *game, int x, int y, bool is_horizontal);
+void expire_cooldowns(game_t *game);
+void handle_command(game_t *game, remote_char_t *buffer);
+void apply_command(game_t *game, remote_char_t *buffer);
+void apply_event(game_t *game, const replay_record_t *record);
+void reseed_game(game_t *game);
+void setup_game(game_t *game, WINDOW **numbers, void *publisher, uint32_t seed, int initial_aliens);
+void capture_checkpoint(game_t *game, checkpoint_t *checkpoint);
+void restore_checkpoint(game_t *game, const checkpoint_t *checkpoint);
+void clear_all_zaps(game_t *game);
+SCREEN *open_headless_screen(void);
+uint32_t board_checksum(WINDOW *board_win);
+
+#endif // __GAME_LOGIC_H_INCLUDED__
@@ -1,899 +1,933 @@
 #include <ncurses.h>
-#include "remote-char.h"
 #include <unistd.h>
-#include <sys/types.h>
-#include <sys/stat.h>
-#include <fcntl.h>
 #include <stdlib.h>
 #include <zmq.h>
 #include <pthread.h>
-#include <unistd.h>
+#include <getopt.h>
+#include <string.h>
+#include <stdatomic.h>
 #include "zhelpers.h"
 #include "common.h"
-#include "score_update.pb-c.h"
-
-// Alien space - line >=3  && line <= 18 && column >=3 && column <= 18
-#define IS_ALIEN_SPACE(line, column) (line >= 3 && line <= 18 && column >= 3 && column <= 18)
-
-// Playing Areas
-#define IS_AREA_A(line, column) (column == 1 && line >= 3 && line <= 18)
-#define IS_AREA_B(line, column) (line == 19 && column >= 3 && column <= 18)
-#define IS_AREA_C(line, column) (line == 20 && column >= 3 && column <= 18)
-#define IS_AREA_D(line, column) (column == 19 && line >= 3 && line <= 18)
-#define IS_AREA_E(line, column) (line == 1 && column >= 3 && column <= 18)
-#define IS_AREA_F(line, column) (column == 20 && line >= 3 && line <= 18)
-#define IS_AREA_G(line, column) (line == 2 && column >= 3 && column <= 18)
-#define IS_AREA_H(line, column) (column == 2 && line >= 3 && line <= 18)
+#include "replay-log.h"
+#include "game-clock.h"
+#include "game-logic.h"
+#include "server-stats.h"
+#include "server-trace.h"
+#include "flight-recorder.h"
+#include "alien-step.h"
+#include "server-monitor.h"
+#include "server-replica.h"
+#include "bot-swarm.h"
+#include "command-limits.h"
+#include "session-timers.h"
+
+#define INPROC_COMMANDS_ENDPOINT "inproc://commands"
+#define INPROC_FRAMES_ENDPOINT "inproc://frames"
+#define BOTS_MAX_ARGS 32
+#define BOTS_POLL_MS 100 // How often the command loop checks whether the bots are done
+#define COMMAND_BATCH_DEFAULT 64
+#define COMMAND_BATCH_MAX 256
+#define SIM_MAX_RATE 1000 // Commands per second at most of a simulated player, one per millisecond of game time
+#define COMMAND_ENVELOPE_MAX 4 // Identity, request id of a correlating REQ socket and delimiter
+
+// Span names of the commands in the trace, by msg_type
+static const char *command_names[] = {"join", "move", "fire", "leave"};
 
 /**
- * Struct: zap_info
- * ----------------
- * Contains information about a zap (shot) event.
+ * Struct: embedded_bots_t
+ * -----------------------
+ * A swarm of bots run inside the server process, for benchmarks.
  *
- * board_win: Pointer to the window representing the game board.
- * score_win: Pointer to the window representing the score display.
- * publisher: Pointer to the ZeroMQ publisher socket.
- * x: The x-coordinate of the zap.
- * y: The y-coordinate of the zap.
- * is_horizontal: Boolean indicating if the zap is horizontal.
+ * context: The ZeroMQ context of the server, so inproc endpoints can be used.
+ * config: The settings of the swarm.
+ * thread: The thread running the swarm.
+ * done: Set when the bots left and the report is printed.
  */
-typedef struct zap_info
+typedef struct embedded_bots_t
 {
-    WINDOW *board_win;
-    WINDOW *score_win;
-    void *publisher;
-    int x;
-    int y;
-    bool is_horizontal;
-} zap_info;
+    void *context;
+    bot_config_t config;
+    pthread_t thread;
+    atomic_bool done;
+} embedded_bots_t;
 
 /**
- * Struct: alien_trial_t
- * ---------------------
- * Contains information about the alien movement trial.
+ * Struct: pending_command_t
+ * -------------------------
+ * A command received on the ROUTER socket, waiting for its reply.
  *
- * board_win: Pointer to the window representing the game board.
- * score_win: Pointer to the window representing the score display.
- * aliens_alive: Pointer to the number of alive aliens.
- * publisher: Pointer to the ZeroMQ publisher socket.
+ * envelope: The parts before the command, up to the empty delimiter, sent back
+ *           in front of the reply so it reaches the client.
+ * envelope_parts: The number of parts in envelope.
+ * command: The command.
+ * received_ns: When it was received, from stats_now_ns.
  */
-typedef struct alien_trial_t
+typedef struct pending_command_t
 {
-    WINDOW *board_win;
-    WINDOW *score_win;
-    int *aliens_alive;
-    void *publisher;
-} alien_trial_t;
-
-// create a mutex
-pthread_mutex_t mutex;
+    zmq_msg_t envelope[COMMAND_ENVELOPE_MAX];
+    int envelope_parts;
+    remote_char_t command;
+    uint64_t received_ns;
+} pending_command_t;
 
 /**
- * Function: random_direction
- * --------------------------
- * Generates a random direction for alien movement.
- *
- * Returns a random direction_t value.
- */
-direction_t random_direction()
-{
-    return (direction_t)(rand() % 4);
-}
-
-/**
- * Function: serialize_window
- * --------------------------
- * Serializes the contents of a window into a buffer.
+ * Function: receive_command
+ * -------------------------
+ * Receives one command from the clients.
  *
- * win: A pointer to the window to be serialized.
+ * router: The ROUTER socket of the commands.
+ * pending: Where the command and its envelope are stored.
+ * flags: 0 to wait for a command, ZMQ_DONTWAIT to take one only if queued.
  *
- * Returns a pointer to the buffer containing the serialized window content.
+ * Returns 1 for a command, 0 if none was received, or -1 for a message that
+ * is not a command, which is dropped.
  */
-char *serialize_window(WINDOW *win)
+static int receive_command(void *router, pending_command_t *pending, int flags)
 {
-    int rows, cols;
-    getmaxyx(win, rows, cols);
-    char *buffer = (char *)malloc(rows * cols * sizeof(char));
-    memset(buffer, 0, rows * cols * sizeof(char) + 1);
+    pending->envelope_parts = 0;
+    while (1)
+    {
+        zmq_msg_t *part = &pending->envelope[pending->envelope_parts];
+        zmq_msg_init(part);
+        if (zmq_msg_recv(part, router, pending->envelope_parts == 0 ? flags : 0) == -1)
+        {
+            zmq_msg_close(part);
+            break;
+        }
+        pending->envelope_parts++;
+        if (zmq_msg_size(part) == 0 || !zmq_msg_more(part) || pending->envelope_parts == COMMAND_ENVELOPE_MAX)
+        {
+            break; // The delimiter, or not an envelope
+        }
+    }
+    if (pending->envelope_parts == 0)
+    {
+        return 0;
+    }
 
-    for (int y = 0; y < rows; y++)
+    zmq_msg_t *last = &pending->envelope[pending->envelope_parts - 1];
+    int more = zmq_msg_more(last);
+    int size = -1;
+    if (zmq_msg_size(last) == 0 && more)
+    {
+        memset(&pending->command, 0, sizeof(pending->command));
+        size = zmq_recv(router, &pending->command, sizeof(pending->command), 0);
+        size_t more_size = sizeof(more);
+        zmq_getsockopt(router, ZMQ_RCVMORE, &more, &more_size);
+    }
+    while (more)
+    {
+        // Parts after the command are not part of the protocol
+        zmq_msg_t extra;
+        zmq_msg_init(&extra);
+        zmq_msg_recv(&extra, router, 0);
+        more = zmq_msg_more(&extra);
+        zmq_msg_close(&extra);
+        size = -1;
+    }
+    if (size < 0)
     {
-        for (int x = 0; x < cols; x++)
+        for (int i = 0; i < pending->envelope_parts; i++)
         {
-            buffer[y * cols + x] = mvwinch(win, y, x) & A_CHARTEXT;
+            zmq_msg_close(&pending->envelope[i]);
         }
+        return -1;
     }
-    buffer[rows * cols] = '\0';
-    return buffer;
+    pending->received_ns = stats_now_ns();
+    return 1;
 }
 
 /**
- * Function: send_to_subscribers
- * -----------------------------
- * Serializes the contents of the score and board windows and sends them to subscribers.
- *
- * publisher: A pointer to the ZeroMQ publisher socket.
- * score_win: A pointer to the window representing the score.
- * board_win: A pointer to the window representing the game board.
+ * Function: reply_command
+ * -----------------------
+ * Sends the reply to a command received by receive_command.
  *
- * This function does not return a value.
+ * router: The ROUTER socket of the commands.
+ * pending: The command. Its envelope is sent and released.
+ * reply, size: The reply.
  */
-void send_to_subscribers(void *publisher, void *score_win, void *board_win)
+static void reply_command(void *router, pending_command_t *pending, const void *reply, size_t size)
 {
-    // Serialize the content of the windows
-    char *board_buffer = serialize_window(board_win);
-    char *score_buffer = serialize_window(score_win);
-
-    // Send the serialized content to the subscribers
-    s_send(publisher, score_buffer);
-    s_send(publisher, board_buffer);
-
-    // Free the allocated memory for the serialized buffers
-    free(score_buffer);
-    free(board_buffer);
+    for (int i = 0; i < pending->envelope_parts; i++)
+    {
+        zmq_msg_send(&pending->envelope[i], router, ZMQ_SNDMORE);
+        zmq_msg_close(&pending->envelope[i]);
+    }
+    zmq_send(router, reply, size, 0);
 }
 
 /**
- * Function: new_position
- * ----------------------
- * Updates the coordinates based on the given direction.
+ * Function: already_applied
+ * -------------------------
+ * Checks whether a request is a copy of one applied already.
  *
- * x: A pointer to the x-coordinate.
- * y: A pointer to the y-coordinate.
- * direction: The direction to move.
+ * applied: The seq of the last request applied, by area.
+ * command: The request, from a player whose ticket was checked.
  *
- * This function does not return a value.
+ * A client that gets no reply in time sends its request again with the same
+ * seq; when the server was only slow, both copies arrive. Requests without a
+ * seq are never copies. Returns true for a copy, which must be answered
+ * without being applied.
  */
-void new_position(int *x, int *y, direction_t direction)
+static bool already_applied(const uint32_t applied[], const remote_char_t *command)
 {
-    switch (direction)
+    int slot = command->ch - 'A';
+    if (command->seq == 0 || slot < 0 || slot >= MAX_CLIENTS)
     {
-    case UP:
-        (*x)--;
-        if (*x == 0)
-            *x = 1;
-        break;
-    case DOWN:
-        (*x)++;
-        if (*x == WINDOW_SIZE - 1)
-            *x = WINDOW_SIZE - 2;
-        break;
-    case LEFT:
-        (*y)--;
-        if (*y == 0)
-            *y = 1;
-        break;
-    case RIGHT:
-        (*y)++;
-        if (*y == WINDOW_SIZE - 1)
-            *y = WINDOW_SIZE - 2;
-        break;
-    default:
-        break;
+        return false;
     }
+    return (int32_t)(command->seq - applied[slot]) <= 0;
 }
 
 /**
- * Function: draw_score
- * --------------------
- * Draws the score window with the current scores of the clients.
+ * Function: mark_applied
+ * ----------------------
+ * Records that a request was applied, so its copies are not.
  *
- * score_win: A pointer to the window representing the score.
- * clients: An array of client information structures.
- * client_count: The number of clients connected.
+ * applied: The seq of the last request applied, by area.
+ * command: The request, from a player whose ticket was checked.
  *
- * This function does not return a value.
+ * Only requests that changed the match are recorded: the copy of a request
+ * answered "LIMIT" is checked against the budget again.
  */
-void draw_score(WINDOW *score_win, ch_info_t clients[], int client_count, void *zmq_socket)
+static void mark_applied(uint32_t applied[], const remote_char_t *command)
 {
-    wclear(score_win);    // Clear the score window
-    box(score_win, 0, 0); // Redraw the border
-    mvwprintw(score_win, 1, 3, "Score");
-    curs_set(0); // Hide the cursor
-
-    // Print the scores of each client
-    for (int i = 0; i < client_count; i++)
-    {
-        mvwprintw(score_win, i + 2, 3, "%c - %d", clients[i].ch, clients[i].score);
-    }
-
-    wrefresh(score_win); // Refresh the window to display the content
-
-    // Initialize the Protobuf message for all scores
-    ScoreUpdates updates = SCORE_UPDATES__INIT;
-    updates.scores = malloc(client_count * sizeof(ScoreUpdate *));
-    updates.n_scores = client_count;
-
-    for (int i = 0; i < client_count; i++)
-    {
-        updates.scores[i] = malloc(sizeof(ScoreUpdate));
-        score_update__init(updates.scores[i]);
-        updates.scores[i]->ch = clients[i].ch;
-        updates.scores[i]->score = clients[i].score;
-    }
-
-    // Serialize the message
-    size_t len = score_updates__get_packed_size(&updates);
-    void *buffer = malloc(len);
-    score_updates__pack(&updates, buffer);
-
-    // Send the message to the ZeroMQ socket
-    zmq_send(zmq_socket, "scores ", 7, ZMQ_SNDMORE); // Topic
-    zmq_send(zmq_socket, buffer, len, 0);            // Message
-
-    // Free the memory used for the buffer and scores
-    free(buffer);
-    for (int i = 0; i < client_count; i++)
+    int slot = command->ch - 'A';
+    if (command->seq != 0 && slot >= 0 && slot < MAX_CLIENTS)
     {
-        free(updates.scores[i]);
+        applied[slot] = command->seq;
     }
-    free(updates.scores);
 }
 
 /**
- * Function: add_client
- * --------------------
- * Adds a new client to the clients array.
+ * Function: evict_idle_sessions
+ * -----------------------------
+ * Removes the players silent for longer than the idle timeout, as if they had
+ * left, so their areas are free for the next joins.
  *
- * clients: An array of client information structures.
- * client_count: A pointer to the number of clients connected.
- * ch: The character representing the client.
- * pos_x: The x-coordinate of the client's position.
- * pos_y: The y-coordinate of the client's position.
- * ticket: The ticket string for the client.
+ * game: The match, with game->tick set to the current game time.
+ * sessions: The idle timers of the players.
  *
- * This function does not return a value.
+ * The leave goes through apply_command, so it is recorded and replicated like
+ * one sent by the player. Must be called with the mutex held.
+ *
+ * Returns the number of players evicted.
  */
-void add_client(ch_info_t clients[], int *client_count, int ch, int pos_x, int pos_y, char ticket[7])
+static int evict_idle_sessions(game_t *game, session_timers_t *sessions)
 {
-    clients[*client_count].ch = ch;
-    clients[*client_count].pos_x = pos_x;
-    clients[*client_count].pos_y = pos_y;
-    clients[*client_count].score = 0;
-    clients[*client_count].move = true;
-    clients[*client_count].shoot = true;
-    (*client_count)++;
+    int evicted = 0;
+    char ch;
+    while ((ch = sessions_expired(sessions, game->tick)) != '\0')
+    {
+        sessions_forget(sessions, ch);
+        int index = find_ch_info(game->clients, game->client_count, ch);
+        if (index < 0)
+        {
+            continue; // Left without the timer knowing, as in a replaced session
+        }
+        remote_char_t leave = {.msg_type = 3, .ch = ch};
+        strcpy(leave.ticket, game->clients[index].ticket);
+        apply_command(game, &leave);
+        stats_count(STAT_SESSIONS_EVICTED, 1);
+        evicted++;
+    }
+    return evicted;
 }
 
 /**
- * Function: remove_client
- * -----------------------
- * Removes a client from the clients array.
- *
- * clients: An array of client information structures.
- * client_count: A pointer to the number of clients connected.
- * ch: The character representing the client to be removed.
+ * Function: connect_endpoint
+ * --------------------------
+ * Returns the endpoint to connect to for an endpoint the server binds: a tcp
+ * bind on every interface becomes the same port on localhost, anything else is
+ * the same.
  *
- * This function does not return a value.
+ * bind: The endpoint bound by the server.
+ * buffer, size: Where the endpoint on localhost is written, if needed.
  */
-void remove_client(ch_info_t clients[], int *client_count, int ch)
+static const char *connect_endpoint(const char *bind, char *buffer, size_t size)
 {
-    for (int i = 0; i < *client_count; i++)
+    if (strncmp(bind, "tcp://*:", 8) != 0)
     {
-        if (clients[i].ch == ch)
-        {
-            // Shift the remaining clients to fill the gap
-            for (int j = i; j < *client_count - 1; j++)
-            {
-                clients[j] = clients[j + 1];
-            }
-            (*client_count)--; // Decrement the client count
-            break;
-        }
+        return bind;
     }
+    snprintf(buffer, size, "tcp://localhost:%s", bind + 8);
+    return buffer;
 }
 
 /**
- * Function: find_ch_info
- * ----------------------
- * Finds the index of a client in the clients array based on the character.
+ * Function: parse_bots
+ * --------------------
+ * Reads the options of the embedded bots, given as one argument of the server.
  *
- * clients: An array of client information structures.
- * client_count: The number of clients connected.
- * ch: The character representing the client.
+ * options: The options, as for the bot client, separated by spaces.
+ * commands, frames: The endpoints bound by the server. The bots use them
+ *                   unless the options give others.
+ * config: Where the settings are stored.
  *
- * Returns the index of the client if found, -1 otherwise.
+ * Returns false if an option is not valid.
  */
-int find_ch_info(ch_info_t clients[], int client_count, int ch)
+static bool parse_bots(const char *options, const char *commands, const char *frames, bot_config_t *config)
 {
-    for (int i = 0; i < client_count; i++)
+    static char commands_buffer[256], frames_buffer[256]; // Kept, as the settings point into them
+    swarm_default_config(config);
+    config->commands_endpoint = connect_endpoint(commands, commands_buffer, sizeof(commands_buffer));
+    config->frames_endpoint = connect_endpoint(frames, frames_buffer, sizeof(frames_buffer));
+
+    char *words = strdup(options); // Kept, as the settings point into it
+    char *argv[BOTS_MAX_ARGS + 1];
+    int argc = 0;
+    argv[argc++] = "--bots";
+    for (char *word = strtok(words, " "); word != NULL; word = strtok(NULL, " "))
     {
-        if (clients[i].ch == ch)
+        if (argc == BOTS_MAX_ARGS)
         {
-            return i;
+            return false;
         }
+        argv[argc++] = word;
     }
-    return -1; // Return -1 if the client is not found
+    argv[argc] = NULL;
+    return swarm_parse_options(argc, argv, config);
 }
 
 /**
- * Function: get_player_area
- * -------------------------
- * Determines the area of the board where the given coordinates are located.
+ * Function: run_bots
+ * ------------------
+ * Thread function that runs the embedded bots and marks them done.
  *
- * line: The x-coordinate.
- * column: The y-coordinate.
- *
- * Returns a character representing the area.
+ * arg: Pointer to the embedded_bots_t of the swarm.
  */
-char get_player_area(int line, int column)
+static void *run_bots(void *arg)
 {
-    if (IS_AREA_A(line, column))
-        return 'A';
-    if (IS_AREA_B(line, column))
-        return 'B';
-    if (IS_AREA_C(line, column))
-        return 'C';
-    if (IS_AREA_D(line, column))
-        return 'D';
-    if (IS_AREA_E(line, column))
-        return 'E';
-    if (IS_AREA_F(line, column))
-        return 'F';
-    if (IS_AREA_G(line, column))
-        return 'G';
-    if (IS_AREA_H(line, column))
-        return 'H';
-    return '\0'; // Return null character if not in any area
+    embedded_bots_t *bots = (embedded_bots_t *)arg;
+    swarm_run(bots->context, &bots->config);
+    fflush(stdout);
+    atomic_store(&bots->done, true);
+    return NULL;
 }
 
 /**
- * Function: are_coords_in_same_area
- * ---------------------------------
- * Checks if two sets of coordinates are in the same area.
- *
- * line1: The x-coordinate of the first position.
- * column1: The y-coordinate of the first position.
- * line2: The x-coordinate of the second position.
- * column2: The y-coordinate of the second position.
+ * Function: print_summary
+ * -----------------------
+ * Prints the outcome of a headless match to stdout.
  *
- * Returns true if the coordinates are in the same area, false otherwise.
+ * game: Pointer to the state of the match.
+ * events: The number of events applied.
+ * elapsed_ms: The wall clock time the run took, in milliseconds.
  */
-bool are_coords_in_same_area(int line1, int column1, int line2, int column2)
+void print_summary(game_t *game, uint64_t events, int64_t elapsed_ms)
 {
-    char area1 = get_player_area(line1, column1);
-    char area2 = get_player_area(line2, column2);
-    return area1 != '\0' && area1 == area2;
+    printf("events: %llu\n", (unsigned long long)events);
+    printf("game time: %u ms\n", game->tick);
+    printf("run time: %lld ms\n", (long long)elapsed_ms);
+    printf("aliens alive: %d\n", game->aliens_alive);
+    for (int i = 0; i < game->client_count; i++)
+    {
+        printf("player %c: %d\n", game->clients[i].ch, game->clients[i].score);
+    }
+    printf("board checksum: %08x\n", board_checksum(game->board_win));
 }
 
 /**
- * Function: ChoosePlayerArea
- * --------------------------
- * Chooses a random player area that is not occupied.
+ * Function: replay_match
+ * ----------------------
+ * Replays a recorded match headless, through the same code paths as a live server.
  *
- * areas_occupied: An array indicating which areas are occupied.
+ * path: The replay log to read.
+ * realtime: If true, events are applied at the pace they were recorded;
+ *           otherwise they are applied as fast as possible.
  *
- * Returns the index of the chosen area.
+ * Prints a summary of the replay, including the final scores and a checksum of
+ * the final board, to stdout. Returns EXIT_SUCCESS, or EXIT_FAILURE if the log
+ * cannot be opened.
  */
-int ChoosePlayerArea(bool areas_occupied[])
+int replay_match(const char *path, bool realtime)
 {
-    int area = (rand() % 8);
+    replay_log_t *log = replay_log_open(path);
+    if (log == NULL)
+    {
+        fprintf(stderr, "Error opening replay log %s\n", path);
+        return EXIT_FAILURE;
+    }
+
+    SCREEN *screen = open_headless_screen();
+    game_t game;
+    WINDOW *numbers;
+    setup_game(&game, &numbers, NULL, log->seed, (int)log->initial_aliens);
+    game.start_ms = log->start_ms;
+    game.mode = GAME_REPLAY;
 
-    // Keep generating a random area until an unoccupied one is found
-    while (areas_occupied[area] == true)
+    int64_t replay_start = s_clock();
+    replay_record_t record;
+    while (game.aliens_alive > 0 && replay_log_read(log, &record))
     {
-        area = (rand() % 8);
+        if (realtime)
+        {
+            int64_t wait = replay_start + record.tick - s_clock();
+            if (wait > 0)
+            {
+                s_sleep((int)wait);
+            }
+        }
+
+        apply_event(&game, &record);
+
+        // Same publish work as the live server does after every event
+        send_to_subscribers(NULL, game.score_win, game.board_win);
     }
+    print_summary(&game, log->records, s_clock() - replay_start);
 
-    return area;
+    delwin(game.board_win);
+    delwin(numbers);
+    delwin(game.score_win);
+    endwin();
+    delscreen(screen);
+    replay_log_close(log);
+    return EXIT_SUCCESS;
 }
 
 /**
- * Function: ChoosePlayerPosition
- * ------------------------------
- * Chooses a random position within the given area.
- *
- * area: The index of the area.
- * x: A pointer to the x-coordinate.
- * y: A pointer to the y-coordinate.
+ * Struct: sim_player_t
+ * --------------------
+ * A simulated astronaut.
  *
- * This function does not return a value.
+ * command: The join reply, reused for every command of the player.
+ * next_action: Game time of the next command, in milliseconds since the start.
  */
-void ChoosePlayerPosition(int area, int *x, int *y)
+typedef struct sim_player_t
 {
-    switch (area)
-    {
-
-    // Area A - Left
-    case 0:
-        *x = (rand() % (18 - 3 + 1)) + 3;
-        *y = 1;
-        break;
-    // Area B - Bottom
-    case 1:
-        *x = 19;
-        *y = (rand() % (18 - 3 + 1)) + 3;
-        break;
-    // Area C - Bottom
-    case 2:
-        *x = 20;
-        *y = (rand() % (18 - 3 + 1)) + 3;
-        break;
-    // Area D - Right
-    case 3:
-        *x = (rand() % (18 - 3 + 1)) + 3;
-        *y = 19;
-        break;
-    // Area E - Top
-    case 4:
-        *x = 1;
-        *y = (rand() % (18 - 3 + 1)) + 3;
-        break;
-    // Area F - Right
-    case 5:
-        *x = (rand() % (18 - 3 + 1)) + 3;
-        *y = 20;
-        break;
-    // Area G - Top
-    case 6:
-        *x = 2;
-        *y = (rand() % (18 - 3 + 1)) + 3;
-        break;
-    // Area H - Left
-    case 7:
-        *x = (rand() % (18 - 3 + 1)) + 3;
-        *y = 2;
-        break;
-    default:
-        break;
-    }
-}
+    remote_char_t command;
+    uint32_t next_action;
+} sim_player_t;
 
 /**
- * Function: remove_bullets
+ * Function: simulate_match
  * ------------------------
- * Removes bullets from the board after a delay.
+ * Runs a headless match with simulated players on a virtual clock.
  *
- * arg: A pointer to a zap_info structure containing information about the zap.
+ * duration_ms: Game time to simulate, in milliseconds. The match also ends when
+ *              every alien is dead.
+ * players: The number of simulated players (1 to MAX_CLIENTS).
+ * rate: Commands per second sent by each player (1 to SIM_MAX_RATE).
+ * seed: The seed for the random number generator.
+ * initial_aliens: The number of aliens to spawn, or 0 for MAX_ALIENS.
+ * record_path: The replay log to write, or NULL.
  *
- * This function does not return a value.
- *
- * The function runs as a separate thread and waits for 500 milliseconds before
- * removing bullets or aliens from the board. It then refreshes the game board
- * and notifies subscribers of the update.
+ * Alien ticks, zap removals and player commands are processed in game time
+ * order through the same functions as a live server, without waiting between
+ * them. The players draw from their own generator, so the recorded log replays
+ * to the same board. Prints a summary to stdout and returns EXIT_SUCCESS, or
+ * EXIT_FAILURE if the replay log cannot be created.
  */
-void *remove_bullets(void *arg)
+int simulate_match(uint32_t duration_ms, int players, int rate, uint32_t seed, int initial_aliens, const char *record_path)
 {
-    zap_info *info = (zap_info *)arg;
-    WINDOW *board_win = info->board_win;
-    WINDOW *score_win = info->score_win;
-    void *publisher = info->publisher;
-    int x = info->x;
-    int y = info->y;
-    bool is_horizontal = info->is_horizontal;
-    usleep(500000); // Wait for 500 milliseconds
-
-    for (int i = 1; i <= 20; i++)
+    game_clock_use_virtual(0);
+    SCREEN *screen = open_headless_screen();
+    game_t game;
+    WINDOW *numbers;
+    setup_game(&game, &numbers, NULL, seed, initial_aliens);
+    game.start_ms = game_clock_now_ms();
+    game.mode = GAME_SIMULATION;
+
+    if (record_path != NULL)
     {
+        game.recorder = replay_log_create(record_path, seed, (uint32_t)initial_aliens, game.start_ms);
+        if (game.recorder == NULL)
+        {
+            perror("Error creating replay log");
+            return EXIT_FAILURE;
+        }
+    }
 
-        if (is_horizontal)
+    // Join every player at the start of the match
+    unsigned int player_seed = seed;
+    uint32_t period = 1000 / rate;
+    sim_player_t sim_players[MAX_CLIENTS];
+    for (int i = 0; i < players; i++)
+    {
+        sim_players[i].command = (remote_char_t){.msg_type = 0}; // A join, moving one cell per command
+        handle_command(&game, &sim_players[i].command);
+        sim_players[i].next_action = rand_r(&player_seed) % period;
+    }
+
+    int64_t run_start = s_clock();
+    uint64_t events = players;
+    uint32_t next_alien_tick = 0;
+    while (game.aliens_alive > 0)
+    {
+        // Find the earliest event: an alien tick, a zap removal or a player command
+        uint32_t next = next_alien_tick;
+        int zap = -1;
+        int player = -1;
+        for (int i = 0; i < game.pending_zap_count; i++)
         {
-            if (mvwinch(board_win, x, i) == '-' || mvwinch(board_win, x, i) == '*')
+            if (game.pending_zaps[i].due < next)
             {
-                mvwaddch(board_win, x, i, ' '); // Remove the bullet or alien
+                next = game.pending_zaps[i].due;
+                zap = i;
             }
         }
-        else
+        for (int i = 0; i < players; i++)
         {
-            if (mvwinch(board_win, i, y) == '|' || mvwinch(board_win, i, y) == '*')
+            if (sim_players[i].next_action < next)
             {
-                mvwaddch(board_win, i, y, ' '); // Remove the bullet or alien
+                next = sim_players[i].next_action;
+                zap = -1;
+                player = i;
             }
         }
-    }
-    wrefresh(board_win);                                  // Refresh the game board to show updates
-    send_to_subscribers(publisher, score_win, board_win); // Notify subscribers of the update
-}
+        if (next > duration_ms)
+        {
+            break;
+        }
 
-/**
- * Function: update_clients
- * ------------------------
- * Updates the status of clients based on the zap effect.
- *
- * board_win: A pointer to the window representing the game board.
- * x: The x-coordinate of the zap.
- * y: The y-coordinate of the zap.
- * ch: The character representing the client.
- * client_count: The number of clients connected.
- * clients: An array of client information structures.
- * is_horizontal: A boolean indicating if the zap is horizontal.
- *
- * This function does not return a value.
- */
-void update_clients(WINDOW *board_win, int x, int y, char ch, int client_count, ch_info_t clients[], bool is_horizontal)
-{
-    // Find the index of the client who fired the zap
-    int player = find_ch_info(clients, client_count, ch);
-    for (int i = 0; i < client_count; i++)
-    {
-        // Check if the client is in the line of the zap
-        if ((is_horizontal && clients[i].pos_x == x) || (!is_horizontal && clients[i].pos_y == y))
+        game_clock_advance_to(game.start_ms + next);
+        game.tick = next;
+        if (player != -1)
         {
-            if (i != player)
-            {
-                // Disable movement and shooting for the hit client
-                clients[i].move = false;
-                clients[i].shoot = false;
-                // Record the time the client was hit
-                clients[i].hit_time = time(NULL);
-            }
+            // Move three times out of four, fire otherwise
+            remote_char_t *command = &sim_players[player].command;
+            command->msg_type = rand_r(&player_seed) % 4 == 0 ? 2 : 1;
+            command->direction = (direction_t)(rand_r(&player_seed) % 4);
+            handle_command(&game, command);
+            sim_players[player].next_action += period;
+        }
+        else if (zap != -1)
+        {
+            pending_zap_t removed = game.pending_zaps[zap];
+            game.pending_zaps[zap] = game.pending_zaps[--game.pending_zap_count];
+            clear_zap(&game, removed.x, removed.y, removed.is_horizontal);
+        }
+        else
+        {
+            alien_step(&game);
+            next_alien_tick += ALIEN_TICK_MS;
         }
+        events++;
+
+        // Same publish work as the live server does after every event
+        send_to_subscribers(NULL, game.score_win, game.board_win);
     }
+
+    print_summary(&game, events, s_clock() - run_start);
+
+    replay_log_close(game.recorder);
+    delwin(game.board_win);
+    delwin(numbers);
+    delwin(game.score_win);
+    endwin();
+    delscreen(screen);
+    return EXIT_SUCCESS;
 }
 
 /**
- * Function: zap_effect
- * --------------------
- * Applies the zap effect on the board and updates the score.
+ * Function: usage
+ * ---------------
+ * Prints the command-line options of the server.
  *
- * board_win: A pointer to the window representing the game board.
- * x: The x-coordinate of the zap.
- * y: The y-coordinate of the zap.
- * aliens_alive: A pointer to the number of aliens alive.
- * clients: An array of client information structures.
- * client_count: The number of clients connected.
- * ch: The character representing the client.
- *
- * Returns true if the zap is horizontal, false otherwise.
+ * program: The name of the executable.
  */
-bool zap_effect(WINDOW *board_win, int x, int y, int *aliens_alive, ch_info_t clients[], int client_count, char ch)
+void usage(const char *program)
 {
+    fprintf(stderr,
+            "Usage: %s [--headless] [--seed N] [--aliens N] [--record FILE] [--trace FILE]\n"
+            "          [--watchdog-ms N] [--flight-dir DIR] [--alien-kernel NAME] [--monitor-fps N]\n"
+            "          [--pub-hwm N] [--pub-linger-ms N] [--checkpoint FILE [--checkpoint-ticks N] [--resume]]\n"
+            "          [--replicate ENDPOINT] [--standby ENDPOINT [--takeover-ms N]]\n"
+            "          [--commands ENDPOINT] [--frames ENDPOINT] [--stats ENDPOINT] [--inproc] [--bots OPTIONS]\n"
+            "          [--command-batch N] [--move-limit N] [--fire-limit N] [--idle-timeout-ms N]\n"
+            "       %s --replay FILE [--realtime]\n"
+            "       %s --simulate SECONDS [--players N] [--rate N] [--seed N] [--aliens N] [--record FILE]\n"
+            "  --headless        run as a daemon without a terminal or a view, for benchmarks and supervisors\n"
+            "  --monitor-fps N   frames per second at most of the terminal view, 1 to %d (default: %d)\n"
+            "  --seed N          seed for the random number generator (default: current time)\n"
+            "  --aliens N        number of aliens at the start, 1 to 256 (default: %d)\n"
+            "  --record FILE     log every accepted command and game tick to FILE\n"
+            "  --trace FILE      write a Chrome trace of the server threads to FILE on exit and on SIGUSR1\n"
+            "  --watchdog-ms N   dump the flight recorder when a command or tick takes over N ms, 0 to disable (default: %d)\n"
+            "  --flight-dir DIR  directory of the flight recorder dumps (default: /tmp)\n"
+            "  --alien-kernel K  avx2, sse2 or scalar (default: the best the CPU supports)\n"
+            "  --pub-hwm N       frames queued at most for one subscriber before it loses frames (default: %d)\n"
+            "  --pub-linger-ms N time given to queued frames when the server exits (default: %d)\n"
+            "  --checkpoint FILE save the match to FILE while it runs, to resume it if the server dies\n"
+            "  --checkpoint-ticks N alien ticks between two checkpoints (default: %d)\n"
+            "  --resume          carry on the match saved in the checkpoint FILE, if there is one\n"
+            "  --replicate E     send every event of the match to standby servers on endpoint E (e.g. %s)\n"
+            "  --standby E       follow the match of the primary replicating on E, and take it over when\n"
+            "                    the primary stops sending heartbeats\n"
+            "  --takeover-ms N   silence of the primary after which a standby takes over (default: %d)\n"
+            "  --commands E      endpoint of the commands of the clients (default: %s)\n"
+            "  --frames E        endpoint the frames and scores are published on (default: %s)\n"
+            "  --stats E         endpoint of the counters and histograms (default: %s)\n"
+            "  --inproc          use inproc endpoints for the commands and frames, for --bots\n"
+            "  --bots OPTIONS    with --headless, run the bot client with OPTIONS (e.g. \"--bots 8 --subscribers 4\")\n"
+            "                    in the server process, and end the match when the bots are done\n"
+            "  --command-batch N commands at most applied together, with one publish, up to %d (default: %d)\n"
+            "  --move-limit N    cells per second each player may move, 0 for no limit (default: %d)\n"
+            "  --fire-limit N    shots per second each player may send, 0 for no limit (default: %d)\n"
+            "  --idle-timeout-ms N silence after which a player is evicted and its area freed, 0 to disable (default: %d)\n"
+            "  --replay FILE     replay a recorded match headless and print a summary\n"
+            "  --realtime        replay at the recorded pace instead of as fast as possible\n"
+            "  --simulate SECS   run a headless match of SECS seconds of game time on a virtual clock\n"
+            "  --players N       simulated players, 1 to %d (default: %d)\n"
+            "  --rate N          commands per second of each simulated player, 1 to %d (default: 5)\n",
+            program, program, program, MONITOR_MAX_FPS, MONITOR_DEFAULT_FPS, MAX_ALIENS, WATCHDOG_DEFAULT_MS, PUB_DEFAULT_HWM, PUB_DEFAULT_LINGER_MS, CHECKPOINT_DEFAULT_TICKS, REPLICA_ENDPOINT, REPLICA_DEFAULT_TAKEOVER_MS, COMMANDS_ENDPOINT, FRAMES_BIND_ENDPOINT, STATS_ENDPOINT, COMMAND_BATCH_MAX, COMMAND_BATCH_DEFAULT, MOVE_DEFAULT_LIMIT, FIRE_DEFAULT_LIMIT, SESSION_DEFAULT_TIMEOUT_MS, MAX_CLIENTS, MAX_CLIENTS, SIM_MAX_RATE);
+}
 
-    // verify if shot is horizontal or vertical
-    bool is_horizontal = IS_AREA_A(x, y) || IS_AREA_D(x, y) || IS_AREA_F(x, y) || IS_AREA_H(x, y);
-    if (is_horizontal)
+int main(int argc, char *argv[])
+{
+    const char *record_path = NULL;
+    const char *replay_path = NULL;
+    bool realtime = false;
+    bool headless = false;
+    uint32_t seed = (uint32_t)time(NULL);
+    int initial_aliens = 0;
+    int simulate_seconds = 0;
+    int players = MAX_CLIENTS;
+    int rate = 5;
+    const char *trace_path = NULL;
+    int watchdog_ms = WATCHDOG_DEFAULT_MS;
+    const char *flight_dir = "/tmp";
+    const char *alien_kernel = NULL;
+    int monitor_fps = MONITOR_DEFAULT_FPS;
+    int pub_hwm = PUB_DEFAULT_HWM;
+    int pub_linger_ms = PUB_DEFAULT_LINGER_MS;
+    const char *checkpoint_path = NULL;
+    int checkpoint_ticks = CHECKPOINT_DEFAULT_TICKS;
+    bool resume = false;
+    const char *replicate_endpoint = NULL;
+    const char *standby_endpoint = NULL;
+    int takeover_ms = REPLICA_DEFAULT_TAKEOVER_MS;
+    const char *commands_endpoint = NULL;
+    const char *frames_endpoint = NULL;
+    const char *stats_endpoint = STATS_ENDPOINT;
+    bool inproc = false;
+    const char *bots_options = NULL;
+    int command_batch = COMMAND_BATCH_DEFAULT;
+    double move_limit = MOVE_DEFAULT_LIMIT;
+    double fire_limit = FIRE_DEFAULT_LIMIT;
+    int idle_timeout_ms = SESSION_DEFAULT_TIMEOUT_MS;
+
+    static struct option long_options[] = {
+        {"seed", required_argument, NULL, 's'},
+        {"aliens", required_argument, NULL, 'a'},
+        {"record", required_argument, NULL, 'r'},
+        {"replay", required_argument, NULL, 'p'},
+        {"realtime", no_argument, NULL, 't'},
+        {"headless", no_argument, NULL, 'H'},
+        {"simulate", required_argument, NULL, 'S'},
+        {"players", required_argument, NULL, 'n'},
+        {"rate", required_argument, NULL, 'R'},
+        {"trace", required_argument, NULL, 'T'},
+        {"watchdog-ms", required_argument, NULL, 'w'},
+        {"flight-dir", required_argument, NULL, 'd'},
+        {"alien-kernel", required_argument, NULL, 'K'},
+        {"monitor-fps", required_argument, NULL, 'm'},
+        {"pub-hwm", required_argument, NULL, 'h'},
+        {"pub-linger-ms", required_argument, NULL, 'l'},
+        {"checkpoint", required_argument, NULL, 'c'},
+        {"checkpoint-ticks", required_argument, NULL, 'k'},
+        {"resume", no_argument, NULL, 'u'},
+        {"replicate", required_argument, NULL, 'P'},
+        {"standby", required_argument, NULL, 'B'},
+        {"takeover-ms", required_argument, NULL, 'o'},
+        {"commands", required_argument, NULL, 'C'},
+        {"frames", required_argument, NULL, 'F'},
+        {"stats", required_argument, NULL, 'X'},
+        {"inproc", no_argument, NULL, 'i'},
+        {"bots", required_argument, NULL, 'b'},
+        {"command-batch", required_argument, NULL, 'M'},
+        {"move-limit", required_argument, NULL, 'L'},
+        {"fire-limit", required_argument, NULL, 'Z'},
+        {"idle-timeout-ms", required_argument, NULL, 'I'},
+        {NULL, 0, NULL, 0}};
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1)
     {
-        // Horizontal zap
-        for (int i = 0; i <= 20; i++)
+        switch (opt)
         {
-            if (mvwinch(board_win, x, i) == '*')
+        case 's':
+            seed = (uint32_t)strtoul(optarg, NULL, 10);
+            break;
+        case 'r':
+            record_path = optarg;
+            break;
+        case 'p':
+            replay_path = optarg;
+            break;
+        case 't':
+            realtime = true;
+            break;
+        case 'H':
+            headless = true;
+            break;
+        case 'a':
+            initial_aliens = atoi(optarg);
+            if (initial_aliens < 1 || initial_aliens > 256)
             {
-                // Increment the score of the client who fired the zap
-                clients[find_ch_info(clients, client_count, ch)].score += 1;
-                (*aliens_alive)--; // Decrement the number of alive aliens
+                usage(argv[0]);
+                return EXIT_FAILURE;
             }
-            if (mvwinch(board_win, x, i) == ' ' || mvwinch(board_win, x, i) == '*')
+            break;
+        case 'S':
+            simulate_seconds = atoi(optarg);
+            if (simulate_seconds < 1)
             {
-                // Display the zap effect
-                mvwaddch(board_win, x, i, '-');
+                usage(argv[0]);
+                return EXIT_FAILURE;
             }
-        }
-    }
-    else
-    {
-        // Vertical zap
-        for (int i = 0; i <= 20; i++)
-        {
-            if (mvwinch(board_win, i, y) == '*')
+            break;
+        case 'n':
+            players = atoi(optarg);
+            if (players < 1 || players > MAX_CLIENTS)
             {
-                // Increment the score of the client who fired the zap
-                clients[find_ch_info(clients, client_count, ch)].score += 1;
-                (*aliens_alive)--; // Decrement the number of alive aliens
+                usage(argv[0]);
+                return EXIT_FAILURE;
             }
-            if (mvwinch(board_win, i, y) == ' ' || mvwinch(board_win, i, y) == '*')
+            break;
+        case 'R':
+            rate = atoi(optarg);
+            if (rate < 1 || rate > SIM_MAX_RATE)
             {
-                // Display the zap effect
-                mvwaddch(board_win, i, y, '|');
+                usage(argv[0]);
+                return EXIT_FAILURE;
             }
+            break;
+        case 'T':
+            trace_path = optarg;
+            break;
+        case 'w':
+            watchdog_ms = atoi(optarg);
+            break;
+        case 'd':
+            flight_dir = optarg;
+            break;
+        case 'K':
+            alien_kernel = optarg;
+            break;
+        case 'm':
+            monitor_fps = atoi(optarg);
+            if (monitor_fps < 1 || monitor_fps > MONITOR_MAX_FPS)
+            {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'h':
+            pub_hwm = atoi(optarg);
+            if (pub_hwm < 1)
+            {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'l':
+            pub_linger_ms = atoi(optarg);
+            break;
+        case 'c':
+            checkpoint_path = optarg;
+            break;
+        case 'k':
+            checkpoint_ticks = atoi(optarg);
+            if (checkpoint_ticks < 1)
+            {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'u':
+            resume = true;
+            break;
+        case 'P':
+            replicate_endpoint = optarg;
+            break;
+        case 'B':
+            standby_endpoint = optarg;
+            break;
+        case 'o':
+            takeover_ms = atoi(optarg);
+            if (takeover_ms < 1)
+            {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'C':
+            commands_endpoint = optarg;
+            break;
+        case 'F':
+            frames_endpoint = optarg;
+            break;
+        case 'X':
+            stats_endpoint = optarg;
+            break;
+        case 'i':
+            inproc = true;
+            break;
+        case 'b':
+            bots_options = optarg;
+            break;
+        case 'M':
+            command_batch = atoi(optarg);
+            if (command_batch < 1 || command_batch > COMMAND_BATCH_MAX)
+            {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'L':
+            move_limit = atof(optarg);
+            break;
+        case 'Z':
+            fire_limit = atof(optarg);
+            break;
+        case 'I':
+            idle_timeout_ms = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
         }
     }
-    wrefresh(board_win);  // Refresh the game board to show the zap effect
-    return is_horizontal; // Return whether the zap was horizontal or vertical
-}
 
-/**
- * Function: spawn_aliens
- * ----------------------
- * Spawns aliens at random positions on the board.
- *
- * board_win: A pointer to the window representing the game board.
- *
- * This function does not return a value.
- */
-void spawn_aliens(WINDOW *board_win, int number_of_aliens)
-{
-    int x, y;
-    int count = 0;
-    while (count < number_of_aliens)
+    if (commands_endpoint == NULL)
     {
-        // Generate random coordinates within the specified range
-        x = (rand() % (18 - 3 + 1)) + 3;
-        y = (rand() % (18 - 3 + 1)) + 3;
-
-        // Check if the space is valid for aliens and is empty
-        if (IS_ALIEN_SPACE(x, y) && mvwinch(board_win, x, y) == ' ')
-        {
-            // Place an alien at the generated coordinates
-            mvwaddch(board_win, x, y, '*');
-            count++;
-        }
+        commands_endpoint = inproc ? INPROC_COMMANDS_ENDPOINT : COMMANDS_ENDPOINT;
     }
-    // Refresh the game board to show the newly spawned aliens
-    wrefresh(board_win);
-}
-
-/**
- * Function: is_alien_move
- * -----------------------
- * Checks if an alien can move to the given coordinates.
- *
- * board_win: A pointer to the window representing the game board.
- * x: The x-coordinate.
- * y: The y-coordinate.
- *
- * Returns true if the alien can move to the coordinates, false otherwise.
- */
-bool is_alien_move(WINDOW *board_win, int x, int y)
-{
-    if (IS_ALIEN_SPACE(x, y) && mvwinch(board_win, x, y) == ' ')
+    if (frames_endpoint == NULL)
     {
-        return true;
+        frames_endpoint = inproc ? INPROC_FRAMES_ENDPOINT : FRAMES_BIND_ENDPOINT;
     }
-    return false;
-}
 
-/**
- * Function: update_aliens_alive
- * -----------------------------
- * Updates the number of alive aliens on the board.
- *
- * aliens_alive: Pointer to the current number of alive aliens.
- * last_aliens_alive: Pointer to the last recorded number of alive aliens.
- * iterations: Pointer to the number of iterations since the last change in the number of alive aliens.
- * board_win: Pointer to the window representing the game board.
- *
- * This function checks if the number of alive aliens has changed. If it has, it resets the iteration count.
- * If the number of alive aliens has not changed for 10 iterations, it spawns new aliens based on 10% of the current
- * number of alive aliens, with a minimum of 1 and a maximum of 256 aliens.
- */
-void update_aliens_alive(int *aliens_alive, int *last_aliens_alive, int *iterations, WINDOW *board_win)
-{
-    if (*aliens_alive != *last_aliens_alive)
+    // Inproc endpoints are only reachable from this process, so only by embedded bots
+    static embedded_bots_t bots;
+    if ((inproc || bots_options != NULL) && (bots_options == NULL || !headless ||
+                                             !parse_bots(bots_options, commands_endpoint, frames_endpoint, &bots.config)))
     {
-        // If the number of alive aliens has changed, update the last recorded number and reset iterations
-        *last_aliens_alive = *aliens_alive;
-        *iterations = 0;
+        usage(argv[0]);
+        return EXIT_FAILURE;
     }
-    else
+
+    if ((resume && (checkpoint_path == NULL || standby_endpoint != NULL)) || ((resume || standby_endpoint != NULL) && record_path != NULL))
     {
-        // If the number of alive aliens has not changed, increment the iteration count
-        (*iterations)++;
-        if (*iterations >= 10)
-        {
-            // If the number of iterations reaches 10, calculate the number of new aliens to spawn
-            int increment = (int)(*aliens_alive * 0.1);
-            if (increment < 1)
-                increment = 1;
-            if (*aliens_alive + increment > 256)
-                increment = 256 - *aliens_alive;
-
-            // Spawn new aliens and update the number of alive aliens
-            spawn_aliens(board_win, increment);
-            *aliens_alive += increment;
-
-            // Update the last recorded number of alive aliens and reset iterations
-            *last_aliens_alive = *aliens_alive;
-            *iterations = 0;
-        }
+        // A resumed or taken over match does not start from its seed, so it cannot be replayed
+        usage(argv[0]);
+        return EXIT_FAILURE;
     }
-}
-
-/**
- * Function: move_alien
- * --------------------
- * Thread function that moves aliens on the game board.
- *
- * arg: Pointer to an alien_trial_t structure containing information about the game board and aliens.
- *
- * This function continuously moves aliens on the game board, updates the display, and sends updates to subscribers.
- */
-void *move_alien(void *arg)
-{
-
-    // Cast the argument to an alien_trial_t structure
-    alien_trial_t *info = (alien_trial_t *)arg;
-    WINDOW *board_win = info->board_win;
-    WINDOW *score_win = info->score_win;
-    void *publisher = info->publisher;
 
-    int iterations = 0;
-    int last_aliens_alive = *info->aliens_alive;
-    while (1)
+    if (!alien_kernel_select(alien_kernel))
     {
-        // Iterate over the game board to find and move aliens
-        for (int x = 3; x <= 18; x++)
-        {
-            for (int y = 3; y <= 18; y++)
-            {
-                pthread_mutex_lock(&mutex);
-                if (mvwinch(board_win, x, y) == '*')
-                {
-                    // Determine a new position for the alien based on a random direction
-                    direction_t direction = random_direction();
-                    int x_new = x;
-                    int y_new = y;
-                    new_position(&x_new, &y_new, direction);
-                    if (is_alien_move(board_win, x_new, y_new))
-                    {
-                        // Move the alien to the new position
-                        wmove(board_win, x, y);
-                        waddch(board_win, ' ');
-                        wmove(board_win, x_new, y_new);
-                        waddch(board_win, '*');
-                    }
-                }
-                pthread_mutex_unlock(&mutex);
-            }
-        }
-        // Refresh the game board display
-        pthread_mutex_lock(&mutex);
-        wrefresh(board_win);
-        pthread_mutex_unlock(&mutex);
-
-        // Send updates to subscribers
-        send_to_subscribers(publisher, score_win, board_win);
-        usleep(1000000);
-
-        // Update the number of alive aliens
-        update_aliens_alive(info->aliens_alive, &last_aliens_alive, &iterations, board_win);
+        fprintf(stderr, "Alien kernel %s is not supported on this CPU\n", alien_kernel);
+        return EXIT_FAILURE;
     }
-}
 
-/**
- * Function: move_player
- * ---------------------
- * Moves a player on the board based on the direction provided in the buffer.
- *
- * board_win: A pointer to the window representing the game board.
- * client_count: The number of clients connected.
- * clients: An array of client information structures.
- * buffer: A structure containing the character and direction information.
- *
- * This function does not return a value.
- */
-void move_player(WINDOW *board_win, int client_count, ch_info_t clients[], remote_char_t buffer)
-{
-    // Find the index of the client based on the character in the buffer
-    int index = find_ch_info(clients, client_count, buffer.ch);
-    if (index != -1 && clients[index].move)
+    if (replay_path != NULL)
     {
-        int pos_x, pos_y;
-        pos_x = clients[index].pos_x;
-        pos_y = clients[index].pos_y;
-
-        // Move to the current position and clear the character
-        wmove(board_win, pos_x, pos_y);
-        waddch(board_win, ' ');
-
-        // Calculate the new position based on the direction
-        new_position(&pos_x, &pos_y, buffer.direction);
+        return replay_match(replay_path, realtime);
+    }
+    if (simulate_seconds > 0)
+    {
+        return simulate_match((uint32_t)simulate_seconds * 1000, players, rate, seed, initial_aliens, record_path);
+    }
 
-        // Ensure the player stays within the same area
-        if (!are_coords_in_same_area(pos_x, pos_y, clients[index].pos_x, clients[index].pos_y))
+    // A standby keeps a copy of the match and takes it over from the checkpoint it ends up with
+    checkpoint_t checkpoint;
+    bool resumed = false;
+    if (standby_endpoint != NULL)
+    {
+        if (!follow_primary(standby_endpoint, takeover_ms, &checkpoint))
         {
-
-            pos_x = clients[index].pos_x;
-            pos_y = clients[index].pos_y;
+            printf("The primary ended the match\n");
+            return EXIT_SUCCESS;
         }
+        fprintf(stderr, "No heartbeat from the primary for %d ms, taking over the match\n", takeover_ms);
+        resumed = true;
+    }
 
-        // Update the player's position
-        clients[index].pos_x = pos_x;
-        clients[index].pos_y = pos_y;
+    if (trace_path != NULL)
+    {
+        trace_start(trace_path); // Before any thread is started, so they leave the signals to the trace
+        trace_thread_name("command loop");
+    }
 
-        // Move to the new position and draw the character
-        wmove(board_win, pos_x, pos_y);
-        waddch(board_win, buffer.ch | A_BOLD);
+    // Initialize ncurses
+    if (headless)
+    {
+        open_headless_screen(); // Keeps the board in curses windows without a terminal.
+    }
+    else
+    {
+        initscr();            // Initializes the ncurses library.
+        keypad(stdscr, TRUE); // Enables the use of special keys like arrow keys.
+        noecho();             // Disables automatic echoing of typed characters.
+        cbreak();             // Disables input buffering, making characters immediately available.
     }
-}
 
-/**
- * Function: generate_ticket
- * -------------------------
- * Generates a random ticket string.
- *
- * ticket: A pointer to the buffer where the ticket will be stored.
- * size: The size of the ticket buffer.
- *
- * This function does not return a value.
- */
-void generate_ticket(char *ticket, size_t size)
-{
-    static const char charset[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
-    for (size_t i = 0; i < size - 1; i++)
+    // Initialize ZeroMQ sockets
+    void *context = NULL;
+    void *requester = initialize_zmq_socket(&context, ZMQ_ROUTER, commands_endpoint, true); // Initializes a ZeroMQ ROUTER socket.
+    void *publisher = open_publisher(context, frames_endpoint, pub_hwm, pub_linger_ms); // Initializes a ZeroMQ XPUB socket.
+    stats_start(context, stats_endpoint);                                               // Serves counters and latency histograms.
+    if (watchdog_ms > 0)
     {
-        ticket[i] = charset[rand() % (sizeof(charset) - 1)];
+        watchdog_start((uint32_t)watchdog_ms, flight_dir); // Dumps the flight recorder when a tick or command overruns.
     }
-    ticket[size - 1] = '\0'; // Null-terminate the string
-}
 
-/**
- * Function: validate_ticket
- * -------------------------
- * Validates a ticket for a given character.
- *
- * clients: An array of client information structures.
- * client_count: The number of clients connected.
- * ch: The character to validate.
- * ticket: The ticket string to validate.
- *
- * Returns true if the ticket is valid, false otherwise.
- */
-bool validate_ticket(ch_info_t clients[], int client_count, char ch, char ticket[7])
-{
-    for (int i = 0; i < client_count; i++)
+    // Load the match to carry on, if any
+    checkpoint_file_t *checkpoint_file = NULL;
+    if (checkpoint_path != NULL)
     {
-        if (clients[i].ch == ch)
+        checkpoint_file = checkpoint_open(checkpoint_path);
+        if (checkpoint_file == NULL)
+        {
+            endwin();
+            perror("Error opening checkpoint");
+            return EXIT_FAILURE;
+        }
+        if (resume)
         {
-            return strcmp(clients[i].ticket, ticket) == 0; // Returns true if the ticket matches
+            resumed = checkpoint_load(checkpoint_file, &checkpoint);
+        }
+        if (resume && !resumed)
+        {
+            fprintf(stderr, "No checkpoint to resume in %s, starting a new match\n", checkpoint_path);
         }
     }
-    return false; // Character not found or invalid ticket
-}
 
-/**
- * Function: update_client_status
- * ------------------------------
- * Updates the status of clients based on the current time.
- *
- * clients: An array of client information structures.
- * client_count: The number of clients connected.
- * current_time: The current time.
- *
- * This function does not return a value.
- */
-void update_client_status(ch_info_t clients[], int client_count, time_t current_time)
-{
-    for (int i = 0; i < client_count; i++)
+    // Initialize the board, the score and the aliens
+    game_t game;
+    WINDOW *numbers;
+    setup_game(&game, &numbers, publisher, resumed ? checkpoint.seed : seed, initial_aliens);
+    WINDOW *board_win = game.board_win;
+    WINDOW *score_win = game.score_win;
+
+    game.start_ms = s_clock();
+    if (resumed)
     {
-        if (!clients[i].move && (current_time - clients[i].hit_time) >= 10)
+        restore_checkpoint(&game, &checkpoint); // Keeps the clock of the match, so the cooldowns carry on
+        clear_all_zaps(&game);                   // Their removal threads died with the previous server
+    }
+    if (checkpoint_file != NULL)
+    {
+        // Replace the checkpoint of a previous match right away
+        game.checkpoint = checkpoint_file;
+        game.checkpoint_ticks = (uint32_t)checkpoint_ticks;
+        capture_checkpoint(&game, &checkpoint);
+        if (!checkpoint_write(checkpoint_file, &checkpoint))
         {
-            clients[i].move = true;  // Allow movement after 10 seconds
-            clients[i].shoot = true; // Allow shooting after 10 seconds
+            perror("Error writing checkpoint");
         }
-
-        if (!clients[i].shoot && (current_time - clients[i].shoot_time) >= 3 && clients[i].move)
+    }
+    if (record_path != NULL)
+    {
+        game.recorder = replay_log_create(record_path, seed, (uint32_t)initial_aliens, game.start_ms);
+        if (game.recorder == NULL)
         {
-            clients[i].shoot = true; // Allow shooting after 3 seconds
+            endwin();
+            perror("Error creating replay log");
+            return EXIT_FAILURE;
         }
     }
-}
-
-int main()
-{
-    // Initialize ncurses
-    initscr();            // Initializes the ncurses library.
-    keypad(stdscr, TRUE); // Enables the use of special keys like arrow keys.
-    noecho();             // Disables automatic echoing of typed characters.
-    cbreak();             // Disables input buffering, making characters immediately available.
-
-    // Create windows for the board and score display
-    WINDOW *numbers = newwin(BOARD_HEIGHT + 3, BOARD_WIDTH + 3, 0, 0);             // Window to display the board with margins for borders and coordinates.
-    WINDOW *board_win = derwin(numbers, BOARD_HEIGHT + 2, BOARD_WIDTH + 2, 1, 1);  // Subwindow inside 'numbers' for the game board.
-    WINDOW *score_win = newwin(BOARD_HEIGHT + 2, SCORE_WIDTH, 1, BOARD_WIDTH + 4); // Window for displaying the score.
-
-    srand(time(NULL)); // Seed the random number generator for alien movement.
-
-    // Initialize ZeroMQ sockets
-    void *context = NULL;
-    void *requester = initialize_zmq_socket(&context, ZMQ_REP, "ipc:///tmp/s1", true); // Initializes a ZeroMQ REP socket.
-    void *publisher = initialize_zmq_socket(&context, ZMQ_PUB, "tcp://*:5555", true);  // Initializes a ZeroMQ PUB socket.
-
-    // Initialize the board and score
-    draw_board(numbers);                       // Draws the initial game board.
-    box(board_win, 0, 0);                      // Adds a border around the board window.
-    draw_score(score_win, NULL, 0, publisher); // Draws the initial score display.
-    wrefresh(board_win);
-
-    // Initialize player and game state
-    srand(time(NULL));                                                                 // Seed the random number generator for player actions.
-    ch_info_t clients[MAX_CLIENTS];                                                    // Array to store client information.
-    bool areas_occupied[8] = {false, false, false, false, false, false, false, false}; // Tracks whether each area is occupied.
-    int client_count = 0;                                                              // Number of active clients.
-    int area = -1;
-    int aliens_alive = MAX_ALIENS; // Keeps track of how many aliens are still alive.
-
-    // Spawn aliens on the board
-    spawn_aliens(board_win, aliens_alive); // Places aliens on the game board.
 
     // Initialize the mutex
     if (pthread_mutex_init(&mutex, NULL) != 0)
@@ -902,145 +936,230 @@ int main()
         return EXIT_FAILURE;
     }
 
+    if (replicate_endpoint != NULL)
+    {
+        replica_start(context, replicate_endpoint, &game); // Sends every event to the standby servers
+    }
+
+    // The terminal view is drawn by the monitor thread, never by the game threads
+    curs_set(0); // Makes the cursor invisible.
+    if (!headless)
+    {
+        monitor_start(numbers, score_win, &mutex, monitor_fps);
+    }
+
     // Create a thread to move aliens
     pthread_t aliens_thread;
-    pthread_t shoot_thread;
-
-    alien_trial_t info = {board_win, score_win, &aliens_alive, publisher};
-    int result = pthread_create(&aliens_thread, NULL, move_alien, &info); // Creates a thread to move aliens.
+    int result = pthread_create(&aliens_thread, NULL, move_alien, &game); // Creates a thread to move aliens.
     if (result != 0)
     {
         perror("Thread creation failed");
         exit(EXIT_FAILURE);
     }
 
-    curs_set(0); // Makes the cursor invisible.
-    while (1)
+    // Embedded bots play until they are done, even if the aliens are all dead before
+    bool embedded = bots_options != NULL;
+    zmq_pollitem_t command_item = {requester, 0, ZMQ_POLLIN, 0};
+    if (embedded)
     {
-        // Receive messages from clients
-        int pos_x, pos_y;
-        bool finish = false;
-        remote_char_t buffer;
+        bots.context = context;
+        atomic_init(&bots.done, false);
+        if (pthread_create(&bots.thread, NULL, run_bots, &bots) != 0)
+        {
+            perror("Thread creation failed");
+            exit(EXIT_FAILURE);
+        }
+    }
 
-        if (aliens_alive == 0) // Check if all aliens are defeated
+    static pending_command_t batch[COMMAND_BATCH_MAX];
+    static command_limits_t limits;
+    limits_init(&limits, move_limit > 0 ? move_limit : 0, fire_limit > 0 ? fire_limit : 0);
+    static session_timers_t sessions;
+    static uint32_t applied_seq[MAX_CLIENTS]; // A resumed match starts afresh: its requests since the checkpoint are lost
+    sessions_init(&sessions, idle_timeout_ms > 0 ? (uint32_t)idle_timeout_ms : 0);
+    for (int i = 0; i < game.client_count; i++)
+    {
+        sessions_touch(&sessions, game.clients[i].ch, game_elapsed_ms(&game)); // The players of a resumed match get a whole timeout to come back
+    }
+    while (1)
+    {
+        pthread_mutex_lock(&mutex);
+        if (embedded ? atomic_load(&bots.done) : game.aliens_alive == 0) // Check if the match is over
         {
-            pthread_cancel(aliens_thread); // Cancel the aliens thread
-            wclear(board_win);             // Clear the board window
-            box(board_win, 0, 0);          // Redraw the border
+            game.running = false; // Stop the aliens thread
+            pthread_mutex_unlock(&mutex);
+            pthread_join(aliens_thread, NULL);
+
+            pthread_mutex_lock(&mutex);
+            wclear(board_win);    // Clear the board window
+            box(board_win, 0, 0); // Redraw the border
 
             // Determine the player with the highest score
             int max_score = 0;
-            char winner_ch;
-            for (int i = 0; i < client_count; i++)
+            char winner_ch = '-'; // No player left, as after embedded bots
+            for (int i = 0; i < game.client_count; i++)
             {
-                if (clients[i].score > max_score)
+                if (game.clients[i].score > max_score)
                 {
-                    max_score = clients[i].score;
-                    winner_ch = clients[i].ch;
+                    max_score = game.clients[i].score;
+                    winner_ch = game.clients[i].ch;
                 }
             }
 
-            wrefresh(score_win);
-            wrefresh(numbers);
-
             // Print the winner on the board
             mvwprintw(board_win, 1, 1, "Player %c wins", winner_ch);
-            wrefresh(board_win);
+            monitor_touch();
             send_to_subscribers(publisher, score_win, board_win); // Send final board state to subscribers.
-
-            // Terminate the server
+            publish_match_end(publisher);                         // Final scores for the high-score service
+
+            // Terminate the server; zaps still on the board no longer publish
+            game.publisher = NULL;
+            replay_log_close(game.recorder);
+            game.recorder = NULL;
+            checkpoint_close(game.checkpoint, true); // Nothing left to resume
+            game.checkpoint = NULL;
+            pthread_mutex_unlock(&mutex);
+
+            replica_stop(&game); // The standbys exit instead of taking over
+            if (embedded)
+            {
+                pthread_join(bots.thread, NULL); // Their sockets are closed before the context
+            }
+            stats_stop();
+            watchdog_stop();
             zmq_close(requester);
             zmq_close(publisher);
             zmq_ctx_destroy(context);
-            finish = true;
-        }
+            trace_write();
 
-        if (finish)
-        {
-            s_sleep(5000); // Sleep for 5 seconds before exiting
+            if (!embedded)
+            {
+                game_clock_sleep_ms(GAME_OVER_DELAY_MS); // Sleep for 5 seconds before exiting
+            }
             break;
         }
+        pthread_mutex_unlock(&mutex);
 
-        receive_message(requester, &buffer, sizeof(buffer)); // Receives a message from the client.
-        time_t current_time = time(NULL);                    // Get the current time.
-
-        // Update player statuses to check if they can move
-        update_client_status(clients, client_count, current_time);
-
-        // Process message types: 0 - join, 1 - move, 2 - fire, 3 - leave
-        if (buffer.msg_type == 0)
+        // Wait for a command until the first player is due to be evicted, if any
+        int wait_ms = sessions_wait_ms(&sessions, game_elapsed_ms(&game));
+        if (embedded && (wait_ms < 0 || wait_ms > BOTS_POLL_MS))
         {
-            if (client_count == MAX_CLIENTS) // Check if the maximum number of clients is reached
-            {
-                strcpy(buffer.ticket, "FULL");
-                send_message(requester, &buffer, sizeof(buffer));
-            }
-            else
+            wait_ms = BOTS_POLL_MS;
+        }
+        if (wait_ms >= 0 && zmq_poll(&command_item, 1, wait_ms) <= 0)
+        {
+            pthread_mutex_lock(&mutex);
+            game.tick = game_elapsed_ms(&game);
+            if (evict_idle_sessions(&game, &sessions) > 0)
             {
-                area = ChoosePlayerArea(areas_occupied); // Assign a free area to the new player.
-                areas_occupied[area] = true;
-                ChoosePlayerPosition(area, &pos_x, &pos_y); // Select a position in the assigned area.
-
-                char ch_client = area + 'A';                                                               // Assign a character based on the area.
-                generate_ticket(clients[client_count].ticket, sizeof(clients[client_count].ticket));       // Generate a unique ticket for the client.
-                add_client(clients, &client_count, ch_client, pos_x, pos_y, clients[client_count].ticket); // Add the client to the list.
-
-                // Since the count has been incremented, the current client is at index client_count - 1.
-                strcpy(buffer.ticket, clients[client_count - 1].ticket);
-                buffer.ch = ch_client;
-
-                wmove(board_win, pos_x, pos_y);        // Move to the player's position.
-                waddch(board_win, ch_client | A_BOLD); // Display the player's character on the board.
-
-                send_message(requester, &buffer, sizeof(buffer));
+                send_to_subscribers(publisher, score_win, board_win);
             }
+            pthread_mutex_unlock(&mutex);
+            continue;
         }
-        if (buffer.msg_type == 1)
+
+        // Wait for a command, then take the ones already queued behind it, up to the budget
+        int count = 0;
+        for (int flags = 0; count < command_batch; flags = ZMQ_DONTWAIT)
         {
-            if (validate_ticket(clients, client_count, buffer.ch, buffer.ticket))
+            int received = receive_command(requester, &batch[count], flags);
+            if (received == 0)
             {
-                move_player(board_win, client_count, clients, buffer); // Move the player.
+                break;
             }
+            count += received > 0;
         }
-        else if (buffer.msg_type == 2 && validate_ticket(clients, client_count, buffer.ch, buffer.ticket))
+        if (count == 0)
         {
-            int index = find_ch_info(clients, client_count, buffer.ch);
-            int x = clients[index].pos_x;
-            int y = clients[index].pos_y;
+            continue;
+        }
 
-            if (clients[index].shoot == true) // Check if the player can shoot
-            {
-                int aux_aliens = aliens_alive;
+        // The batch is applied at one game time, so the cooldowns expire once for all of it
+        watchdog_begin(WATCH_COMMAND);
+        pthread_mutex_lock(&mutex);
+        uint64_t locked_ns = stats_now_ns();
+        game.tick = game_elapsed_ms(&game);
+        expire_cooldowns(&game);
+        int applied = 0;
+        for (int i = 0; i < count; i++)
+        {
+            remote_char_t *command = &batch[i].command;
 
-                bool is_horizontal = zap_effect(board_win, x, y, &aliens_alive, clients, client_count, buffer.ch);
+            // Any command of a player, even one dropped below, shows the session is alive
+            bool valid = command->msg_type >= 1 && command->msg_type <= 4 &&
+                         validate_ticket(game.clients, game.client_count, command->ch, command->ticket);
+            if (valid && command->msg_type != 3)
+            {
+                sessions_touch(&sessions, command->ch, game.tick);
+            }
+            if (valid && already_applied(applied_seq, command))
+            {
+                stats_count(STAT_COMMANDS_RESENT, 1);
+                reply_command(requester, &batch[i], "OK", 2);
+                continue;
+            }
+            if (command->msg_type == 4)
+            {
+                stats_count(STAT_HEARTBEATS, 1);
+                reply_command(requester, &batch[i], "OK", 2);
+                continue;
+            }
 
-                send_to_subscribers(publisher, score_win, board_win);
-                zap_info info = {board_win, score_win, publisher, x, y, is_horizontal};
-                pthread_create(&shoot_thread, NULL, remove_bullets, &info);
-                update_clients(board_win, x, y, buffer.ch, client_count, clients, is_horizontal);
-                draw_score(score_win, clients, client_count, publisher); // Update the score.
+            // A player over its budget is answered before any game work; the
+            // ticket is checked first, so no one can spend the budget of another
+            if ((command->msg_type == 1 || command->msg_type == 2) && valid && !limits_allow(&limits, command, game.tick))
+            {
+                stats_count(command->msg_type == 1 ? STAT_MOVES_LIMITED : STAT_FIRES_LIMITED, 1);
+                reply_command(requester, &batch[i], "LIMIT", 5);
+                continue;
+            }
+            applied++;
+
+            const char *command_name = command->msg_type >= 0 && command->msg_type <= 3 ? command_names[command->msg_type] : "unknown";
+            uint64_t start_ns = stats_now_ns();
+            stats_record(STAT_QUEUE_WAIT_NS, locked_ns - batch[i].received_ns);
+            flight_record(FLIGHT_COMMAND, command->msg_type, command->ch);
+            trace_begin(command_name);
+            apply_command(&game, command);
+            if (valid)
+            {
+                mark_applied(applied_seq, command);
+            }
 
-                clients[index].shoot_time = time(NULL); // Record the shoot time.
-                clients[index].shoot = false;           // Prevent the player from shooting again immediately.
+            // A join is answered with the assigned character and ticket, everything else with "OK"
+            if (command->msg_type == 0)
+            {
+                if (strcmp(command->ticket, "FULL") != 0)
+                {
+                    limits_reset(&limits, command->ch, game.tick);
+                    applied_seq[command->ch - 'A'] = 0;
+                    sessions_touch(&sessions, command->ch, game.tick);
+                }
+                reply_command(requester, &batch[i], command, sizeof(*command));
             }
+            else
+            {
+                if (command->msg_type == 3 && valid)
+                {
+                    sessions_forget(&sessions, command->ch);
+                }
+                reply_command(requester, &batch[i], "OK", 2);
+            }
+            stats_record(STAT_COMMAND_NS, stats_now_ns() - start_ns);
+            flight_record(FLIGHT_COMMAND_DONE, command->msg_type, (int)((stats_now_ns() - batch[i].received_ns) / 1000));
+            trace_end(command_name);
         }
-        else if (buffer.msg_type == 3 && validate_ticket(clients, client_count, buffer.ch, buffer.ticket))
+        stats_count(STAT_COMMAND_BATCHES, 1);
+        applied += evict_idle_sessions(&game, &sessions); // A busy server never waits long enough to evict in the poll
+        if (applied > 0)
         {
-            int index = find_ch_info(clients, client_count, buffer.ch);
-            wmove(board_win, clients[index].pos_x, clients[index].pos_y);
-            waddch(board_win, ' ');                                                                    // Clear the player's position.
-            areas_occupied[get_player_area(clients[index].pos_x, clients[index].pos_y) - 'A'] = false; // Mark the area as unoccupied.
-            remove_client(clients, &client_count, buffer.ch);                                          // Remove the client from the list.
-            draw_score(score_win, clients, client_count, publisher);
+            send_to_subscribers(publisher, score_win, board_win); // One frame for the whole batch
         }
-
-        pthread_mutex_lock(&mutex);
-        wrefresh(board_win); // Refresh the board window to show updates.
+        watchdog_end(WATCH_COMMAND);
         pthread_mutex_unlock(&mutex);
-        s_send(requester, "OK"); // Send a response to the client.
-        send_to_subscribers(publisher, score_win, board_win);
     }
     // Finalize ncurses
+    monitor_stop(); // Draws the winner
     delwin(board_win);
     delwin(numbers);
     delwin(score_win);
@@ -0,0 +1,309 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <zmq.h>
+#include "score_update.pb-c.h"
+#include "score-store.h"
+#include "common.h"
+
+#define HIGH_SCORES_ENDPOINT "ipc:///tmp/s1-scores"
+#define SCORES_TOPIC "scores "
+#define QUERY_TIMEOUT_MS 2000
+#define REPLY_SIZE 65536
+
+static volatile sig_atomic_t stopping = 0;
+
+/**
+ * Struct: session_t
+ * -----------------
+ * A player currently in the game, as seen in the published scores.
+ *
+ * present: true if the player was in the last scores message.
+ * score: The last score published for the player.
+ */
+typedef struct session_t
+{
+    bool present;
+    int score;
+} session_t;
+
+/**
+ * Function: wall_clock_ms
+ * -----------------------
+ * Returns the wall clock time in milliseconds since the epoch.
+ */
+static int64_t wall_clock_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Function: end_session
+ * ---------------------
+ * Appends the final score of a session to the store.
+ */
+static void end_session(score_store_t *store, session_t *session, int ch)
+{
+    if (!score_store_append(store, ch, session->score, wall_clock_ms()))
+    {
+        perror("Error appending to the high-score log");
+    }
+    session->present = false;
+}
+
+/**
+ * Function: update_sessions
+ * -------------------------
+ * Records the sessions that ended according to a scores message.
+ *
+ * store: The store.
+ * sessions: The players in the game, indexed by character.
+ * updates: The scores of every player in the game.
+ *
+ * The server publishes the scores of everyone in the game whenever one of them
+ * changes, and an empty message when the match ends. A player missing from
+ * the message left, and a score going down means the character was given to a
+ * new player; either way the previous session ended with its last score.
+ */
+static void update_sessions(score_store_t *store, session_t sessions[], const ScoreUpdates *updates)
+{
+    bool seen[SCORE_PLAYERS] = {false};
+    for (size_t i = 0; i < updates->n_scores; i++)
+    {
+        int ch = updates->scores[i]->ch & (SCORE_PLAYERS - 1);
+        session_t *session = &sessions[ch];
+        if (session->present && updates->scores[i]->score < session->score)
+        {
+            end_session(store, session, ch);
+        }
+        session->present = true;
+        session->score = updates->scores[i]->score;
+        seen[ch] = true;
+    }
+    for (int ch = 0; ch < SCORE_PLAYERS; ch++)
+    {
+        if (sessions[ch].present && !seen[ch])
+        {
+            end_session(store, &sessions[ch], ch);
+        }
+    }
+}
+
+/**
+ * Function: answer_query
+ * ----------------------
+ * Answers a leaderboard query in JSON.
+ *
+ * store: The store.
+ * query: "top N" for the N best results, or "player C" for the statistics of
+ *        the player with character C.
+ * reply: Where the answer is written, REPLY_SIZE bytes.
+ *
+ * Both are read from the mapped index, without touching the log.
+ */
+static void answer_query(score_store_t *store, const char *query, char *reply)
+{
+    int k;
+    char ch;
+    if (sscanf(query, "top %d", &k) == 1 && k > 0)
+    {
+        const score_record_t *records;
+        int n = score_store_top(store, k, &records);
+        int length = snprintf(reply, REPLY_SIZE, "{\"top\": [");
+        for (int i = 0; i < n && length < REPLY_SIZE - 128; i++)
+        {
+            length += snprintf(reply + length, REPLY_SIZE - length, "%s{\"rank\": %d, \"ch\": \"%c\", \"score\": %d, \"time_ms\": %lld}",
+                               i > 0 ? ", " : "", i + 1, records[i].ch, records[i].score, (long long)records[i].time_ms);
+        }
+        snprintf(reply + length, REPLY_SIZE - length, "]}");
+    }
+    else if (sscanf(query, "player %c", &ch) == 1)
+    {
+        const player_stats_t *player = score_store_player(store, ch);
+        snprintf(reply, REPLY_SIZE, "{\"ch\": \"%c\", \"results\": %lld, \"best\": %d, \"last\": %d, \"total\": %lld}",
+                 ch, (long long)player->results, player->best, player->last, (long long)player->total);
+    }
+    else
+    {
+        snprintf(reply, REPLY_SIZE, "{\"error\": \"expected 'top N' or 'player C'\"}");
+    }
+}
+
+/**
+ * Function: query_service
+ * -----------------------
+ * Sends one query to a running service and prints the answer.
+ *
+ * query: The query, as for answer_query.
+ * endpoint: The endpoint the service answers queries on.
+ *
+ * Returns EXIT_SUCCESS, or EXIT_FAILURE if the service does not answer.
+ */
+static int query_service(const char *query, const char *endpoint)
+{
+    void *context = zmq_ctx_new();
+    void *requester = zmq_socket(context, ZMQ_REQ);
+    int timeout = QUERY_TIMEOUT_MS, linger = 0;
+    zmq_setsockopt(requester, ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
+    zmq_setsockopt(requester, ZMQ_LINGER, &linger, sizeof(linger));
+    zmq_connect(requester, endpoint);
+
+    static char reply[REPLY_SIZE];
+    zmq_send(requester, query, strlen(query), 0);
+    int size = zmq_recv(requester, reply, sizeof(reply) - 1, 0);
+    zmq_close(requester);
+    zmq_ctx_destroy(context);
+    if (size < 0)
+    {
+        fprintf(stderr, "The high-score service did not answer on %s\n", endpoint);
+        return EXIT_FAILURE;
+    }
+    reply[size < REPLY_SIZE ? size : REPLY_SIZE - 1] = '\0';
+    printf("%s\n", reply);
+    return EXIT_SUCCESS;
+}
+
+static void handle_stop(int sig)
+{
+    (void)sig;
+    stopping = 1;
+}
+
+/**
+ * Function: usage
+ * ---------------
+ * Prints the command-line options of the high-score service.
+ */
+static void usage(const char *program)
+{
+    fprintf(stderr,
+            "Usage: %s [--log FILE] [--index FILE] [--server ENDPOINT] [--queries ENDPOINT]\n"
+            "       %s --query \"top N\" | \"player C\" [--queries ENDPOINT]\n"
+            "  --log FILE        append-only log of every result (default: high-scores.log)\n"
+            "  --index FILE      leaderboard index, rebuilt from the log when needed (default: high-scores.idx)\n"
+            "  --server ENDPOINT publisher of the game server (default: %s)\n"
+            "  --queries E       endpoint the service answers queries on (default: %s)\n"
+            "  --query Q         ask the running service and print the JSON answer\n",
+            program, program, FRAMES_ENDPOINT, HIGH_SCORES_ENDPOINT);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *log_path = "high-scores.log";
+    const char *index_path = "high-scores.idx";
+    const char *server = FRAMES_ENDPOINT;
+    const char *query = NULL;
+    const char *queries = HIGH_SCORES_ENDPOINT;
+
+    static struct option long_options[] = {
+        {"log", required_argument, NULL, 'l'},
+        {"index", required_argument, NULL, 'i'},
+        {"server", required_argument, NULL, 's'},
+        {"query", required_argument, NULL, 'q'},
+        {"queries", required_argument, NULL, 'Q'},
+        {NULL, 0, NULL, 0}};
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'l':
+            log_path = optarg;
+            break;
+        case 'i':
+            index_path = optarg;
+            break;
+        case 's':
+            server = optarg;
+            break;
+        case 'q':
+            query = optarg;
+            break;
+        case 'Q':
+            queries = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (query != NULL)
+    {
+        return query_service(query, queries);
+    }
+
+    score_store_t *store = score_store_open(log_path, index_path);
+    if (store == NULL)
+    {
+        perror("Error opening the high-score store");
+        return EXIT_FAILURE;
+    }
+
+    // Stop cleanly, so the index does not have to be rebuilt at the next start
+    struct sigaction action = {0};
+    action.sa_handler = handle_stop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    void *context = zmq_ctx_new();
+    void *subscriber = zmq_socket(context, ZMQ_SUB);
+    zmq_setsockopt(subscriber, ZMQ_SUBSCRIBE, SCORES_TOPIC, strlen(SCORES_TOPIC));
+    zmq_connect(subscriber, server);
+    void *responder = zmq_socket(context, ZMQ_REP);
+    if (zmq_bind(responder, queries) != 0)
+    {
+        perror("Error binding the high-score socket");
+        return EXIT_FAILURE;
+    }
+
+    static session_t sessions[SCORE_PLAYERS];
+    static char message[REPLY_SIZE], reply[REPLY_SIZE];
+    zmq_pollitem_t items[] = {{subscriber, 0, ZMQ_POLLIN, 0}, {responder, 0, ZMQ_POLLIN, 0}};
+    while (!stopping)
+    {
+        if (zmq_poll(items, 2, -1) < 0)
+        {
+            continue; // Interrupted by a signal
+        }
+
+        if (items[0].revents & ZMQ_POLLIN)
+        {
+            // The topic, then the protobuf message
+            int more = 0;
+            size_t more_size = sizeof(more);
+            zmq_recv(subscriber, message, sizeof(message), 0);
+            zmq_getsockopt(subscriber, ZMQ_RCVMORE, &more, &more_size);
+            int size = more ? zmq_recv(subscriber, message, sizeof(message), 0) : -1;
+            ScoreUpdates *updates = size >= 0 && size <= (int)sizeof(message) ? score_updates__unpack(NULL, size, (uint8_t *)message) : NULL;
+            if (updates != NULL)
+            {
+                update_sessions(store, sessions, updates);
+                score_updates__free_unpacked(updates, NULL);
+            }
+        }
+
+        if (items[1].revents & ZMQ_POLLIN)
+        {
+            int size = zmq_recv(responder, message, sizeof(message) - 1, 0);
+            if (size >= 0)
+            {
+                message[size < (int)sizeof(message) ? size : (int)sizeof(message) - 1] = '\0';
+                answer_query(store, message, reply);
+                zmq_send(responder, reply, strlen(reply), 0);
+            }
+        }
+    }
+
+    zmq_close(subscriber);
+    zmq_close(responder);
+    zmq_ctx_destroy(context);
+    score_store_close(store);
+    return EXIT_SUCCESS;
+}
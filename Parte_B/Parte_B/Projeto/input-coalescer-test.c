@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <string.h>
+#include <ncurses.h>
+#include "common.h"
+#include "input-coalescer.h"
+
+static int failures = 0;
+
+/**
+ * Function: key
+ * -------------
+ * Returns the command of a key: a move in a direction, or a shot if fire.
+ */
+static remote_char_t key(bool fire, direction_t direction)
+{
+    remote_char_t input;
+    memset(&input, 0, sizeof(input));
+    input.msg_type = fire ? 2 : 1;
+    input.direction = direction;
+    return input;
+}
+
+/**
+ * Function: check
+ * ---------------
+ * Adds the keys to a coalescer and compares the commands it takes with the
+ * expected ones, printing the result of the case.
+ *
+ * name: The name of the case.
+ * keys, key_count: The keys pressed, in order.
+ * expected, expected_count: The commands that must be sent, in order.
+ */
+static void check(const char *name, const remote_char_t keys[], int key_count,
+                  const remote_char_t expected[], int expected_count)
+{
+    remote_char_t join;
+    memset(&join, 0, sizeof(join));
+    join.ch = 'A';
+    input_coalescer_t coalescer;
+    coalescer_init(&coalescer, NULL, &join, INPUT_DEFAULT_RATE);
+    for (int i = 0; i < key_count; i++)
+    {
+        coalescer_add(&coalescer, &keys[i]);
+    }
+
+    remote_char_t commands[COALESCED_MAX];
+    int count = coalescer_take(&coalescer, commands);
+    bool ok = count == expected_count;
+    for (int i = 0; ok && i < count; i++)
+    {
+        ok = commands[i].msg_type == expected[i].msg_type &&
+             (commands[i].msg_type != 1 || (commands[i].direction == expected[i].direction &&
+                                            commands[i].steps == expected[i].steps));
+    }
+    ok = ok && coalescer_take(&coalescer, commands) == 0; // Nothing is left to send
+
+    printf("%s: %s\n", ok ? "PASS" : "FAIL", name);
+    failures += !ok;
+}
+
+/**
+ * Function: moved
+ * ---------------
+ * Returns an expected move of several cells.
+ */
+static remote_char_t moved(direction_t direction, int steps)
+{
+    remote_char_t command = key(false, direction);
+    command.steps = steps;
+    return command;
+}
+
+int main(void)
+{
+    remote_char_t shot = key(true, UP);
+
+    remote_char_t mixed[] = {key(false, DOWN), key(false, DOWN), key(false, DOWN), key(false, LEFT)};
+    remote_char_t mixed_sent[] = {moved(DOWN, 3), moved(LEFT, 1)};
+    check("mixed-axis window sends both axes in key order", mixed, 4, mixed_sent, 2);
+
+    remote_char_t crossed[] = {key(false, LEFT), key(false, UP), key(false, RIGHT), key(false, RIGHT)};
+    remote_char_t crossed_sent[] = {moved(RIGHT, 1), moved(UP, 1)};
+    check("an axis is sent at its first key", crossed, 4, crossed_sent, 2);
+
+    remote_char_t fire_first[] = {shot, key(false, LEFT), key(false, LEFT)};
+    remote_char_t fire_first_sent[] = {shot, moved(LEFT, 2)};
+    check("shot before the move", fire_first, 3, fire_first_sent, 2);
+
+    remote_char_t fire_between[] = {key(false, UP), shot, key(false, RIGHT), shot};
+    remote_char_t fire_between_sent[] = {moved(UP, 1), shot, moved(RIGHT, 1)};
+    check("shot between the axes", fire_between, 4, fire_between_sent, 3);
+
+    remote_char_t cancelled[] = {key(false, LEFT), key(false, DOWN), key(false, RIGHT)};
+    remote_char_t cancelled_sent[] = {moved(DOWN, 1)};
+    check("opposite keys cancel", cancelled, 3, cancelled_sent, 1);
+
+    remote_char_t many[MAX_MOVE_STEPS + 4];
+    for (int i = 0; i < MAX_MOVE_STEPS + 4; i++)
+    {
+        many[i] = key(false, UP);
+    }
+    remote_char_t many_sent[] = {moved(UP, MAX_MOVE_STEPS)};
+    check("steps are capped", many, MAX_MOVE_STEPS + 4, many_sent, 1);
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,206 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <ncurses.h>
+#include "common.h"
+#include "input-coalescer.h"
+
+/**
+ * Function: now_ms
+ * ----------------
+ * Returns a monotonic timestamp in milliseconds.
+ */
+static int64_t now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Function: send_command
+ * ----------------------
+ * Sends one command of the player as the next request of its session.
+ *
+ * coalescer: The coalescer.
+ * msg_type, direction, steps: The command.
+ */
+static void send_command(input_coalescer_t *coalescer, int msg_type, direction_t direction, int steps)
+{
+    remote_char_t *m = &coalescer->command;
+    char reply[sizeof(remote_char_t)];
+    m->msg_type = msg_type;
+    m->direction = direction;
+    m->steps = steps;
+    m->seq++;
+    send_request(coalescer->requester, m, sizeof(*m), reply, sizeof(reply)); // Sent again if the server restarts
+}
+
+/**
+ * Function: coalescer_init
+ * ------------------------
+ * Prepares the keys of a player to be sent at most rate times per second.
+ *
+ * coalescer: The coalescer.
+ * requester: The REQ socket of the player.
+ * join: The reply to the join, with the character and ticket of the player.
+ * rate: Sends per second at most. Each send is COALESCED_MAX commands at most.
+ */
+void coalescer_init(input_coalescer_t *coalescer, void *requester, const remote_char_t *join, int rate)
+{
+    memset(coalescer, 0, sizeof(*coalescer));
+    coalescer->requester = requester;
+    coalescer->command.ch = join->ch;
+    strcpy(coalescer->command.ticket, join->ticket);
+    coalescer->period_ms = 1000 / (rate > 0 ? rate : 1);
+    coalescer->heartbeat_ms = now_ms() + SESSION_HEARTBEAT_MS;
+}
+
+/**
+ * Function: coalescer_add
+ * -----------------------
+ * Adds a key to the ones not sent yet.
+ *
+ * coalescer: The coalescer.
+ * input: The command of the key, a move (msg_type 1) or a shot (msg_type 2);
+ *        anything else is ignored.
+ *
+ * Moves add up to the net movement on each axis, and the shots to one shot.
+ * The order in which the axes and the shot were first pressed is kept.
+ */
+void coalescer_add(input_coalescer_t *coalescer, const remote_char_t *input)
+{
+    char kind;
+    if (input->msg_type == 2)
+    {
+        coalescer->fire = true;
+        kind = 'f';
+    }
+    else if (input->msg_type == 1)
+    {
+        bool vertical = input->direction == UP || input->direction == DOWN;
+        int delta = input->direction == DOWN || input->direction == RIGHT ? 1 : -1;
+        *(vertical ? &coalescer->net_rows : &coalescer->net_cols) += delta;
+        kind = vertical ? 'v' : 'h';
+    }
+    else
+    {
+        return;
+    }
+    if (memchr(coalescer->order, kind, coalescer->order_count) == NULL)
+    {
+        coalescer->order[coalescer->order_count++] = kind;
+    }
+}
+
+/**
+ * Function: coalescer_take
+ * ------------------------
+ * Turns the keys not sent yet into the commands to send, and forgets them.
+ *
+ * coalescer: The coalescer.
+ * commands: Where the commands are stored, in the order they must be sent;
+ *           only msg_type, direction and steps are set.
+ *
+ * The net movement on each axis is one move of several cells, and the shots
+ * one shot. The player's area lets it move along one axis only, but the
+ * client does not know which: both axes are sent, and the server ignores the
+ * move that leaves the area. Returns the number of commands.
+ */
+int coalescer_take(input_coalescer_t *coalescer, remote_char_t commands[COALESCED_MAX])
+{
+    int count = 0;
+    for (int i = 0; i < coalescer->order_count; i++)
+    {
+        remote_char_t *command = &commands[count];
+        memset(command, 0, sizeof(*command));
+        if (coalescer->order[i] == 'f')
+        {
+            command->msg_type = 2;
+            count++;
+            continue;
+        }
+        bool vertical = coalescer->order[i] == 'v';
+        int net = vertical ? coalescer->net_rows : coalescer->net_cols;
+        if (net == 0)
+        {
+            continue; // The keys cancelled each other
+        }
+        command->msg_type = 1;
+        command->direction = vertical ? (net > 0 ? DOWN : UP) : (net > 0 ? RIGHT : LEFT);
+        command->steps = abs(net) < MAX_MOVE_STEPS ? abs(net) : MAX_MOVE_STEPS;
+        count++;
+    }
+
+    coalescer->net_rows = 0;
+    coalescer->net_cols = 0;
+    coalescer->fire = false;
+    coalescer->order_count = 0;
+    return count;
+}
+
+/**
+ * Function: coalescer_wait_ms
+ * ---------------------------
+ * Returns how long the player may be waited for before the keys not sent yet
+ * are due, or the next heartbeat if there are none, in milliseconds.
+ */
+int coalescer_wait_ms(input_coalescer_t *coalescer)
+{
+    bool pending = coalescer->net_rows != 0 || coalescer->net_cols != 0 || coalescer->fire;
+    int64_t wait = (pending ? coalescer->next_send_ms : coalescer->heartbeat_ms) - now_ms();
+    return wait > 0 ? (int)wait : 0;
+}
+
+/**
+ * Function: coalescer_flush
+ * -------------------------
+ * Sends the keys not sent yet, if the period since the last send is over, or
+ * a heartbeat if there are none and nothing was sent for SESSION_HEARTBEAT_MS.
+ *
+ * coalescer: The coalescer.
+ * now: true to send the keys even before the end of the period, as before leaving.
+ *
+ * The commands are those of coalescer_take, in the order the keys were
+ * pressed. The first key after a pause is sent at once, so a single key press
+ * has no added delay.
+ */
+void coalescer_flush(input_coalescer_t *coalescer, bool now)
+{
+    if (coalescer->net_rows == 0 && coalescer->net_cols == 0 && !coalescer->fire)
+    {
+        coalescer->order_count = 0; // Keys that cancelled each other
+        if (!now && coalescer_wait_ms(coalescer) == 0)
+        {
+            send_command(coalescer, 4, UP, 0); // Keeps the session of an idle player
+            coalescer->heartbeat_ms = now_ms() + SESSION_HEARTBEAT_MS;
+        }
+        return;
+    }
+    if (coalescer_wait_ms(coalescer) > 0 && !now)
+    {
+        return; // Not yet
+    }
+
+    remote_char_t commands[COALESCED_MAX];
+    int count = coalescer_take(coalescer, commands);
+    for (int i = 0; i < count; i++)
+    {
+        send_command(coalescer, commands[i].msg_type, commands[i].direction, commands[i].steps);
+    }
+    coalescer->next_send_ms = now_ms() + coalescer->period_ms;
+    coalescer->heartbeat_ms = now_ms() + SESSION_HEARTBEAT_MS;
+}
+
+/**
+ * Function: coalescer_leave
+ * -------------------------
+ * Sends the keys not sent yet, then the leave of the player.
+ *
+ * coalescer: The coalescer.
+ */
+void coalescer_leave(input_coalescer_t *coalescer)
+{
+    coalescer_flush(coalescer, true);
+    send_command(coalescer, 3, UP, 0);
+}
@@ -0,0 +1,51 @@
+#ifndef __INPUT_COALESCER_H_INCLUDED__
+#define __INPUT_COALESCER_H_INCLUDED__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "remote-char.h"
+
+#define INPUT_DEFAULT_RATE 10 // Sends per second at most
+#define COALESCED_MAX 3       // Commands in one send at most: a move on each axis and a shot
+
+/**
+ * Struct: input_coalescer_t
+ * -------------------------
+ * The keys pressed by a player and not sent yet.
+ *
+ * requester: The REQ socket of the player.
+ * command: The command sent, with the character and ticket of the player and
+ *          the seq of the last request of the session.
+ * period_ms: Time between two sends, from the rate.
+ * next_send_ms: Earliest time of the next send.
+ * heartbeat_ms: Time of the next heartbeat, pushed back by every send.
+ * net_rows, net_cols: Cells moved down and right, the opposite keys cancelling
+ *                     each other.
+ * fire: true if fire was pressed.
+ * order, order_count: The kinds of keys pressed, in the order of their first
+ *                     key: 'v' for up and down, 'h' for left and right, 'f'
+ *                     for fire. The commands are sent in that order, so a
+ *                     shot leaves from the cell it was fired from.
+ */
+typedef struct input_coalescer_t
+{
+    void *requester;
+    remote_char_t command;
+    int64_t period_ms;
+    int64_t next_send_ms;
+    int64_t heartbeat_ms;
+    int net_rows;
+    int net_cols;
+    bool fire;
+    char order[COALESCED_MAX];
+    int order_count;
+} input_coalescer_t;
+
+void coalescer_init(input_coalescer_t *coalescer, void *requester, const remote_char_t *join, int rate);
+void coalescer_add(input_coalescer_t *coalescer, const remote_char_t *input);
+int coalescer_take(input_coalescer_t *coalescer, remote_char_t commands[COALESCED_MAX]);
+int coalescer_wait_ms(input_coalescer_t *coalescer);
+void coalescer_flush(input_coalescer_t *coalescer, bool now);
+void coalescer_leave(input_coalescer_t *coalescer);
+
+#endif // __INPUT_COALESCER_H_INCLUDED__
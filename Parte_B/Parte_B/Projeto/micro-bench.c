@@ -0,0 +1,443 @@
+#include <ncurses.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include "game-logic.h"
+#include "alien-step.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_RDTSC 1
+#endif
+
+#define WARMUP_NS 20000000 // Time each benchmark runs before measuring
+#define REP_NS 2000000     // Minimum length of one repetition
+
+/**
+ * Struct: bench_ctx_t
+ * -------------------
+ * The state a benchmark runs on.
+ *
+ * game: A match with its own windows, as set up by the server.
+ * snapshot: A copy of the board, restored before every operation of benchmarks
+ *           that modify it.
+ * win: The window serialized by the serialize_window benchmarks.
+ * x, y: The position the zap benchmarks fire from.
+ * count: A benchmark specific count (aliens to spawn, ticket to look up).
+ * initial_aliens: The number of aliens on the snapshot.
+ * grid, next_grid, grid_size: Grids of grid_size * grid_size cells for alien_grid_step.
+ */
+typedef struct bench_ctx_t
+{
+    game_t game;
+    WINDOW *snapshot;
+    WINDOW *win;
+    int x, y;
+    int count;
+    int initial_aliens;
+    uint8_t *grid, *next_grid;
+    int grid_size;
+} bench_ctx_t;
+
+static int repetitions = 15;
+static const char *name_filter = NULL;
+
+/**
+ * Function: now_ns
+ * ----------------
+ * Returns a monotonic timestamp in nanoseconds.
+ */
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * Function: now_cycles
+ * --------------------
+ * Returns the time stamp counter, or 0 where there is none.
+ */
+static uint64_t now_cycles(void)
+{
+#ifdef HAVE_RDTSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Function: compare_double
+ * ------------------------
+ * Comparison function for qsort on doubles.
+ */
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Function: run_bench
+ * -------------------
+ * Times one operation and prints a line with its cost.
+ *
+ * name: The function being measured.
+ * params: The board size, fill ratio or player count of this run.
+ * reset: Called before every operation, outside the timed region (may be NULL).
+ * op: The operation to measure.
+ * ctx: Passed to reset and op.
+ * ops_per_call: How many operations one call of op performs.
+ *
+ * The operation first runs for WARMUP_NS. Then it is repeated in batches of at
+ * least REP_NS, and the median and minimum over the repetitions are printed in
+ * nanoseconds and cycles per operation.
+ */
+static void run_bench(const char *name, const char *params, void (*reset)(bench_ctx_t *), void (*op)(bench_ctx_t *), bench_ctx_t *ctx, int ops_per_call)
+{
+    if (name_filter != NULL && strstr(name, name_filter) == NULL)
+    {
+        return;
+    }
+
+    // Warm up and find how many calls fill one repetition
+    long batch = 0;
+    int64_t warm_start = now_ns();
+    while (now_ns() - warm_start < WARMUP_NS)
+    {
+        if (reset)
+            reset(ctx);
+        op(ctx);
+        batch++;
+    }
+    batch = batch * REP_NS / WARMUP_NS + 1;
+
+    double ns[repetitions], cycles[repetitions];
+    for (int r = 0; r < repetitions; r++)
+    {
+        int64_t elapsed = 0;
+        uint64_t elapsed_cycles = 0;
+        for (long i = 0; i < batch; i++)
+        {
+            if (reset)
+                reset(ctx);
+            uint64_t c0 = now_cycles();
+            int64_t t0 = now_ns();
+            op(ctx);
+            elapsed += now_ns() - t0;
+            elapsed_cycles += now_cycles() - c0;
+        }
+        ns[r] = (double)elapsed / batch / ops_per_call;
+        cycles[r] = (double)elapsed_cycles / batch / ops_per_call;
+    }
+    qsort(ns, repetitions, sizeof(double), compare_double);
+    qsort(cycles, repetitions, sizeof(double), compare_double);
+
+    printf("%-20s %-22s %12.1f %12.1f", name, params, ns[repetitions / 2], ns[0]);
+#ifdef HAVE_RDTSC
+    printf(" %12.1f\n", cycles[repetitions / 2]);
+#else
+    printf(" %12s\n", "-");
+#endif
+}
+
+/**
+ * Function: fill_zone
+ * -------------------
+ * Clears the alien zone and places aliens on a given number of its cells.
+ *
+ * board_win: The board.
+ * aliens: The number of aliens, up to 256.
+ *
+ * The cells are chosen with a fixed seed, so every run measures the same board.
+ */
+static void fill_zone(WINDOW *board_win, int aliens)
+{
+    int cells[256];
+    unsigned int seed = 12345;
+    for (int i = 0; i < 256; i++)
+    {
+        cells[i] = i;
+        mvwaddch(board_win, 3 + i / 16, 3 + i % 16, ' ');
+    }
+    for (int i = 0; i < aliens; i++)
+    {
+        int j = i + rand_r(&seed) % (256 - i);
+        int cell = cells[j];
+        cells[j] = cells[i];
+        cells[i] = cell;
+        mvwaddch(board_win, 3 + cell / 16, 3 + cell % 16, '*');
+    }
+}
+
+/**
+ * Function: setup_board
+ * ---------------------
+ * Prepares the board of a benchmark: aliens in the zone, players in their
+ * areas, and a snapshot to restore it.
+ *
+ * ctx: The benchmark state.
+ * aliens: The number of aliens in the zone.
+ * players: The number of players, one per area.
+ */
+static void setup_board(bench_ctx_t *ctx, int aliens, int players)
+{
+    game_t *game = &ctx->game;
+    for (int i = 0; i < game->client_count; i++)
+    {
+        mvwaddch(game->board_win, game->clients[i].pos_x, game->clients[i].pos_y, ' ');
+    }
+    game->client_count = 0;
+    fill_zone(game->board_win, aliens);
+
+    for (int area = 0; area < players; area++)
+    {
+        int x, y;
+        ChoosePlayerPosition(area, &x, &y);
+        generate_ticket(game->clients[game->client_count].ticket, sizeof(game->clients[0].ticket));
+        add_client(game->clients, &game->client_count, 'A' + area, x, y, game->clients[game->client_count].ticket);
+        mvwaddch(game->board_win, x, y, ('A' + area) | A_BOLD);
+    }
+    game->aliens_alive = aliens;
+    ctx->initial_aliens = aliens;
+    copywin(game->board_win, ctx->snapshot, 0, 0, 0, 0, BOARD_HEIGHT + 1, BOARD_WIDTH + 1, FALSE);
+}
+
+/**
+ * Function: restore_board
+ * -----------------------
+ * Puts the board back as setup_board left it.
+ */
+static void restore_board(bench_ctx_t *ctx)
+{
+    copywin(ctx->snapshot, ctx->game.board_win, 0, 0, 0, 0, BOARD_HEIGHT + 1, BOARD_WIDTH + 1, FALSE);
+    ctx->game.aliens_alive = ctx->initial_aliens;
+    ctx->game.last_aliens_alive = ctx->initial_aliens;
+    ctx->game.iterations = 0; // Never respawn during alien_step
+    for (int i = 0; i < ctx->game.client_count; i++)
+    {
+        ctx->game.clients[i].score = 0;
+    }
+}
+
+static void op_serialize_window(bench_ctx_t *ctx)
+{
+    free(serialize_window(ctx->win));
+}
+
+static void op_get_player_area(bench_ctx_t *ctx)
+{
+    int found = 0;
+    for (int line = 0; line < WINDOW_SIZE; line++)
+    {
+        for (int column = 0; column < WINDOW_SIZE; column++)
+        {
+            found += get_player_area(line, column) != '\0';
+        }
+    }
+    ctx->count = found; // Keeps the loop from being optimized away
+}
+
+static void op_move_player(bench_ctx_t *ctx)
+{
+    // Every player tries the four directions in turn, half of them out of its area
+    game_t *game = &ctx->game;
+    remote_char_t command = {.msg_type = 1, .direction = (direction_t)(ctx->count++ & 3)};
+    for (int i = 0; i < game->client_count; i++)
+    {
+        command.ch = game->clients[i].ch;
+        move_player(game->board_win, game->client_count, game->clients, command);
+    }
+}
+
+static void op_validate_ticket(bench_ctx_t *ctx)
+{
+    ch_info_t *last = &ctx->game.clients[ctx->game.client_count - 1];
+    ctx->x = validate_ticket(ctx->game.clients, ctx->game.client_count, last->ch, last->ticket);
+}
+
+static void op_draw_score(bench_ctx_t *ctx)
+{
+    draw_score(ctx->game.score_win, ctx->game.clients, ctx->game.client_count, NULL);
+}
+
+static void op_zap_effect(bench_ctx_t *ctx)
+{
+    game_t *game = &ctx->game;
+    zap_effect(game->board_win, ctx->x, ctx->y, &game->aliens_alive, game->clients, game->client_count, game->clients[0].ch);
+}
+
+static void op_spawn_aliens(bench_ctx_t *ctx)
+{
+    spawn_aliens(ctx->game.board_win, ctx->count);
+}
+
+static void op_alien_step(bench_ctx_t *ctx)
+{
+    alien_step(&ctx->game);
+}
+
+static void op_alien_grid_step(bench_ctx_t *ctx)
+{
+    alien_grid_step(ctx->grid, ctx->next_grid, ctx->grid_size, ctx->grid_size, 1, ctx->count++);
+}
+
+/**
+ * Function: usage
+ * ---------------
+ * Prints the command-line options of the microbenchmarks.
+ *
+ * program: The name of the executable.
+ */
+static void usage(const char *program)
+{
+    fprintf(stderr,
+            "Usage: %s [--reps N] [--filter NAME]\n"
+            "  --reps N       repetitions measured per benchmark (default: 15)\n"
+            "  --filter NAME  only run the benchmarks whose name contains NAME\n",
+            program);
+}
+
+int main(int argc, char *argv[])
+{
+    static struct option long_options[] = {
+        {"reps", required_argument, NULL, 'r'},
+        {"filter", required_argument, NULL, 'f'},
+        {NULL, 0, NULL, 0}};
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'r':
+            repetitions = atoi(optarg);
+            break;
+        case 'f':
+            name_filter = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (repetitions < 1)
+    {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    SCREEN *screen = open_headless_screen();
+    static bench_ctx_t ctx;
+    WINDOW *numbers;
+    setup_game(&ctx.game, &numbers, NULL, 1, 0);
+    ctx.game.mode = GAME_REPLAY; // Zaps are never scheduled for removal
+    ctx.snapshot = newwin(BOARD_HEIGHT + 2, BOARD_WIDTH + 2, 0, 0);
+    char params[64];
+
+    printf("%-20s %-22s %12s %12s %12s\n", "function", "params", "median ns/op", "min ns/op", "cycles/op");
+
+    // Window sizes: the score, the board, and larger boards
+    int sizes[][2] = {{BOARD_HEIGHT + 2, SCORE_WIDTH}, {BOARD_HEIGHT + 2, BOARD_WIDTH + 2}, {42, 42}, {82, 82}};
+    for (int i = 0; i < 4; i++)
+    {
+        ctx.win = newwin(sizes[i][0], sizes[i][1], 0, 0);
+        snprintf(params, sizeof(params), "window=%dx%d", sizes[i][0], sizes[i][1]);
+        run_bench("serialize_window", params, NULL, op_serialize_window, &ctx, 1);
+        delwin(ctx.win);
+    }
+
+    run_bench("get_player_area", "all cells", NULL, op_get_player_area, &ctx, WINDOW_SIZE * WINDOW_SIZE);
+
+    // The game functions below are written for the 16x16 alien zone and the
+    // fixed areas around it, so they only run on the real board; the larger
+    // boards are measured by serialize_window and alien_grid_step
+    int player_counts[] = {1, 4, 8};
+    for (int i = 0; i < 3; i++)
+    {
+        setup_board(&ctx, MAX_ALIENS, player_counts[i]);
+        snprintf(params, sizeof(params), "players=%d", player_counts[i]);
+        run_bench("validate_ticket", params, NULL, op_validate_ticket, &ctx, 1);
+        run_bench("draw_score", params, NULL, op_draw_score, &ctx, 1);
+        run_bench("move_player", params, NULL, op_move_player, &ctx, player_counts[i]);
+    }
+
+    // Zaps from area A (horizontal) and area E (vertical) across the alien zone
+    int fills[] = {MAX_ALIENS, 230};
+    for (int f = 0; f < 2; f++)
+    {
+        for (int i = 0; i < 3; i += 2)
+        {
+            setup_board(&ctx, fills[f], player_counts[i]);
+            for (int area = 0; area <= 4; area += 4)
+            {
+                ChoosePlayerPosition(area, &ctx.x, &ctx.y);
+                snprintf(params, sizeof(params), "fill=%d%% players=%d %c", fills[f] * 100 / 256, player_counts[i], area == 0 ? 'H' : 'V');
+                run_bench("zap_effect", params, restore_board, op_zap_effect, &ctx, 1);
+            }
+        }
+    }
+
+    // Respawns into an almost full zone
+    int spawn_fills[][2] = {{128, 1}, {230, 1}, {253, 1}, {230, 25}};
+    for (int i = 0; i < 4; i++)
+    {
+        setup_board(&ctx, spawn_fills[i][0], 0);
+        ctx.count = spawn_fills[i][1];
+        snprintf(params, sizeof(params), "fill=%d%% spawn=%d", spawn_fills[i][0] * 100 / 256, ctx.count);
+        run_bench("spawn_aliens", params, restore_board, op_spawn_aliens, &ctx, 1);
+    }
+
+    int alien_counts[] = {MAX_ALIENS, 170, 250};
+    for (int i = 0; i < 3; i++)
+    {
+        setup_board(&ctx, alien_counts[i], 8);
+        snprintf(params, sizeof(params), "aliens=%d", alien_counts[i]);
+        run_bench("alien_step", params, restore_board, op_alien_step, &ctx, 1);
+    }
+
+    // Large boards, with aliens on a third of the cells, with every kernel and on 1 and 4 threads
+    const char *kernels[] = {"scalar", "sse2", "avx2"};
+    int grid_sizes[] = {256, 1024};
+    int thread_counts[] = {1, 4};
+    for (int i = 0; i < 2; i++)
+    {
+        int size = grid_sizes[i];
+        ctx.grid_size = size;
+        ctx.grid = malloc(size * size);
+        ctx.next_grid = malloc(size * size);
+        for (int cell = 0; cell < size * size; cell++)
+        {
+            ctx.grid[cell] = cell % 3 == 0 ? CELL_ALIEN : CELL_FREE;
+        }
+        for (int k = 0; k < 3; k++)
+        {
+            if (!alien_kernel_select(kernels[k]))
+            {
+                continue;
+            }
+            for (int t = 0; t < 2; t++)
+            {
+                alien_pool_start(thread_counts[t]);
+                snprintf(params, sizeof(params), "%dx%d %s threads=%d", size, size, kernels[k], thread_counts[t]);
+                run_bench("alien_grid_step", params, NULL, op_alien_grid_step, &ctx, 1);
+                alien_pool_stop();
+            }
+        }
+        alien_kernel_select(NULL);
+        free(ctx.grid);
+        free(ctx.next_grid);
+    }
+
+    delwin(ctx.snapshot);
+    delwin(ctx.game.board_win);
+    delwin(numbers);
+    delwin(ctx.game.score_win);
+    endwin();
+    delscreen(screen);
+    return 0;
+}
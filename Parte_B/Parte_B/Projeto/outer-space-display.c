@@ -3,32 +3,11 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
+#include <getopt.h>
 #include "zhelpers.h"
 #include "common.h"
 
-/**
- * Function: deserialize_window
- * ----------------------------
- * Deserializes a buffer into a window's contents.
- *
- * win: A pointer to the window to be updated.
- * buffer: A buffer containing the serialized window content.
- *
- * This function does not return a value.
- */
-void deserialize_window(WINDOW **win, char *buffer)
-{
-    int rows, cols;
-    getmaxyx(*win, rows, cols);
-    for (int y = 1; y < rows - 1; y++)
-    {
-        for (int x = 1; x < cols - 1; x++)
-        {
-            mvwaddch(*win, y, x, buffer[y * cols + x]);
-        }
-    }
-}
-
 /**
  * Function: main
  * --------------
@@ -36,16 +15,45 @@ void deserialize_window(WINDOW **win, char *buffer)
  * sets up ncurses, and continuously updates the display windows with data received from the server.
  *
  * argc: The number of command-line arguments.
- * argv: An array of command-line arguments.
+ * argv: An array of command-line arguments. --conflate renders only the newest
+ *       frame received, skipping the ones queued behind it; --frames sets the
+ *       publisher to subscribe to, the server or a relay.
  *
  * Returns 0 on successful execution.
  */
 int main(int argc, char *argv[])
 {
+    bool conflate = false;
+    const char *frames = FRAMES_ENDPOINT;
+    static struct option long_options[] = {
+        {"conflate", no_argument, NULL, 'C'},
+        {"frames", required_argument, NULL, 'f'},
+        {NULL, 0, NULL, 0}};
+    int opt;
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'C':
+            conflate = true;
+            break;
+        case 'f':
+            frames = optarg;
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [--conflate] [--frames ENDPOINT]\n"
+                            "  --conflate  render only the newest frame, skipping frames queued behind it\n"
+                            "  --frames E  endpoint of the frames, of the server or of a relay (default: %s)\n",
+                    argv[0], FRAMES_ENDPOINT);
+            return EXIT_FAILURE;
+        }
+    }
+
     // Initialize ZeroMQ context and requester socket
     void *context = NULL;
-    void *requester = initialize_zmq_socket(&context, ZMQ_SUB, "tcp://localhost:5555", false);
-    zmq_setsockopt(requester, ZMQ_SUBSCRIBE, "", 0);
+    void *requester = initialize_zmq_socket(&context, ZMQ_SUB, frames, false);
+    frame_stream_t stream;
+    subscribe_frames(&stream, requester);
 
     // Initialize ncurses and create windows
     initscr();
@@ -57,6 +65,7 @@ int main(int argc, char *argv[])
     WINDOW *numbers = newwin(BOARD_HEIGHT + 3, BOARD_WIDTH + 3, 0, 0); // +3 to include borders and coordinate numbers
     WINDOW *board_win = derwin(numbers, BOARD_HEIGHT + 2, BOARD_WIDTH + 2, 1, 1);
     WINDOW *score_win = newwin(BOARD_HEIGHT + 2, SCORE_WIDTH, 1, BOARD_WIDTH + 4);
+    WINDOW *status_win = newwin(1, BOARD_WIDTH + 4 + SCORE_WIDTH, BOARD_HEIGHT + 3, 0); // Frames skipped and dropped
 
     // Draw initial board structure
     draw_board(numbers);
@@ -65,32 +74,46 @@ int main(int argc, char *argv[])
     wrefresh(board_win);
     wrefresh(score_win);
 
+    int score_rows, score_cols;
+    getmaxyx(score_win, score_rows, score_cols);
+    char score_buffer[score_rows * score_cols];
+    char *last_score = calloc(score_rows * score_cols, 1); // The frames on screen, to draw only what changed
+
+    int board_rows, board_cols;
+    getmaxyx(board_win, board_rows, board_cols);
+    char board_buffer[board_rows * board_cols];
+    char *last_board = calloc(board_rows * board_cols, 1);
+
     curs_set(0);
     while (1)
     {
-        int rows, cols;
-        getmaxyx(score_win, rows, cols);
-        char score_buffer[rows * cols];
-
-        getmaxyx(board_win, rows, cols);
-        char board_buffer[rows * cols];
-
-
-
-        zmq_recv(requester, score_buffer, rows * cols, 0);
-        zmq_recv(requester, board_buffer, rows * cols, 0);
+        long dropped = stream.dropped;
+        bool keyframes_only = stream.keyframes_only;
+        int skipped = receive_frame(&stream, score_buffer, score_rows * score_cols, board_buffer, board_rows * board_cols, conflate);
+        if (skipped > 0 || stream.dropped != dropped || stream.keyframes_only != keyframes_only) // Also when promoted back
+        {
+            mvwprintw(status_win, 0, 0, "skipped %ld, dropped %ld%s", stream.skipped, stream.dropped,
+                      stream.keyframes_only ? ", keyframes only" : "");
+            wclrtoeol(status_win);
+            wnoutrefresh(status_win);
+        }
 
-        deserialize_window(&score_win, score_buffer);
-        deserialize_window(&board_win, board_buffer);
+        deserialize_window(score_win, score_buffer, last_score);
+        deserialize_window(board_win, board_buffer, last_board);
 
-        wrefresh(score_win);
-        wrefresh(board_win);
+        // One terminal update for all windows
+        wnoutrefresh(score_win);
+        wnoutrefresh(board_win);
+        doupdate();
     }
 
     // Clean up
     delwin(board_win);
     delwin(score_win);
+    delwin(status_win);
     delwin(numbers);
+    free(last_score);
+    free(last_board);
     zmq_close(requester);
     zmq_ctx_destroy(context);
     endwin();
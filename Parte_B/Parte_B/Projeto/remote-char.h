@@ -1,5 +1,11 @@
+#ifndef __REMOTE_CHAR_H_INCLUDED__
+#define __REMOTE_CHAR_H_INCLUDED__
+
+#include <stdint.h>
 #include <time.h>
 
+#define MAX_MOVE_STEPS 16 // The length of an area
+
 /**
  * Enum: direction_t
  * -----------------
@@ -18,18 +24,24 @@ typedef enum direction_t
  * ---------------------
  * Represents a remote character and its actions.
  *
- * msg_type: The type of message (0 - join, 1 - move, 2 - firing, 3 - leave).
+ * msg_type: The type of message (0 - join, 1 - move, 2 - firing, 3 - leave,
+ *           4 - heartbeat, sent by a player with nothing else to send).
  * ch: The character representing the player.
  * ticket: The ticket string for the client.
  * direction: The direction of movement.
+ * steps: Cells to move in that direction, for moves coalesced by the client;
+ *        0 is read as 1, and at most MAX_MOVE_STEPS are moved.
+ * seq: Number of the request in the session, counting from 1, or 0 for none.
+ *      A request sent again keeps its number, so the server applies it once.
  */
 typedef struct remote_char_t
 {
-    int msg_type; // 0 - join, 1 - move, 2 - Firing, 3 - leave
+    int msg_type; // 0 - join, 1 - move, 2 - Firing, 3 - leave, 4 - heartbeat
     char ch;
     char ticket[7];
     direction_t direction;
-    /* data */
+    int steps;
+    uint32_t seq;
 } remote_char_t;
 
 /**
@@ -57,3 +69,5 @@ typedef struct ch_info_t
     time_t hit_time;
     time_t shoot_time;
 } ch_info_t;
+
+#endif // __REMOTE_CHAR_H_INCLUDED__
@@ -0,0 +1,253 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include "replay-log.h"
+
+/**
+ * Function: put_u16 / put_u32 / put_u64
+ * -------------------------------------
+ * Store an integer in a byte buffer in little-endian order, so that logs
+ * written on one machine can be replayed on another.
+ */
+static void put_u16(uint8_t *out, uint16_t value)
+{
+    out[0] = value & 0xff;
+    out[1] = value >> 8;
+}
+
+static void put_u32(uint8_t *out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        out[i] = (value >> (8 * i)) & 0xff;
+    }
+}
+
+static void put_u64(uint8_t *out, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        out[i] = (value >> (8 * i)) & 0xff;
+    }
+}
+
+/**
+ * Function: get_u16 / get_u32 / get_u64
+ * -------------------------------------
+ * Read back an integer stored by the put_* functions.
+ */
+static uint16_t get_u16(const uint8_t *in)
+{
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *in)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        value |= (uint32_t)in[i] << (8 * i);
+    }
+    return value;
+}
+
+static uint64_t get_u64(const uint8_t *in)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        value |= (uint64_t)in[i] << (8 * i);
+    }
+    return value;
+}
+
+/**
+ * Function: replay_log_create
+ * ---------------------------
+ * Creates a new replay log and writes its header.
+ *
+ * path: The file to create (truncated if it exists).
+ * seed: The seed used for the random number generator of the match.
+ * initial_aliens: The number of aliens spawned at the start of the match.
+ * start_ms: Game clock time of the start of the match, in milliseconds.
+ *
+ * Returns the open log, or NULL if the file cannot be created.
+ */
+replay_log_t *replay_log_create(const char *path, uint32_t seed, uint32_t initial_aliens, int64_t start_ms)
+{
+    FILE *file = fopen(path, "wb");
+    if (file == NULL)
+    {
+        return NULL;
+    }
+
+    uint8_t header[REPLAY_HEADER_SIZE] = {0};
+    memcpy(header, REPLAY_MAGIC, 4);
+    put_u16(header + 4, REPLAY_VERSION);
+    put_u16(header + 6, REPLAY_RECORD_SIZE);
+    put_u32(header + 8, seed);
+    put_u32(header + 12, initial_aliens);
+    put_u64(header + 16, (uint64_t)start_ms);
+    fwrite(header, sizeof(header), 1, file);
+
+    replay_log_t *log = malloc(sizeof(replay_log_t));
+    log->file = file;
+    log->seed = seed;
+    log->initial_aliens = initial_aliens;
+    log->start_ms = start_ms;
+    log->records = 0;
+    return log;
+}
+
+/**
+ * Function: replay_log_open
+ * -------------------------
+ * Opens an existing replay log for reading and checks its header.
+ *
+ * path: The file to open.
+ *
+ * Returns the open log, or NULL if the file is missing or is not a replay log
+ * of a supported version.
+ */
+replay_log_t *replay_log_open(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+    {
+        return NULL;
+    }
+
+    uint8_t header[REPLAY_HEADER_SIZE];
+    if (fread(header, sizeof(header), 1, file) != 1 ||
+        memcmp(header, REPLAY_MAGIC, 4) != 0 ||
+        get_u16(header + 4) != REPLAY_VERSION ||
+        get_u16(header + 6) != REPLAY_RECORD_SIZE)
+    {
+        fclose(file);
+        return NULL;
+    }
+
+    replay_log_t *log = malloc(sizeof(replay_log_t));
+    log->file = file;
+    log->seed = get_u32(header + 8);
+    log->initial_aliens = get_u32(header + 12);
+    log->start_ms = (int64_t)get_u64(header + 16);
+    log->records = 0;
+    return log;
+}
+
+/**
+ * Function: replay_record_encode
+ * ------------------------------
+ * Stores a record in its on-disk form.
+ *
+ * record: The event.
+ * out: Where the record is stored, REPLAY_RECORD_SIZE bytes.
+ */
+void replay_record_encode(const replay_record_t *record, uint8_t *out)
+{
+    memset(out, 0, REPLAY_RECORD_SIZE);
+    put_u32(out, record->tick);
+    out[4] = (uint8_t)record->event;
+    if (record->event == REPLAY_COMMAND)
+    {
+        out[5] = (uint8_t)record->command.msg_type;
+        out[6] = (uint8_t)record->command.ch;
+        out[7] = (uint8_t)record->command.direction;
+        memcpy(out + 8, record->command.ticket, 6); // The 7th byte is always '\0'
+    }
+    else if (record->event == REPLAY_BULLET_EXPIRY)
+    {
+        out[7] = record->is_horizontal;
+        out[14] = (uint8_t)record->x;
+        out[15] = (uint8_t)record->y;
+    }
+}
+
+/**
+ * Function: replay_record_decode
+ * ------------------------------
+ * Reads back a record stored by replay_record_encode.
+ *
+ * in: The stored record, REPLAY_RECORD_SIZE bytes.
+ * record: Where the event is stored.
+ */
+void replay_record_decode(const uint8_t *in, replay_record_t *record)
+{
+    memset(record, 0, sizeof(*record));
+    record->tick = get_u32(in);
+    record->event = (replay_event_t)in[4];
+    if (record->event == REPLAY_COMMAND)
+    {
+        record->command.msg_type = (int8_t)in[5];
+        record->command.ch = (char)in[6];
+        record->command.direction = (direction_t)in[7];
+        memcpy(record->command.ticket, in + 8, 6);
+        record->command.ticket[6] = '\0';
+    }
+    else if (record->event == REPLAY_BULLET_EXPIRY)
+    {
+        record->is_horizontal = in[7];
+        record->x = in[14];
+        record->y = in[15];
+    }
+}
+
+/**
+ * Function: replay_log_write
+ * --------------------------
+ * Appends one record to a replay log.
+ *
+ * log: The log being written.
+ * record: The event to append.
+ *
+ * Records are buffered by stdio; they reach the disk when the buffer fills
+ * or when the log is closed.
+ */
+void replay_log_write(replay_log_t *log, const replay_record_t *record)
+{
+    uint8_t out[REPLAY_RECORD_SIZE];
+    replay_record_encode(record, out);
+    fwrite(out, sizeof(out), 1, log->file);
+    log->records++;
+}
+
+/**
+ * Function: replay_log_read
+ * -------------------------
+ * Reads the next record from a replay log.
+ *
+ * log: The log being read.
+ * record: Where the event is stored.
+ *
+ * Returns false at the end of the log.
+ */
+bool replay_log_read(replay_log_t *log, replay_record_t *record)
+{
+    uint8_t in[REPLAY_RECORD_SIZE];
+    if (fread(in, sizeof(in), 1, log->file) != 1)
+    {
+        return false;
+    }
+
+    replay_record_decode(in, record);
+    log->records++;
+    return true;
+}
+
+/**
+ * Function: replay_log_close
+ * --------------------------
+ * Flushes and closes a replay log and frees it.
+ *
+ * log: The log to close. NULL is ignored.
+ */
+void replay_log_close(replay_log_t *log)
+{
+    if (log == NULL)
+    {
+        return;
+    }
+    fclose(log->file);
+    free(log);
+}
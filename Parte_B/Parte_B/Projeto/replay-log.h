@@ -0,0 +1,81 @@
+#ifndef __REPLAY_LOG_H_INCLUDED__
+#define __REPLAY_LOG_H_INCLUDED__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include "remote-char.h"
+
+#define REPLAY_MAGIC "PSRP"
+#define REPLAY_VERSION 5 // 2: aliens spawned from free cells, 3: aliens moved from a grid copy, 4: 32-bit direction hash, 5: reseed events
+#define REPLAY_HEADER_SIZE 24
+#define REPLAY_RECORD_SIZE 16
+
+/**
+ * Enum: replay_event_t
+ * --------------------
+ * The kinds of events stored in a replay log.
+ *
+ * REPLAY_COMMAND: An accepted remote_char_t command from a client.
+ * REPLAY_ALIEN_TICK: One sweep of the alien thread (movement and respawn).
+ * REPLAY_BULLET_EXPIRY: A zap line being cleared from the board.
+ * REPLAY_RESEED: The random number generator seeded again from the seed and
+ *                the alien ticks of the match, when a standby is synced.
+ */
+typedef enum replay_event_t
+{
+    REPLAY_COMMAND = 0,
+    REPLAY_ALIEN_TICK = 1,
+    REPLAY_BULLET_EXPIRY = 2,
+    REPLAY_RESEED = 3
+} replay_event_t;
+
+/**
+ * Struct: replay_record_t
+ * -----------------------
+ * One event of a recorded match, in memory. On disk every record takes
+ * REPLAY_RECORD_SIZE bytes, little-endian.
+ *
+ * tick: Milliseconds since the start of the match.
+ * event: The kind of event (replay_event_t).
+ * command: The command, for REPLAY_COMMAND events.
+ * x, y, is_horizontal: The zap line, for REPLAY_BULLET_EXPIRY events.
+ */
+typedef struct replay_record_t
+{
+    uint32_t tick;
+    replay_event_t event;
+    remote_char_t command;
+    int x, y;
+    bool is_horizontal;
+} replay_record_t;
+
+/**
+ * Struct: replay_log_t
+ * --------------------
+ * An open replay log, either being written or being read.
+ *
+ * file: The underlying file.
+ * seed: The seed given to srand at the start of the match.
+ * initial_aliens: The number of aliens spawned at the start (0 for the default).
+ * start_ms: Game clock time of the start of the match, in milliseconds.
+ * records: Number of records written or read so far.
+ */
+typedef struct replay_log_t
+{
+    FILE *file;
+    uint32_t seed;
+    uint32_t initial_aliens;
+    int64_t start_ms;
+    uint64_t records;
+} replay_log_t;
+
+replay_log_t *replay_log_create(const char *path, uint32_t seed, uint32_t initial_aliens, int64_t start_ms);
+replay_log_t *replay_log_open(const char *path);
+void replay_record_encode(const replay_record_t *record, uint8_t *out);
+void replay_record_decode(const uint8_t *in, replay_record_t *record);
+void replay_log_write(replay_log_t *log, const replay_record_t *record);
+bool replay_log_read(replay_log_t *log, replay_record_t *record);
+void replay_log_close(replay_log_t *log);
+
+#endif // __REPLAY_LOG_H_INCLUDED__
@@ -0,0 +1,328 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "score-store.h"
+
+#define REBUILD_CHUNK_RECORDS 4096 // Records read at once when rebuilding the index
+
+/**
+ * Function: put_u32 / put_u64 / get_u32 / get_u64
+ * -----------------------------------------------
+ * Store and read back little-endian integers, so that the log can be moved
+ * between machines.
+ */
+static void put_u32(uint8_t *out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        out[i] = (value >> (8 * i)) & 0xff;
+    }
+}
+
+static void put_u64(uint8_t *out, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        out[i] = (value >> (8 * i)) & 0xff;
+    }
+}
+
+static uint32_t get_u32(const uint8_t *in)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        value |= (uint32_t)in[i] << (8 * i);
+    }
+    return value;
+}
+
+static uint64_t get_u64(const uint8_t *in)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        value |= (uint64_t)in[i] << (8 * i);
+    }
+    return value;
+}
+
+/**
+ * Function: index_add
+ * -------------------
+ * Adds a result to the index.
+ *
+ * index: The index.
+ * record: The result.
+ *
+ * The leaderboard is a sorted array of at most LEADERBOARD_SIZE entries, so a
+ * result is placed with a binary search and a move of the entries below it.
+ * Results that do not make it to the leaderboard only update the player.
+ */
+static void index_add(score_index_t *index, const score_record_t *record)
+{
+    player_stats_t *player = &index->players[record->ch & (SCORE_PLAYERS - 1)];
+    player->results++;
+    player->total += record->score;
+    player->last = record->score;
+    if (player->results == 1 || record->score > player->best)
+    {
+        player->best = record->score;
+    }
+
+    // First entry with a lower score; equal scores keep the earlier result first
+    int low = 0, high = (int)index->count;
+    while (low < high)
+    {
+        int middle = (low + high) / 2;
+        if (index->leaderboard[middle].score >= record->score)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if (low == LEADERBOARD_SIZE)
+    {
+        return;
+    }
+    int moved = (int)index->count - low - (index->count == LEADERBOARD_SIZE ? 1 : 0);
+    memmove(&index->leaderboard[low + 1], &index->leaderboard[low], moved * sizeof(score_record_t));
+    index->leaderboard[low] = *record;
+    if (index->count < LEADERBOARD_SIZE)
+    {
+        index->count++;
+    }
+}
+
+/**
+ * Function: decode_record
+ * -----------------------
+ * Reads a record stored by score_store_append.
+ */
+static void decode_record(const uint8_t *in, score_record_t *record)
+{
+    record->time_ms = (int64_t)get_u64(in);
+    record->ch = (int32_t)get_u32(in + 8);
+    record->score = (int32_t)get_u32(in + 12);
+}
+
+/**
+ * Function: rebuild_index
+ * -----------------------
+ * Builds the index again from every record of the log.
+ *
+ * store: The store, with the log open and the index mapped.
+ * records: The number of complete records in the log.
+ *
+ * Returns false if the log cannot be read.
+ */
+static bool rebuild_index(score_store_t *store, uint64_t records)
+{
+    score_index_t *index = store->index;
+    memset(index, 0, sizeof(score_index_t));
+    memcpy(index->magic, SCORE_INDEX_MAGIC, 4);
+    index->version = SCORE_STORE_VERSION;
+
+    static uint8_t chunk[REBUILD_CHUNK_RECORDS * SCORE_RECORD_SIZE];
+    uint64_t done = 0;
+    while (done < records)
+    {
+        uint64_t count = records - done < REBUILD_CHUNK_RECORDS ? records - done : REBUILD_CHUNK_RECORDS;
+        size_t bytes = count * SCORE_RECORD_SIZE;
+        if (pread(store->log_fd, chunk, bytes, SCORE_HEADER_SIZE + done * SCORE_RECORD_SIZE) != (ssize_t)bytes)
+        {
+            return false;
+        }
+        for (uint64_t i = 0; i < count; i++)
+        {
+            score_record_t record;
+            decode_record(chunk + i * SCORE_RECORD_SIZE, &record);
+            index_add(index, &record);
+        }
+        done += count;
+    }
+    index->log_records = records;
+    return true;
+}
+
+/**
+ * Function: open_log
+ * ------------------
+ * Opens the log for appending, creating it with its header if needed.
+ *
+ * path: The log file.
+ * records: Where the number of complete records is returned.
+ *
+ * A record cut short by a crash is removed. Returns the file descriptor, or
+ * -1 if the file cannot be opened or is not a log.
+ */
+static int open_log(const char *path, uint64_t *records)
+{
+    int fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    struct stat st;
+    fstat(fd, &st);
+
+    uint8_t header[SCORE_HEADER_SIZE] = {0};
+    if (st.st_size < SCORE_HEADER_SIZE)
+    {
+        memcpy(header, SCORE_LOG_MAGIC, 4);
+        put_u32(header + 4, SCORE_STORE_VERSION);
+        if (ftruncate(fd, 0) != 0 || write(fd, header, SCORE_HEADER_SIZE) != SCORE_HEADER_SIZE || fsync(fd) != 0)
+        {
+            close(fd);
+            return -1;
+        }
+        *records = 0;
+        return fd;
+    }
+
+    if (pread(fd, header, SCORE_HEADER_SIZE, 0) != SCORE_HEADER_SIZE || memcmp(header, SCORE_LOG_MAGIC, 4) != 0 ||
+        get_u32(header + 4) != SCORE_STORE_VERSION)
+    {
+        close(fd);
+        return -1;
+    }
+    *records = (st.st_size - SCORE_HEADER_SIZE) / SCORE_RECORD_SIZE;
+    off_t end = SCORE_HEADER_SIZE + *records * SCORE_RECORD_SIZE;
+    if (end != st.st_size && ftruncate(fd, end) != 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * Function: score_store_open
+ * --------------------------
+ * Opens the high-score store, creating its files if needed.
+ *
+ * log_path: The append-only log, the only durable copy of the results.
+ * index_path: The leaderboard index, mapped in memory.
+ *
+ * The index is rebuilt from the log if it is missing, from another version,
+ * out of step with the log, or was left open by a crash. Returns the store, or
+ * NULL with errno set if a file cannot be opened.
+ */
+score_store_t *score_store_open(const char *log_path, const char *index_path)
+{
+    score_store_t *store = calloc(1, sizeof(score_store_t));
+    uint64_t records;
+    store->log_fd = open_log(log_path, &records);
+    if (store->log_fd < 0)
+    {
+        free(store);
+        return NULL;
+    }
+
+    store->index_fd = open(index_path, O_RDWR | O_CREAT, 0644);
+    if (store->index_fd < 0 || ftruncate(store->index_fd, sizeof(score_index_t)) != 0)
+    {
+        close(store->log_fd);
+        free(store);
+        return NULL;
+    }
+    store->index = mmap(NULL, sizeof(score_index_t), PROT_READ | PROT_WRITE, MAP_SHARED, store->index_fd, 0);
+    if (store->index == MAP_FAILED)
+    {
+        close(store->index_fd);
+        close(store->log_fd);
+        free(store);
+        return NULL;
+    }
+
+    score_index_t *index = store->index;
+    if (memcmp(index->magic, SCORE_INDEX_MAGIC, 4) != 0 || index->version != SCORE_STORE_VERSION || index->open ||
+        index->log_records != records)
+    {
+        if (!rebuild_index(store, records))
+        {
+            score_store_close(store);
+            return NULL;
+        }
+    }
+    index->open = 1;
+    msync(index, sizeof(score_index_t), MS_SYNC);
+    return store;
+}
+
+/**
+ * Function: score_store_append
+ * ----------------------------
+ * Records the final score of a session.
+ *
+ * store: The store.
+ * ch: The character of the player.
+ * score: The score.
+ * time_ms: When the session ended, in milliseconds since the epoch.
+ *
+ * The record is on disk when this returns true; the index is updated in
+ * memory and written back by the kernel. Returns false if the log cannot be
+ * written, in which case the index is unchanged.
+ */
+bool score_store_append(score_store_t *store, int ch, int score, int64_t time_ms)
+{
+    uint8_t out[SCORE_RECORD_SIZE];
+    put_u64(out, (uint64_t)time_ms);
+    put_u32(out + 8, (uint32_t)ch);
+    put_u32(out + 12, (uint32_t)score);
+    if (write(store->log_fd, out, SCORE_RECORD_SIZE) != SCORE_RECORD_SIZE || fdatasync(store->log_fd) != 0)
+    {
+        return false;
+    }
+
+    score_record_t record = {time_ms, ch, score};
+    index_add(store->index, &record);
+    store->index->log_records++;
+    return true;
+}
+
+/**
+ * Function: score_store_top
+ * -------------------------
+ * Returns the best results.
+ *
+ * store: The store.
+ * k: How many results are wanted, at most LEADERBOARD_SIZE.
+ * records: Set to the results, best first, in the mapped index.
+ *
+ * Returns the number of results, which is less than k if fewer were recorded.
+ */
+int score_store_top(score_store_t *store, int k, const score_record_t **records)
+{
+    *records = store->index->leaderboard;
+    return k < (int)store->index->count ? k : (int)store->index->count;
+}
+
+/**
+ * Function: score_store_player
+ * ----------------------------
+ * Returns the statistics of a player character, in the mapped index.
+ */
+const player_stats_t *score_store_player(score_store_t *store, int ch)
+{
+    return &store->index->players[ch & (SCORE_PLAYERS - 1)];
+}
+
+/**
+ * Function: score_store_close
+ * ---------------------------
+ * Writes the index back, marks it closed and releases the store.
+ */
+void score_store_close(score_store_t *store)
+{
+    msync(store->index, sizeof(score_index_t), MS_SYNC);
+    store->index->open = 0; // Only once the rest is on disk
+    msync(store->index, sizeof(score_index_t), MS_SYNC);
+    munmap(store->index, sizeof(score_index_t));
+    close(store->index_fd);
+    close(store->log_fd);
+    free(store);
+}
@@ -0,0 +1,95 @@
+#ifndef __SCORE_STORE_H_INCLUDED__
+#define __SCORE_STORE_H_INCLUDED__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SCORE_LOG_MAGIC "PSHS"
+#define SCORE_INDEX_MAGIC "PSHI"
+#define SCORE_STORE_VERSION 1
+#define SCORE_HEADER_SIZE 16
+#define SCORE_RECORD_SIZE 16
+#define LEADERBOARD_SIZE 1024 // Best results kept sorted in the index
+#define SCORE_PLAYERS 256     // One entry per player character
+
+/**
+ * Struct: score_record_t
+ * ----------------------
+ * The final score of one player in one session. On disk every record takes
+ * SCORE_RECORD_SIZE bytes, little-endian.
+ *
+ * time_ms: Wall clock time the session ended, in milliseconds since the epoch.
+ * ch: The character of the player.
+ * score: The score.
+ */
+typedef struct score_record_t
+{
+    int64_t time_ms;
+    int32_t ch;
+    int32_t score;
+} score_record_t;
+
+/**
+ * Struct: player_stats_t
+ * ----------------------
+ * Everything the index keeps about one player character.
+ *
+ * results: Sessions recorded.
+ * total: Sum of their scores.
+ * best, last: Best and most recent score, 0 if there is none.
+ */
+typedef struct player_stats_t
+{
+    int64_t results;
+    int64_t total;
+    int32_t best;
+    int32_t last;
+} player_stats_t;
+
+/**
+ * Struct: score_index_t
+ * ---------------------
+ * The leaderboard index, a file mapped in memory.
+ *
+ * magic, version: SCORE_INDEX_MAGIC and SCORE_STORE_VERSION.
+ * open: 1 while a service has the index mapped. An index left open by a crash
+ *       may have lost pages, so it is rebuilt from the log.
+ * count: Entries used in leaderboard.
+ * log_records: Records of the log the index was built from.
+ * players: Statistics of every player, indexed by character.
+ * leaderboard: The best results, by decreasing score, the earliest first on ties.
+ */
+typedef struct score_index_t
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t open;
+    uint32_t count;
+    uint64_t log_records;
+    player_stats_t players[SCORE_PLAYERS];
+    score_record_t leaderboard[LEADERBOARD_SIZE];
+} score_index_t;
+
+/**
+ * Struct: score_store_t
+ * ---------------------
+ * An open high-score store: the append-only log and its index.
+ *
+ * log_fd: The log, opened for appending.
+ * index_fd: The index file.
+ * index: The index, mapped in memory.
+ */
+typedef struct score_store_t
+{
+    int log_fd;
+    int index_fd;
+    score_index_t *index;
+} score_store_t;
+
+score_store_t *score_store_open(const char *log_path, const char *index_path);
+bool score_store_append(score_store_t *store, int ch, int score, int64_t time_ms);
+int score_store_top(score_store_t *store, int k, const score_record_t **records);
+const player_stats_t *score_store_player(score_store_t *store, int ch);
+void score_store_close(score_store_t *store);
+
+#endif // __SCORE_STORE_H_INCLUDED__
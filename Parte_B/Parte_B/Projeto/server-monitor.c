@@ -0,0 +1,123 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include "server-monitor.h"
+
+static WINDOW *live_numbers, *live_score; // The windows of the game, written by the game threads
+static WINDOW *view_numbers, *view_score; // Their copies, drawn to the terminal by the monitor
+static pthread_mutex_t *game_lock;
+static int frame_us;
+
+static atomic_bool dirty = false;
+static atomic_bool monitor_running = false;
+static pthread_t monitor_thread;
+
+/**
+ * Function: monitor_touch
+ * -----------------------
+ * Tells the monitor that the board or the score changed.
+ *
+ * Called by the game code where it used to refresh a window. It costs one
+ * atomic store, so the game threads never wait for the terminal; without a
+ * monitor the flag is simply never read.
+ */
+void monitor_touch(void)
+{
+    atomic_store_explicit(&dirty, true, memory_order_relaxed);
+}
+
+/**
+ * Function: draw_frame
+ * --------------------
+ * Copies the game windows under the game lock and draws the copy.
+ *
+ * Only the copy, which takes microseconds, is done under the lock. The
+ * terminal output is done after releasing it, on windows the game threads
+ * never touch.
+ */
+static void draw_frame(void)
+{
+    pthread_mutex_lock(game_lock);
+    overwrite(live_numbers, view_numbers); // The board is a subwindow of numbers, so this copies it too
+    overwrite(live_score, view_score);
+    pthread_mutex_unlock(game_lock);
+
+    wnoutrefresh(view_numbers);
+    wnoutrefresh(view_score);
+    doupdate();
+}
+
+/**
+ * Function: run_monitor
+ * ---------------------
+ * Thread function of the monitor: draws a frame when something changed,
+ * at most once every frame_us microseconds.
+ *
+ * arg: Unused.
+ */
+static void *run_monitor(void *arg)
+{
+    (void)arg;
+    while (atomic_load(&monitor_running))
+    {
+        if (atomic_exchange_explicit(&dirty, false, memory_order_relaxed))
+        {
+            draw_frame();
+        }
+        usleep(frame_us);
+    }
+    return NULL;
+}
+
+/**
+ * Function: monitor_start
+ * -----------------------
+ * Starts the thread that draws the game to the terminal.
+ *
+ * numbers: The window with the board coordinates, the board is inside it.
+ * score_win: The window with the scores.
+ * lock: The lock the game threads hold while changing the windows.
+ * fps: The most frames drawn in a second.
+ *
+ * The windows must be those of the screen initialized by initscr. After this
+ * call, only the monitor writes to the terminal.
+ */
+void monitor_start(WINDOW *numbers, WINDOW *score_win, pthread_mutex_t *lock, int fps)
+{
+    live_numbers = numbers;
+    live_score = score_win;
+    game_lock = lock;
+    frame_us = 1000000 / fps;
+
+    view_numbers = newwin(getmaxy(numbers), getmaxx(numbers), getbegy(numbers), getbegx(numbers));
+    view_score = newwin(getmaxy(score_win), getmaxx(score_win), getbegy(score_win), getbegx(score_win));
+
+    atomic_store(&dirty, true); // Draw the first frame right away
+    atomic_store(&monitor_running, true);
+    if (pthread_create(&monitor_thread, NULL, run_monitor, NULL) != 0)
+    {
+        perror("Monitor thread creation failed");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * Function: monitor_stop
+ * ----------------------
+ * Stops the monitor thread after drawing the last state of the game. Does
+ * nothing if the monitor was not started.
+ */
+void monitor_stop(void)
+{
+    if (!atomic_load(&monitor_running))
+    {
+        return;
+    }
+    atomic_store(&monitor_running, false);
+    pthread_join(monitor_thread, NULL);
+    draw_frame();
+    delwin(view_numbers);
+    delwin(view_score);
+}
@@ -0,0 +1,14 @@
+#ifndef __SERVER_MONITOR_H_INCLUDED__
+#define __SERVER_MONITOR_H_INCLUDED__
+
+#include <ncurses.h>
+#include <pthread.h>
+
+#define MONITOR_DEFAULT_FPS 30 // Frames drawn per second at most by the terminal view
+#define MONITOR_MAX_FPS 1000
+
+void monitor_touch(void);
+void monitor_start(WINDOW *numbers, WINDOW *score_win, pthread_mutex_t *lock, int fps);
+void monitor_stop(void);
+
+#endif // __SERVER_MONITOR_H_INCLUDED__
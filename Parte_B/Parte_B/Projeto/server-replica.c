@@ -0,0 +1,235 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <zmq.h>
+#include "game-clock.h"
+#include "game-logic.h"
+#include "server-replica.h"
+
+static atomic_bool replica_running = false;
+static pthread_t replica_thread;
+
+/**
+ * Function: replica_send_event
+ * ----------------------------
+ * Sends an event applied to the match to the standby servers.
+ *
+ * replica: The replication socket.
+ * record: The event, as written to a replay log.
+ *
+ * Called by record_event, with the mutex held, so the standbys get the events
+ * in the order they were applied.
+ */
+void replica_send_event(void *replica, const replay_record_t *record)
+{
+    uint8_t message[1 + REPLAY_RECORD_SIZE];
+    message[0] = REPLICA_EVENT;
+    replay_record_encode(record, message + 1);
+    zmq_send(replica, message, sizeof(message), 0);
+}
+
+/**
+ * Function: send_snapshot
+ * -----------------------
+ * Sends the whole state of the match, for standbys that just subscribed.
+ *
+ * game: Pointer to the state of the match.
+ *
+ * The generator is seeded again right after, as a standby seeds it when it
+ * loads the snapshot. Must be called with the mutex held.
+ */
+static void send_snapshot(game_t *game)
+{
+    static checkpoint_t checkpoint;
+    static uint8_t message[1 + CHECKPOINT_SLOT_SIZE];
+    capture_checkpoint(game, &checkpoint);
+    checkpoint.sequence = 0;
+    message[0] = REPLICA_SNAPSHOT;
+    checkpoint_encode(&checkpoint, message + 1);
+    zmq_send(game->replica, message, sizeof(message), 0);
+    reseed_game(game);
+}
+
+/**
+ * Function: run_replica
+ * ---------------------
+ * Thread function that sends a heartbeat to the standbys every
+ * REPLICA_HEARTBEAT_MS, and a snapshot when a standby subscribes.
+ *
+ * arg: Pointer to the game_t of the match.
+ */
+static void *run_replica(void *arg)
+{
+    game_t *game = (game_t *)arg;
+    char heartbeat = REPLICA_HEARTBEAT;
+    uint8_t subscription[64];
+
+    while (atomic_load(&replica_running))
+    {
+        game_clock_sleep_ms(REPLICA_HEARTBEAT_MS);
+
+        pthread_mutex_lock(&mutex);
+        bool subscribed = false;
+        while (zmq_recv(game->replica, subscription, sizeof(subscription), ZMQ_DONTWAIT) > 0)
+        {
+            subscribed |= subscription[0] == 1;
+        }
+        if (subscribed)
+        {
+            send_snapshot(game);
+        }
+        zmq_send(game->replica, &heartbeat, 1, 0);
+        pthread_mutex_unlock(&mutex);
+    }
+    return NULL;
+}
+
+/**
+ * Function: replica_start
+ * -----------------------
+ * Replicates the match to standby servers.
+ *
+ * context: The ZeroMQ context of the server.
+ * endpoint: The endpoint the standbys connect to.
+ * game: Pointer to the state of the match.
+ *
+ * Every event applied to the match is sent on an XPUB socket. The socket
+ * never drops a message, as a standby that missed one would no longer have
+ * the same match; a standby that falls behind uses memory on the primary
+ * instead. Must be called before the game threads are started.
+ */
+void replica_start(void *context, const char *endpoint, game_t *game)
+{
+    void *replica = zmq_socket(context, ZMQ_XPUB);
+    int unlimited = 0, verbose = 1, linger = 1000;
+    zmq_setsockopt(replica, ZMQ_SNDHWM, &unlimited, sizeof(unlimited));
+    zmq_setsockopt(replica, ZMQ_XPUB_VERBOSE, &verbose, sizeof(verbose)); // Every standby subscribing gets a snapshot
+    zmq_setsockopt(replica, ZMQ_LINGER, &linger, sizeof(linger));
+    if (zmq_bind(replica, endpoint) != 0)
+    {
+        perror("Error binding the replication socket");
+        exit(1);
+    }
+
+    game->replica = replica;
+    atomic_store(&replica_running, true);
+    pthread_create(&replica_thread, NULL, run_replica, game);
+}
+
+/**
+ * Function: replica_stop
+ * ----------------------
+ * Tells the standbys that the match is over, so they do not take it over,
+ * and closes the replication socket. Does nothing if the match is not
+ * replicated.
+ *
+ * game: Pointer to the state of the match. Must be called without the mutex.
+ */
+void replica_stop(game_t *game)
+{
+    if (!atomic_load(&replica_running))
+    {
+        return;
+    }
+    atomic_store(&replica_running, false);
+    pthread_join(replica_thread, NULL);
+
+    pthread_mutex_lock(&mutex);
+    void *replica = game->replica;
+    game->replica = NULL;
+    pthread_mutex_unlock(&mutex);
+
+    char end = REPLICA_END;
+    zmq_send(replica, &end, 1, 0);
+    zmq_close(replica);
+}
+
+/**
+ * Function: follow_primary
+ * ------------------------
+ * Runs a standby server: keeps a copy of the match of the primary until the
+ * primary stops sending heartbeats.
+ *
+ * endpoint: The replication endpoint of the primary.
+ * takeover_ms: Silence of the primary, in milliseconds, after which the
+ *              standby takes over.
+ * checkpoint: Where the state of the match is returned at takeover.
+ *
+ * The copy starts from the snapshot sent by the primary when the standby
+ * subscribes, and every event after it is applied through apply_event, as in
+ * a replay, so the copy stays identical to the match of the primary. The
+ * standby waits as long as it takes for the first snapshot. Returns true at
+ * takeover, or false if the primary ended the match.
+ */
+bool follow_primary(const char *endpoint, int takeover_ms, checkpoint_t *checkpoint)
+{
+    void *context = zmq_ctx_new();
+    void *subscriber = zmq_socket(context, ZMQ_SUB);
+    zmq_setsockopt(subscriber, ZMQ_SUBSCRIBE, "", 0);
+    if (zmq_connect(subscriber, endpoint) != 0)
+    {
+        perror("Error connecting to the primary");
+        exit(1);
+    }
+
+    SCREEN *screen = open_headless_screen();
+    game_t game;
+    WINDOW *numbers = NULL;
+    bool synced = false, ended = false;
+    static uint8_t message[1 + CHECKPOINT_SLOT_SIZE];
+    zmq_pollitem_t item = {subscriber, 0, ZMQ_POLLIN, 0};
+    while (!ended)
+    {
+        int ready = zmq_poll(&item, 1, synced ? takeover_ms : -1);
+        if (ready == 0)
+        {
+            break; // The primary is silent
+        }
+        if (ready < 0)
+        {
+            continue; // Interrupted by a signal
+        }
+
+        int size = zmq_recv(subscriber, message, sizeof(message), 0);
+        if (size < 1)
+        {
+            continue;
+        }
+
+        if (message[0] == REPLICA_SNAPSHOT && size == (int)sizeof(message) && checkpoint_decode(message + 1, checkpoint))
+        {
+            if (!synced)
+            {
+                setup_game(&game, &numbers, NULL, checkpoint->seed, 0);
+                game.mode = GAME_REPLAY; // Zaps are removed by the events of the primary
+                synced = true;
+            }
+            restore_checkpoint(&game, checkpoint);
+        }
+        else if (message[0] == REPLICA_EVENT && size == 1 + REPLAY_RECORD_SIZE && synced)
+        {
+            replay_record_t record;
+            replay_record_decode(message + 1, &record);
+            apply_event(&game, &record);
+        }
+        else if (message[0] == REPLICA_END)
+        {
+            ended = true;
+        }
+    }
+
+    if (synced)
+    {
+        capture_checkpoint(&game, checkpoint);
+        delwin(game.board_win);
+        delwin(numbers);
+        delwin(game.score_win);
+    }
+    endwin();
+    delscreen(screen);
+    zmq_close(subscriber);
+    zmq_ctx_destroy(context);
+    return synced && !ended;
+}
@@ -0,0 +1,25 @@
+#ifndef __SERVER_REPLICA_H_INCLUDED__
+#define __SERVER_REPLICA_H_INCLUDED__
+
+#include <stdbool.h>
+#include "replay-log.h"
+#include "game-checkpoint.h"
+
+#define REPLICA_ENDPOINT "ipc:///tmp/s1-replica"
+#define REPLICA_HEARTBEAT_MS 100          // Time between two heartbeats of the primary
+#define REPLICA_DEFAULT_TAKEOVER_MS 1000  // Silence of the primary after which a standby takes over
+
+// Kinds of replication messages, by their first byte
+#define REPLICA_SNAPSHOT 'S'  // Followed by a checkpoint slot
+#define REPLICA_EVENT 'E'     // Followed by a replay record
+#define REPLICA_HEARTBEAT 'H'
+#define REPLICA_END 'X'       // The match is over
+
+struct game_t;
+
+void replica_start(void *context, const char *endpoint, struct game_t *game);
+void replica_send_event(void *replica, const replay_record_t *record);
+void replica_stop(struct game_t *game);
+bool follow_primary(const char *endpoint, int takeover_ms, checkpoint_t *checkpoint);
+
+#endif // __SERVER_REPLICA_H_INCLUDED__
@@ -0,0 +1,301 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <ncurses.h>
+#include <zmq.h>
+#include "common.h"
+#include "server-stats.h"
+
+#define STATS_POLL_MS 200 // How often the stats thread checks if it must stop
+
+/**
+ * Struct: histogram_t
+ * -------------------
+ * A log-linear histogram, in the style of HdrHistogram, that can be recorded
+ * from any thread without a lock.
+ *
+ * counts: Number of values in each bucket.
+ * total, sum: Number and sum of the recorded values.
+ * min, max: Smallest and largest recorded values.
+ */
+typedef struct histogram_t
+{
+    _Atomic uint64_t counts[HISTOGRAM_BUCKETS];
+    _Atomic uint64_t total;
+    _Atomic uint64_t sum;
+    _Atomic uint64_t min;
+    _Atomic uint64_t max;
+} histogram_t;
+
+static const char *counter_names[STAT_COUNTERS] = {
+    "commands_join", "commands_move", "commands_fire", "commands_leave", "commands_unknown",
+    "tickets_rejected", "full_rejected", "frames_published", "bytes_published",
+    "aliens_spawned", "aliens_killed", "keyframes_published", "frame_subscriptions",
+    "keyframe_subscriptions", "unsubscriptions", "command_batches",
+    "moves_limited", "fires_limited", "heartbeats", "sessions_evicted", "commands_resent"};
+
+static const char *histogram_names[STAT_HISTOGRAMS] = {
+    "command_ns", "tick_ns", "publish_ns", "queue_wait_ns"};
+
+static _Atomic uint64_t counters[STAT_COUNTERS];
+static histogram_t histograms[STAT_HISTOGRAMS];
+static uint64_t started_ns;
+
+static pthread_t stats_thread;
+static void *stats_socket = NULL;
+static atomic_bool stats_running = false;
+
+/**
+ * Function: stats_now_ns
+ * ----------------------
+ * Returns a monotonic timestamp in nanoseconds, for timing server operations.
+ *
+ * The wall clock is used even when the game clock is virtual: the histograms
+ * measure the work done by the server, not game time.
+ */
+uint64_t stats_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * Function: stats_count
+ * ---------------------
+ * Adds to one of the server counters.
+ *
+ * counter: The counter.
+ * amount: The amount to add.
+ */
+void stats_count(stat_counter_t counter, uint64_t amount)
+{
+    atomic_fetch_add_explicit(&counters[counter], amount, memory_order_relaxed);
+}
+
+/**
+ * Function: bucket_index
+ * ----------------------
+ * Returns the histogram bucket a value falls in.
+ */
+static int bucket_index(uint64_t value)
+{
+    if (value < (1 << HISTOGRAM_SUB_BITS))
+    {
+        return (int)value;
+    }
+    int magnitude = 63 - __builtin_clzll(value);
+    int shift = magnitude - (HISTOGRAM_SUB_BITS - 1);
+    int sub = (int)(value >> shift) - (1 << (HISTOGRAM_SUB_BITS - 1));
+    return (1 << HISTOGRAM_SUB_BITS) + (magnitude - HISTOGRAM_SUB_BITS) * (1 << (HISTOGRAM_SUB_BITS - 1)) + sub;
+}
+
+/**
+ * Function: bucket_upper
+ * ----------------------
+ * Returns the largest value that falls in a histogram bucket.
+ */
+static uint64_t bucket_upper(int index)
+{
+    if (index < (1 << HISTOGRAM_SUB_BITS))
+    {
+        return (uint64_t)index;
+    }
+    int offset = index - (1 << HISTOGRAM_SUB_BITS);
+    int magnitude = offset / (1 << (HISTOGRAM_SUB_BITS - 1)) + HISTOGRAM_SUB_BITS;
+    uint64_t sub = offset % (1 << (HISTOGRAM_SUB_BITS - 1)) + (1 << (HISTOGRAM_SUB_BITS - 1));
+    int shift = magnitude - (HISTOGRAM_SUB_BITS - 1);
+    return ((sub + 1) << shift) - 1;
+}
+
+/**
+ * Function: stats_record
+ * ----------------------
+ * Records a value in one of the server histograms.
+ *
+ * histogram: The histogram.
+ * value: The value, in nanoseconds.
+ */
+void stats_record(stat_histogram_t histogram, uint64_t value)
+{
+    histogram_t *h = &histograms[histogram];
+
+    atomic_fetch_add_explicit(&h->counts[bucket_index(value)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->sum, value, memory_order_relaxed);
+
+    // The first value sets the minimum, as min starts at 0
+    uint64_t min = atomic_load_explicit(&h->min, memory_order_relaxed);
+    while ((min == 0 || value < min) &&
+           !atomic_compare_exchange_weak_explicit(&h->min, &min, value, memory_order_relaxed, memory_order_relaxed))
+        ;
+    uint64_t max = atomic_load_explicit(&h->max, memory_order_relaxed);
+    while (value > max &&
+           !atomic_compare_exchange_weak_explicit(&h->max, &max, value, memory_order_relaxed, memory_order_relaxed))
+        ;
+    atomic_fetch_add_explicit(&h->total, 1, memory_order_relaxed);
+}
+
+/**
+ * Function: percentile
+ * --------------------
+ * Returns the upper bound of the bucket holding a given percentile, or the
+ * largest recorded value if it is smaller.
+ *
+ * counts: A copy of the bucket counts.
+ * total: The sum of counts.
+ * max: The largest recorded value.
+ * p: The percentile, between 0 and 100.
+ */
+static uint64_t percentile(const uint64_t counts[], uint64_t total, uint64_t max, double p)
+{
+    uint64_t rank = (uint64_t)(total * p / 100.0 + 0.5);
+    if (rank < 1)
+        rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        seen += counts[i];
+        if (seen >= rank)
+        {
+            return bucket_upper(i) < max ? bucket_upper(i) : max;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Function: stats_snapshot
+ * ------------------------
+ * Builds a JSON document with the current value of every counter and histogram.
+ *
+ * Each histogram reports its count, min, mean, percentiles and max, and the
+ * non-empty buckets as [upper bound, count] pairs so that snapshots can be
+ * merged or diffed. Values recorded while the snapshot is taken may be missing
+ * from some fields. Returns a string that the caller must free.
+ */
+char *stats_snapshot(void)
+{
+    char *json = NULL;
+    size_t size = 0;
+    FILE *out = open_memstream(&json, &size);
+
+    fprintf(out, "{\"uptime_ms\": %llu, \"counters\": {", (unsigned long long)((stats_now_ns() - started_ns) / 1000000));
+    for (int i = 0; i < STAT_COUNTERS; i++)
+    {
+        fprintf(out, "%s\"%s\": %llu", i ? ", " : "", counter_names[i],
+                (unsigned long long)atomic_load_explicit(&counters[i], memory_order_relaxed));
+    }
+    fprintf(out, "}, \"histograms\": {");
+
+    static uint64_t counts[HISTOGRAM_BUCKETS];
+    for (int i = 0; i < STAT_HISTOGRAMS; i++)
+    {
+        histogram_t *h = &histograms[i];
+        uint64_t total = 0;
+        for (int b = 0; b < HISTOGRAM_BUCKETS; b++)
+        {
+            counts[b] = atomic_load_explicit(&h->counts[b], memory_order_relaxed);
+            total += counts[b];
+        }
+        uint64_t sum = atomic_load_explicit(&h->sum, memory_order_relaxed);
+        uint64_t max = atomic_load_explicit(&h->max, memory_order_relaxed);
+
+        fprintf(out, "%s\"%s\": {\"count\": %llu, \"min\": %llu, \"mean\": %llu, \"p50\": %llu, \"p90\": %llu, "
+                     "\"p99\": %llu, \"p999\": %llu, \"max\": %llu, \"buckets\": [",
+                i ? ", " : "", histogram_names[i], (unsigned long long)total,
+                (unsigned long long)atomic_load_explicit(&h->min, memory_order_relaxed),
+                (unsigned long long)(total ? sum / total : 0),
+                (unsigned long long)percentile(counts, total, max, 50),
+                (unsigned long long)percentile(counts, total, max, 90),
+                (unsigned long long)percentile(counts, total, max, 99),
+                (unsigned long long)percentile(counts, total, max, 99.9),
+                (unsigned long long)max);
+        bool first = true;
+        for (int b = 0; b < HISTOGRAM_BUCKETS; b++)
+        {
+            if (counts[b] != 0)
+            {
+                fprintf(out, "%s[%llu, %llu]", first ? "" : ", ", (unsigned long long)bucket_upper(b), (unsigned long long)counts[b]);
+                first = false;
+            }
+        }
+        fprintf(out, "]}");
+    }
+    fprintf(out, "}}");
+    fclose(out);
+    return json;
+}
+
+/**
+ * Function: serve_stats
+ * ---------------------
+ * Thread function that answers every request on the stats socket with a snapshot.
+ *
+ * arg: Unused.
+ *
+ * The content of the request is ignored. The socket is polled with a timeout
+ * so that stats_stop does not wait for a request to arrive.
+ */
+static void *serve_stats(void *arg)
+{
+    (void)arg;
+    char request[64];
+
+    while (atomic_load(&stats_running))
+    {
+        if (zmq_recv(stats_socket, request, sizeof(request), 0) < 0)
+        {
+            continue; // Timeout: check if the server is stopping
+        }
+        char *json = stats_snapshot();
+        zmq_send(stats_socket, json, strlen(json), 0);
+        free(json);
+    }
+    return NULL;
+}
+
+/**
+ * Function: stats_start
+ * ---------------------
+ * Binds the stats socket and starts the thread that serves it.
+ *
+ * context: The ZeroMQ context of the server.
+ * endpoint: The endpoint to bind the REP socket to.
+ *
+ * Any client can connect a REQ socket to the endpoint and send an empty
+ * request to get a JSON snapshot of the counters and histograms.
+ */
+void stats_start(void *context, const char *endpoint)
+{
+    started_ns = stats_now_ns();
+    stats_socket = initialize_zmq_socket(&context, ZMQ_REP, endpoint, true);
+    int timeout = STATS_POLL_MS;
+    zmq_setsockopt(stats_socket, ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
+
+    atomic_store(&stats_running, true);
+    if (pthread_create(&stats_thread, NULL, serve_stats, NULL) != 0)
+    {
+        perror("Stats thread creation failed");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * Function: stats_stop
+ * --------------------
+ * Stops the stats thread and closes its socket, so the context can be destroyed.
+ */
+void stats_stop(void)
+{
+    if (stats_socket == NULL)
+    {
+        return;
+    }
+    atomic_store(&stats_running, false);
+    pthread_join(stats_thread, NULL);
+    zmq_close(stats_socket);
+    stats_socket = NULL;
+}
@@ -0,0 +1,94 @@
+#ifndef __SERVER_STATS_H_INCLUDED__
+#define __SERVER_STATS_H_INCLUDED__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define STATS_ENDPOINT "ipc:///tmp/s1-stats"
+
+// Histogram buckets: values below 2^HISTOGRAM_SUB_BITS are exact, larger values
+// fall in one of 2^(HISTOGRAM_SUB_BITS-1) buckets per power of two (about 3% error)
+#define HISTOGRAM_SUB_BITS 5
+#define HISTOGRAM_BUCKETS ((1 << HISTOGRAM_SUB_BITS) + (64 - HISTOGRAM_SUB_BITS) * (1 << (HISTOGRAM_SUB_BITS - 1)))
+
+/**
+ * Enum: stat_counter_t
+ * --------------------
+ * The counters kept by the server.
+ *
+ * STAT_COMMANDS_JOIN .. STAT_COMMANDS_LEAVE: Commands received, by msg_type.
+ * STAT_COMMANDS_UNKNOWN: Commands with an unknown msg_type.
+ * STAT_TICKETS_REJECTED: Commands dropped because of an invalid ticket.
+ * STAT_FULL_REJECTED: Joins answered with "FULL".
+ * STAT_FRAMES_PUBLISHED: Board and score frames sent to the subscribers.
+ * STAT_BYTES_PUBLISHED: Bytes sent to the subscribers, frames and scores.
+ * STAT_ALIENS_SPAWNED: Aliens placed on the board, at the start and by respawns.
+ * STAT_ALIENS_KILLED: Aliens hit by a zap.
+ * STAT_KEYFRAMES_PUBLISHED: Frames also sent on the keyframe stream.
+ * STAT_FRAME_SUBSCRIPTIONS: Subscribers that joined the stream of every frame.
+ * STAT_KEYFRAME_SUBSCRIPTIONS: Subscribers that joined the keyframe stream,
+ *                              mostly demoted after losing frames.
+ * STAT_UNSUBSCRIPTIONS: Subscriptions cancelled, by demotion or disconnection.
+ * STAT_COMMAND_BATCHES: Batches of commands applied with one publish; the
+ *                       commands over this is the average batch size.
+ * STAT_MOVES_LIMITED, STAT_FIRES_LIMITED: Moves and shots dropped because
+ *                                        the player went over its budget.
+ * STAT_HEARTBEATS: Heartbeats of players with nothing else to send.
+ * STAT_SESSIONS_EVICTED: Players removed after the idle timeout, as if they left.
+ * STAT_COMMANDS_RESENT: Copies of requests already applied, answered but not
+ *                       applied again.
+ */
+typedef enum stat_counter_t
+{
+    STAT_COMMANDS_JOIN,
+    STAT_COMMANDS_MOVE,
+    STAT_COMMANDS_FIRE,
+    STAT_COMMANDS_LEAVE,
+    STAT_COMMANDS_UNKNOWN,
+    STAT_TICKETS_REJECTED,
+    STAT_FULL_REJECTED,
+    STAT_FRAMES_PUBLISHED,
+    STAT_BYTES_PUBLISHED,
+    STAT_ALIENS_SPAWNED,
+    STAT_ALIENS_KILLED,
+    STAT_KEYFRAMES_PUBLISHED,
+    STAT_FRAME_SUBSCRIPTIONS,
+    STAT_KEYFRAME_SUBSCRIPTIONS,
+    STAT_UNSUBSCRIPTIONS,
+    STAT_COMMAND_BATCHES,
+    STAT_MOVES_LIMITED,
+    STAT_FIRES_LIMITED,
+    STAT_HEARTBEATS,
+    STAT_SESSIONS_EVICTED,
+    STAT_COMMANDS_RESENT,
+    STAT_COUNTERS
+} stat_counter_t;
+
+/**
+ * Enum: stat_histogram_t
+ * ----------------------
+ * The latency histograms kept by the server, all in nanoseconds.
+ *
+ * STAT_COMMAND_NS: Time spent handling a command, from applying it to the reply.
+ * STAT_TICK_NS: Time spent on one alien tick, including its publish.
+ * STAT_PUBLISH_NS: Time spent serializing and sending one frame.
+ * STAT_QUEUE_WAIT_NS: Time a received command waits for the game lock, with
+ *                     the rest of its batch.
+ */
+typedef enum stat_histogram_t
+{
+    STAT_COMMAND_NS,
+    STAT_TICK_NS,
+    STAT_PUBLISH_NS,
+    STAT_QUEUE_WAIT_NS,
+    STAT_HISTOGRAMS
+} stat_histogram_t;
+
+uint64_t stats_now_ns(void);
+void stats_count(stat_counter_t counter, uint64_t amount);
+void stats_record(stat_histogram_t histogram, uint64_t value);
+char *stats_snapshot(void);
+void stats_start(void *context, const char *endpoint);
+void stats_stop(void);
+
+#endif // __SERVER_STATS_H_INCLUDED__
@@ -0,0 +1,35 @@
+import json
+import sys
+import zmq
+
+# Usage: python3 server-stats.py [--json] [--stats ENDPOINT]
+# Asks the server for a snapshot of its counters and latency histograms
+endpoint = sys.argv[sys.argv.index("--stats") + 1] if "--stats" in sys.argv else "ipc:///tmp/s1-stats"
+
+context = zmq.Context()
+socket = context.socket(zmq.REQ)
+socket.setsockopt(zmq.RCVTIMEO, 2000)  # Do not wait forever if the server is down
+socket.setsockopt(zmq.LINGER, 0)
+socket.connect(endpoint)
+
+socket.send(b"")
+try:
+    snapshot = json.loads(socket.recv())
+except zmq.Again:
+    print("The server did not answer on " + endpoint)
+    sys.exit(1)
+
+if "--json" in sys.argv:
+    print(json.dumps(snapshot, indent=2))
+    sys.exit(0)
+
+print("Uptime: {:.1f} s".format(snapshot["uptime_ms"] / 1000))
+print()
+for name, value in snapshot["counters"].items():
+    print("{:<20} {:>12}".format(name, value))
+print()
+print("{:<16} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10}".format("histogram (us)", "count", "p50", "p90", "p99", "p999", "max"))
+for name, h in snapshot["histograms"].items():
+    print("{:<16} {:>10} {:>10.1f} {:>10.1f} {:>10.1f} {:>10.1f} {:>10.1f}".format(
+        name.replace("_ns", ""), h["count"], h["p50"] / 1000, h["p90"] / 1000,
+        h["p99"] / 1000, h["p999"] / 1000, h["max"] / 1000))
@@ -0,0 +1,359 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/syscall.h>
+#include "server-trace.h"
+
+#define TRACE_CHUNK_EVENTS 4096 // Events in one buffer
+#define TRACE_MAX_CHUNKS 256    // Buffers allocated at most; later events are dropped
+#define TRACE_MAX_THREADS 64    // Thread names kept
+
+/**
+ * Struct: trace_event_t
+ * ---------------------
+ * The beginning or the end of a span.
+ *
+ * ts_ns: Monotonic time of the event, in nanoseconds.
+ * name: The span, a string literal.
+ * tid: The kernel id of the thread.
+ * phase: 'B' for begin, 'E' for end.
+ */
+typedef struct trace_event_t
+{
+    uint64_t ts_ns;
+    const char *name;
+    int tid;
+    char phase;
+} trace_event_t;
+
+/**
+ * Struct: trace_chunk_t
+ * ---------------------
+ * A buffer of events, written by a single thread at a time.
+ *
+ * events, count: The events recorded so far. count is published with release
+ *                order, so trace_write can read a buffer while it is written.
+ * next: The next buffer in the list of all buffers.
+ * next_free: The next buffer in the list of released buffers.
+ */
+typedef struct trace_chunk_t
+{
+    trace_event_t events[TRACE_CHUNK_EVENTS];
+    atomic_int count;
+    struct trace_chunk_t *next;
+    struct trace_chunk_t *next_free;
+} trace_chunk_t;
+
+bool trace_enabled = false;
+
+static const char *trace_path;
+static uint64_t trace_start_ns;
+
+// Protects the lists of buffers and the thread names
+static pthread_mutex_t chunks_mutex = PTHREAD_MUTEX_INITIALIZER;
+static trace_chunk_t *chunks = NULL;
+static trace_chunk_t *released = NULL;
+static int chunk_count = 0;
+static atomic_ulong dropped_events;
+
+static struct
+{
+    int tid;
+    const char *name;
+} thread_names[TRACE_MAX_THREADS];
+static int thread_name_count = 0;
+
+// Serializes writes of the trace file
+static pthread_mutex_t write_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static __thread trace_chunk_t *thread_chunk = NULL;
+static __thread int thread_id = 0;
+static pthread_key_t release_key;
+
+/**
+ * Function: now_ns
+ * ----------------
+ * Returns a monotonic timestamp in nanoseconds.
+ */
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * Function: current_tid
+ * ---------------------
+ * Returns the kernel id of the calling thread, the id shown by trace viewers.
+ */
+static int current_tid(void)
+{
+    if (thread_id == 0)
+    {
+        thread_id = (int)syscall(SYS_gettid);
+    }
+    return thread_id;
+}
+
+/**
+ * Function: release_chunk
+ * -----------------------
+ * Called when a thread exits, to hand its buffer over to the next new thread.
+ *
+ * arg: The buffer of the thread.
+ *
+ * A zap thread records only a few events, so its buffer is reused instead of
+ * allocating one for every zap.
+ */
+static void release_chunk(void *arg)
+{
+    trace_chunk_t *chunk = arg;
+    pthread_mutex_lock(&chunks_mutex);
+    chunk->next_free = released;
+    released = chunk;
+    pthread_mutex_unlock(&chunks_mutex);
+}
+
+/**
+ * Function: acquire_chunk
+ * -----------------------
+ * Gives the calling thread a buffer with free space.
+ *
+ * Returns the buffer, or NULL if the limit of TRACE_MAX_CHUNKS is reached.
+ */
+static trace_chunk_t *acquire_chunk(void)
+{
+    trace_chunk_t *chunk = NULL;
+
+    pthread_mutex_lock(&chunks_mutex);
+    while (released != NULL && chunk == NULL)
+    {
+        chunk = released;
+        released = chunk->next_free;
+        if (atomic_load_explicit(&chunk->count, memory_order_relaxed) == TRACE_CHUNK_EVENTS)
+        {
+            chunk = NULL; // Full; it stays in the list of all buffers
+        }
+    }
+    if (chunk == NULL && chunk_count < TRACE_MAX_CHUNKS)
+    {
+        chunk = calloc(1, sizeof(trace_chunk_t));
+        chunk->next = chunks;
+        chunks = chunk;
+        chunk_count++;
+    }
+    pthread_mutex_unlock(&chunks_mutex);
+
+    pthread_setspecific(release_key, chunk);
+    return chunk;
+}
+
+/**
+ * Function: trace_add
+ * -------------------
+ * Appends an event to the buffer of the calling thread.
+ *
+ * name: The span.
+ * phase: 'B' or 'E'.
+ */
+static void trace_add(const char *name, char phase)
+{
+    trace_chunk_t *chunk = thread_chunk;
+    if (chunk == NULL || atomic_load_explicit(&chunk->count, memory_order_relaxed) == TRACE_CHUNK_EVENTS)
+    {
+        chunk = thread_chunk = acquire_chunk();
+        if (chunk == NULL)
+        {
+            atomic_fetch_add_explicit(&dropped_events, 1, memory_order_relaxed);
+            return;
+        }
+    }
+
+    int n = atomic_load_explicit(&chunk->count, memory_order_relaxed);
+    chunk->events[n] = (trace_event_t){now_ns(), name, current_tid(), phase};
+    atomic_store_explicit(&chunk->count, n + 1, memory_order_release);
+}
+
+/**
+ * Function: trace_begin / trace_end
+ * ---------------------------------
+ * Mark the beginning and the end of a span on the calling thread.
+ *
+ * name: The span, a string literal. Spans of a thread must nest.
+ *
+ * Cost a branch when tracing is off.
+ */
+void trace_begin(const char *name)
+{
+    if (trace_enabled)
+    {
+        trace_add(name, 'B');
+    }
+}
+
+void trace_end(const char *name)
+{
+    if (trace_enabled)
+    {
+        trace_add(name, 'E');
+    }
+}
+
+/**
+ * Function: trace_thread_name
+ * ---------------------------
+ * Names the calling thread in the trace.
+ *
+ * name: The name, a string literal.
+ */
+void trace_thread_name(const char *name)
+{
+    if (!trace_enabled)
+    {
+        return;
+    }
+    int tid = current_tid();
+    pthread_mutex_lock(&chunks_mutex);
+    if (thread_name_count < TRACE_MAX_THREADS)
+    {
+        thread_names[thread_name_count].tid = tid;
+        thread_names[thread_name_count].name = name;
+        thread_name_count++;
+    }
+    pthread_mutex_unlock(&chunks_mutex);
+}
+
+/**
+ * Function: trace_write
+ * ---------------------
+ * Writes every event recorded so far to the trace file, in the Chrome trace
+ * event format (chrome://tracing, Perfetto).
+ *
+ * Threads keep recording while the file is written; their newest events are
+ * in the next dump. The file is replaced atomically.
+ */
+void trace_write(void)
+{
+    if (!trace_enabled)
+    {
+        return;
+    }
+    pthread_mutex_lock(&write_mutex);
+
+    char tmp_path[4096];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", trace_path);
+    FILE *out = fopen(tmp_path, "w");
+    if (out == NULL)
+    {
+        perror("Error writing trace");
+        pthread_mutex_unlock(&write_mutex);
+        return;
+    }
+
+    int pid = (int)getpid();
+    fprintf(out, "{\"displayTimeUnit\": \"ns\", \"otherData\": {\"dropped_events\": %lu}, \"traceEvents\": [\n",
+            atomic_load(&dropped_events));
+    fprintf(out, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"args\": {\"name\": \"game-server\"}}", pid);
+
+    pthread_mutex_lock(&chunks_mutex);
+    trace_chunk_t *head = chunks;
+    for (int i = 0; i < thread_name_count; i++)
+    {
+        fprintf(out, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+                pid, thread_names[i].tid, thread_names[i].name);
+    }
+    pthread_mutex_unlock(&chunks_mutex);
+
+    // Buffers are never freed, so the list can be walked without the lock
+    for (trace_chunk_t *chunk = head; chunk != NULL; chunk = chunk->next)
+    {
+        int count = atomic_load_explicit(&chunk->count, memory_order_acquire);
+        for (int i = 0; i < count; i++)
+        {
+            trace_event_t *event = &chunk->events[i];
+            uint64_t ts_ns = event->ts_ns - trace_start_ns;
+            fprintf(out, ",\n{\"name\": \"%s\", \"ph\": \"%c\", \"ts\": %llu.%03llu, \"pid\": %d, \"tid\": %d}",
+                    event->name, event->phase, (unsigned long long)(ts_ns / 1000), (unsigned long long)(ts_ns % 1000),
+                    pid, event->tid);
+        }
+    }
+    fprintf(out, "\n]}\n");
+    fclose(out);
+
+    if (rename(tmp_path, trace_path) != 0)
+    {
+        perror("Error writing trace");
+    }
+    pthread_mutex_unlock(&write_mutex);
+}
+
+/**
+ * Function: handle_signals
+ * ------------------------
+ * Thread function that writes the trace when the server gets a signal.
+ *
+ * arg: The set of signals to wait for.
+ *
+ * SIGUSR1 writes the trace and the server goes on. SIGINT and SIGTERM write
+ * it and then take their usual course, so ncurses still restores the terminal.
+ */
+static void *handle_signals(void *arg)
+{
+    sigset_t *signals = arg;
+    int sig;
+
+    while (sigwait(signals, &sig) == 0)
+    {
+        trace_write();
+        if (sig != SIGUSR1)
+        {
+            sigset_t one;
+            sigemptyset(&one);
+            sigaddset(&one, sig);
+            pthread_sigmask(SIG_UNBLOCK, &one, NULL);
+            raise(sig);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Function: trace_start
+ * ---------------------
+ * Turns tracing on.
+ *
+ * path: The file the trace is written to by trace_write.
+ *
+ * Must be called before any other thread is started, ZeroMQ's included: it
+ * blocks SIGUSR1, SIGINT and SIGTERM so that only the signal thread gets them.
+ */
+void trace_start(const char *path)
+{
+    static sigset_t signals;
+
+    trace_path = path;
+    trace_start_ns = now_ns();
+    pthread_key_create(&release_key, release_chunk);
+    trace_enabled = true;
+
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR1);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    pthread_t signal_thread;
+    if (pthread_create(&signal_thread, NULL, handle_signals, &signals) != 0)
+    {
+        perror("Trace thread creation failed");
+        exit(EXIT_FAILURE);
+    }
+    pthread_detach(signal_thread);
+}
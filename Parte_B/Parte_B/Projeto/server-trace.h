@@ -0,0 +1,15 @@
+#ifndef __SERVER_TRACE_H_INCLUDED__
+#define __SERVER_TRACE_H_INCLUDED__
+
+#include <stdbool.h>
+
+// Set by trace_start; the trace functions do nothing while it is false
+extern bool trace_enabled;
+
+void trace_start(const char *path);
+void trace_thread_name(const char *name);
+void trace_begin(const char *name);
+void trace_end(const char *name);
+void trace_write(void);
+
+#endif // __SERVER_TRACE_H_INCLUDED__
@@ -0,0 +1,99 @@
+#include <string.h>
+#include "session-timers.h"
+
+/**
+ * Function: sessions_init
+ * -----------------------
+ * Prepares the idle timers of a match, with none armed.
+ *
+ * sessions: The timers.
+ * timeout_ms: Silence after which a player is evicted; 0 to never evict.
+ */
+void sessions_init(session_timers_t *sessions, uint32_t timeout_ms)
+{
+    memset(sessions, 0, sizeof(*sessions));
+    sessions->timeout_ms = timeout_ms;
+}
+
+/**
+ * Function: sessions_touch
+ * ------------------------
+ * Arms the timer of a player, or pushes it back, after a command of the player.
+ *
+ * sessions: The timers.
+ * ch: The character of the player.
+ * now_ms: Game time, in milliseconds since the start.
+ */
+void sessions_touch(session_timers_t *sessions, char ch, uint32_t now_ms)
+{
+    int slot = ch - 'A';
+    if (sessions->timeout_ms == 0 || slot < 0 || slot >= MAX_CLIENTS)
+    {
+        return;
+    }
+    sessions->armed[slot] = true;
+    sessions->deadline_ms[slot] = now_ms + sessions->timeout_ms;
+}
+
+/**
+ * Function: sessions_forget
+ * -------------------------
+ * Disarms the timer of a player who left or was evicted.
+ *
+ * sessions: The timers.
+ * ch: The character of the player.
+ */
+void sessions_forget(session_timers_t *sessions, char ch)
+{
+    int slot = ch - 'A';
+    if (slot >= 0 && slot < MAX_CLIENTS)
+    {
+        sessions->armed[slot] = false;
+    }
+}
+
+/**
+ * Function: sessions_wait_ms
+ * --------------------------
+ * Returns how long the players may be waited for before the first of them is
+ * due to be evicted, in milliseconds, or -1 if no timer is armed.
+ *
+ * sessions: The timers.
+ * now_ms: Game time, in milliseconds since the start.
+ */
+int sessions_wait_ms(session_timers_t *sessions, uint32_t now_ms)
+{
+    int wait = -1;
+    for (int slot = 0; slot < MAX_CLIENTS; slot++)
+    {
+        if (sessions->armed[slot])
+        {
+            int32_t left = (int32_t)(sessions->deadline_ms[slot] - now_ms);
+            left = left > 0 ? left : 0;
+            wait = wait < 0 || left < wait ? left : wait;
+        }
+    }
+    return wait;
+}
+
+/**
+ * Function: sessions_expired
+ * --------------------------
+ * Returns the character of a player past its deadline, or '\0' if there is none.
+ *
+ * sessions: The timers.
+ * now_ms: Game time, in milliseconds since the start.
+ *
+ * The timer stays armed; the caller forgets it once the player is evicted.
+ */
+char sessions_expired(session_timers_t *sessions, uint32_t now_ms)
+{
+    for (int slot = 0; slot < MAX_CLIENTS; slot++)
+    {
+        if (sessions->armed[slot] && (int32_t)(sessions->deadline_ms[slot] - now_ms) <= 0)
+        {
+            return (char)('A' + slot);
+        }
+    }
+    return '\0';
+}
@@ -0,0 +1,34 @@
+#ifndef __SESSION_TIMERS_H_INCLUDED__
+#define __SESSION_TIMERS_H_INCLUDED__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <ncurses.h>
+#include "common.h"
+
+#define SESSION_DEFAULT_TIMEOUT_MS 15000 // Silence after which a player is evicted, 5 missed heartbeats
+
+/**
+ * Struct: session_timers_t
+ * ------------------------
+ * The idle timers of the players of a live match, by area.
+ *
+ * timeout_ms: Silence after which a player is evicted; 0 to never evict.
+ * armed: true for the areas of players that joined and did not leave.
+ * deadline_ms: Game time at which each player is evicted, in milliseconds
+ *              since the start, pushed back by each of its commands.
+ */
+typedef struct session_timers_t
+{
+    uint32_t timeout_ms;
+    bool armed[MAX_CLIENTS];
+    uint32_t deadline_ms[MAX_CLIENTS];
+} session_timers_t;
+
+void sessions_init(session_timers_t *sessions, uint32_t timeout_ms);
+void sessions_touch(session_timers_t *sessions, char ch, uint32_t now_ms);
+void sessions_forget(session_timers_t *sessions, char ch);
+int sessions_wait_ms(session_timers_t *sessions, uint32_t now_ms);
+char sessions_expired(session_timers_t *sessions, uint32_t now_ms);
+
+#endif // __SESSION_TIMERS_H_INCLUDED__
@@ -1,13 +1,18 @@
+import sys
 import zmq
 import score_update_pb2  # File generated by protoc
 
+# Usage: python3 space-high-scores.py [--frames ENDPOINT]
+# The scores are published with the frames, by the server or by a relay
+endpoint = sys.argv[sys.argv.index("--frames") + 1] if "--frames" in sys.argv else "tcp://localhost:5555"
+
 # Dictionary to store the scores
 astronaut_scores = {}
 
 # Configure ZeroMQ as a SUB client
 context = zmq.Context()
 socket = context.socket(zmq.SUB)
-socket.connect("tcp://localhost:5555")  # Connect to the server
+socket.connect(endpoint)  # Connect to the server
 socket.setsockopt_string(zmq.SUBSCRIBE, "scores")  # Subscribe to the "scores" topic
 
 # Function to display the scores in the terminal